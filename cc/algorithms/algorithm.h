@@ -21,10 +21,16 @@
 #include <iterator>
 #include <memory>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "base/status.h"
 #include "base/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "algorithms/binary-summary.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/util.h"
 #include "proto/util.h"
@@ -32,6 +38,7 @@
 #include "proto/data.pb.h"
 #include "proto/summary.pb.h"
 #include "base/canonical_errors.h"
+#include "base/status_macros.h"
 
 namespace differential_privacy {
 
@@ -65,14 +72,31 @@ class Algorithm {
   // Adds one input to the algorithm.
   virtual void AddEntry(const T& t) = 0;
 
-  // Adds multiple inputs to the algorithm.
+  // Adds multiple inputs to the algorithm. Ranges of contiguous T are passed
+  // to AddContiguousEntries() in one call.
   template <typename Iterator>
   void AddEntries(Iterator begin, Iterator end) {
-    for (auto it = begin; it != end; ++it) {
-      AddEntry(*it);
+    constexpr bool kContiguous =
+        std::is_same<Iterator, T*>::value ||
+        std::is_same<Iterator, const T*>::value ||
+        std::is_same<Iterator, typename std::vector<T>::iterator>::value ||
+        std::is_same<Iterator, typename std::vector<T>::const_iterator>::value;
+    if constexpr (kContiguous) {
+      if (begin != end) {
+        AddContiguousEntries(absl::MakeConstSpan(&*begin, end - begin));
+      }
+    } else {
+      for (auto it = begin; it != end; ++it) {
+        AddEntry(*it);
+      }
     }
   }
 
+  // Adds an array of inputs to the algorithm.
+  void AddEntries(absl::Span<const T> entries) {
+    AddContiguousEntries(entries);
+  }
+
   // Runs the algorithm on the input using the epsilon parameter
   // provided in the constructor and returns output.
   template <typename Iterator>
@@ -138,6 +162,67 @@ class Algorithm {
   // algorithm used. The summary proto cannot be empty.
   virtual base::Status Merge(const Summary& summary) = 0;
 
+  // Appends a summary of the current entries to buffer in the binary layout of
+  // binary-summary.h. It holds the same data as Serialize(), but is written
+  // without building a summary proto and packing it into an Any, and is much
+  // smaller for algorithms with a layout of their own.
+  void SerializeToBinary(std::string* buffer) {
+    BinarySummaryWriter writer(buffer);
+    WriteBinarySummary(&writer);
+  }
+
+  // Merges a summary written by SerializeToBinary() of the same algorithm type
+  // with identical parameters. Merging fails if the summary is malformed or
+  // does not match the algorithm, in which case the algorithm is unchanged.
+  base::Status MergeFromBinary(absl::string_view data) {
+    BinarySummaryReader reader(data);
+    ASSIGN_OR_RETURN(BinarySummaryMerge merge, ReadBinarySummary(&reader));
+    if (!reader.empty()) {
+      return MalformedBinarySummaryError();
+    }
+    return merge();
+  }
+
+  // Writes the binary summary at the position of writer, or reads the one at
+  // the position of reader, so that algorithms can nest the summaries of the
+  // algorithms they use. Reading validates the summary against the algorithm
+  // without changing it, and returns the merge of the summary, which refers to
+  // the summary data. By default, the binary summary holds the bytes of the
+  // Serialize() proto.
+  virtual void WriteBinarySummary(BinarySummaryWriter* writer) {
+    writer->WriteHeader(BinarySummaryType::kProto);
+    writer->WriteBytes(Serialize().SerializeAsString());
+  }
+
+  virtual base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kProto));
+    absl::string_view bytes;
+    Summary summary;
+    if (!reader->ReadBytes(&bytes) ||
+        !summary.ParseFromArray(bytes.data(), bytes.size())) {
+      return MalformedBinarySummaryError();
+    }
+    return BinarySummaryMerge([this, summary]() { return Merge(summary); });
+  }
+
+  // Merges the entries of other, an algorithm of the same type with identical
+  // parameters, directly instead of through a serialized summary. Entries can
+  // thus be added to an algorithm per thread and combined afterwards.
+  base::Status MergeFrom(const Algorithm& other) {
+    RETURN_IF_ERROR(CheckMergeable(other));
+    return MergeAlgorithm(other);
+  }
+
+  // Same as above, but moves the buffers of other into this algorithm where
+  // possible instead of copying them. other is reset.
+  base::Status MergeFrom(Algorithm&& other) {
+    RETURN_IF_ERROR(CheckMergeable(other));
+    RETURN_IF_ERROR(MergeAlgorithm(std::move(other)));
+    other.Reset();
+    return base::OkStatus();
+  }
+
   // Returns the memory currently used by the algorithm in bytes.
   virtual int64_t MemoryUsed() = 0;
 
@@ -173,9 +258,42 @@ class Algorithm {
   // Allows child classes to reset their state as part of a global reset.
   virtual void ResetState() = 0;
 
+  // Merges the entries of other, which has the same type as this algorithm,
+  // for MergeFrom(). Child classes override this to merge their state
+  // directly; by default, the Serialize() summary of other is merged.
+  virtual base::Status MergeAlgorithm(const Algorithm& other) {
+    // Serialize() does not change other, but is not const.
+    return Merge(const_cast<Algorithm&>(other).Serialize());
+  }
+
+  // Same as above, but buffers of other may be moved instead of copied. Child
+  // classes that can take over buffers override this as well.
+  virtual base::Status MergeAlgorithm(Algorithm&& other) {
+    return MergeAlgorithm(static_cast<const Algorithm&>(other));
+  }
+
+  // Adds each of the entries as if by AddEntry(). Child classes can override
+  // this to ingest arrays of inputs without a virtual call per input.
+  virtual void AddContiguousEntries(absl::Span<const T> entries) {
+    for (const T& entry : entries) {
+      AddEntry(entry);
+    }
+  }
+
  private:
   static constexpr double kFullPrivacyBudget = 1.0;
 
+  base::Status CheckMergeable(const Algorithm& other) const {
+    if (&other == this) {
+      return base::InternalError("Cannot merge an algorithm into itself.");
+    }
+    if (typeid(other) != typeid(*this)) {
+      return base::InternalError(
+          "Cannot merge an algorithm of a different type.");
+    }
+    return base::OkStatus();
+  }
+
   const double epsilon_;
   double privacy_budget_;
 };
@@ -36,13 +36,15 @@ template <typename T>
 class TestAlgorithm : public Algorithm<T> {
  public:
   TestAlgorithm() : Algorithm<T>(1.0) {}
-  void AddEntry(const T& t) override {}
+  void AddEntry(const T& t) override { entries.push_back(t); }
   Summary Serialize() override { return Summary(); }
   base::Status Merge(const Summary& summary) override {
     return base::OkStatus();
   }
   int64_t MemoryUsed() override { return sizeof(TestAlgorithm<T>); }
 
+  std::vector<T> entries;
+
  protected:
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
@@ -107,6 +109,27 @@ TEST(IncrementalAlgorithmTest, MergedPartialResultConsumesBudget) {
   EXPECT_THAT(alg_2.RemainingPrivacyBudget(), DoubleNear(0.0, kTestPrecision));
 }
 
+TEST(IncrementalAlgorithmTest, AddEntriesAddsEveryEntryInOrder) {
+  const std::vector<double> input = {1, 2, 3, 4};
+
+  TestAlgorithm<double> from_vector;
+  from_vector.AddEntries(input.begin(), input.end());
+  EXPECT_EQ(from_vector.entries, input);
+
+  TestAlgorithm<double> from_list;
+  std::list<double> list(input.begin(), input.end());
+  from_list.AddEntries(list.begin(), list.end());
+  EXPECT_EQ(from_list.entries, input);
+
+  TestAlgorithm<double> from_span;
+  from_span.AddEntries(input);
+  EXPECT_EQ(from_span.entries, input);
+
+  TestAlgorithm<double> from_empty_range;
+  from_empty_range.AddEntries(input.end(), input.end());
+  EXPECT_TRUE(from_empty_range.entries.empty());
+}
+
 TEST(IncrementalAlgorithmDeathTest, BudgetTooHigh) {
   TestAlgorithm<double> alg;
   ASSERT_OK(alg.PartialResult(0.5));
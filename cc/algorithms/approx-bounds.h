@@ -17,13 +17,21 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_APPROX_BOUNDS_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_APPROX_BOUNDS_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
 
 #include "google/protobuf/any.pb.h"
 #include "base/status.h"
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/util.h"
@@ -33,6 +41,146 @@
 
 namespace differential_privacy {
 
+// The values of a fixed number of bins, of which only the range between the
+// lowest and the highest bin written to is allocated. All other bins are zero.
+// The inputs of a partition usually span few orders of magnitude, so this keeps
+// logarithmic histograms with thousands of bins small.
+template <typename V>
+class BinVector {
+ public:
+  explicit BinVector(int size = 0) : size_(size) {}
+
+  // The number of bins, allocated or not.
+  int size() const { return size_; }
+
+  // The allocated bins are [begin_index(), end_index()).
+  int begin_index() const { return offset_; }
+  int end_index() const { return offset_ + values_.size(); }
+
+  V operator[](int i) const {
+    if (i < begin_index() || i >= end_index()) {
+      return 0;
+    }
+    return values_[i - offset_];
+  }
+
+  // Returns a reference to bin i, allocating it if needed.
+  V& Mutable(int i) {
+    if (values_.empty()) {
+      offset_ = i;
+      values_.push_back(0);
+    } else if (i < offset_) {
+      values_.insert(values_.begin(), offset_ - i, 0);
+      offset_ = i;
+    } else if (i >= end_index()) {
+      values_.resize(i - offset_ + 1, 0);
+    }
+    return values_[i - offset_];
+  }
+
+  // Adds the bins of other, which has the same number of bins.
+  void Add(const BinVector& other) {
+    for (int i = other.begin_index(); i < other.end_index(); ++i) {
+      V value = other.values_[i - other.offset_];
+      if (value != 0) {
+        V& bin = Mutable(i);
+        SafeAdd<V>(bin, value, &bin);
+      }
+    }
+  }
+
+  // Same as above, but takes the allocated bins of other instead if no bins
+  // are allocated yet.
+  void Add(BinVector&& other) {
+    if (!values_.empty()) {
+      Add(other);
+      return;
+    }
+    offset_ = other.offset_;
+    values_ = std::move(other.values_);
+    other.Clear();
+  }
+
+  // Sets all bins to zero and releases the allocated bins.
+  void Clear() {
+    values_ = std::vector<V>();
+    offset_ = 0;
+  }
+
+  int64_t MemoryUsed() const { return sizeof(V) * values_.capacity(); }
+
+ private:
+  int size_;
+  int offset_ = 0;
+  std::vector<V> values_;
+};
+
+// Per-bin accumulators for the partials of ApproxBounds::AddToPartials() of
+// either the positive or the negative entries. Each entry only updates the bin
+// of its most significant bit: the number of entries in that bin and their
+// partials for that bin. Every lower bin receives its maximum partial from the
+// entry, so those partials are recovered from the counts.
+template <typename T2>
+struct BinnedPartials {
+  explicit BinnedPartials(int num_bins = 0)
+      : counts(num_bins), partials(num_bins) {}
+
+  void Clear() {
+    counts.Clear();
+    partials.Clear();
+  }
+
+  void Add(const BinnedPartials& other) {
+    counts.Add(other.counts);
+    partials.Add(other.partials);
+  }
+
+  void Add(BinnedPartials&& other) {
+    counts.Add(std::move(other.counts));
+    partials.Add(std::move(other.partials));
+  }
+
+  int64_t MemoryUsed() const {
+    return counts.MemoryUsed() + partials.MemoryUsed();
+  }
+
+  BinVector<int64_t> counts;
+  BinVector<T2> partials;
+};
+
+// Adds value to partial i of partials, which are only allocated up to the
+// highest partial a nonzero value is added to. All missing partials are zero.
+template <typename T2>
+void AddToLazyPartials(T2 value, int i, std::vector<T2>* partials) {
+  if (value == 0) {
+    return;
+  }
+  if (i >= partials->size()) {
+    partials->resize(i + 1, 0);
+  }
+  SafeAdd<T2>((*partials)[i], value, &(*partials)[i]);
+}
+
+// Adds the partials of other to partials, both allocated as by
+// AddToLazyPartials().
+template <typename T2>
+void AddLazyPartials(const std::vector<T2>& other, std::vector<T2>* partials) {
+  for (int i = 0; i < other.size(); ++i) {
+    AddToLazyPartials(other[i], i, partials);
+  }
+}
+
+// Same as above, but takes the partials of other instead if partials are not
+// allocated yet.
+template <typename T2>
+void AddLazyPartials(std::vector<T2>&& other, std::vector<T2>* partials) {
+  if (!partials->empty()) {
+    AddLazyPartials(other, partials);
+    return;
+  }
+  partials->swap(other);
+}
+
 // Find the approximate bounds of a set of numbers using logarithmic histogram
 // bins. Like other algorithms, ApproxBounds assumes that it only gets one input
 // per user.
@@ -197,8 +345,10 @@ class ApproxBounds : public Algorithm<T> {
   // Serialize the positive and negative bin counts.
   Summary Serialize() override {
     ApproxBoundsSummary am_summary;
-    *am_summary.mutable_pos_bin_count() = {pos_bins_.begin(), pos_bins_.end()};
-    *am_summary.mutable_neg_bin_count() = {neg_bins_.begin(), neg_bins_.end()};
+    for (int i = 0; i < pos_bins_.size(); ++i) {
+      am_summary.add_pos_bin_count(pos_bins_[i]);
+      am_summary.add_neg_bin_count(neg_bins_[i]);
+    }
     Summary summary;
     summary.mutable_data()->PackFrom(am_summary);
     return summary;
@@ -223,20 +373,65 @@ class ApproxBounds : public Algorithm<T> {
           "bin counts as this histogram.");
     }
 
-    // Add bin count from summary to each bin.
+    // Add bin count from summary to each bin. Empty bins are skipped to keep
+    // them unallocated.
     for (int i = 0; i < pos_bins_.size(); ++i) {
-      SafeAdd<int64_t>(pos_bins_[i], am_summary.pos_bin_count(i), &pos_bins_[i]);
-      SafeAdd<int64_t>(neg_bins_[i], am_summary.neg_bin_count(i), &neg_bins_[i]);
+      if (am_summary.pos_bin_count(i) != 0) {
+        int64_t& bin = pos_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, am_summary.pos_bin_count(i), &bin);
+      }
+      if (am_summary.neg_bin_count(i) != 0) {
+        int64_t& bin = neg_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, am_summary.neg_bin_count(i), &bin);
+      }
     }
     return base::OkStatus();
   }
 
+  void WriteBinarySummary(BinarySummaryWriter* writer) override {
+    writer->WriteHeader(BinarySummaryType::kApproxBounds);
+    writer->WriteValues(pos_bins_);
+    writer->WriteValues(neg_bins_);
+  }
+
+  base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) override {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kApproxBounds));
+    BinaryValues<int64_t> pos_bins;
+    BinaryValues<int64_t> neg_bins;
+    if (!reader->ReadValues(&pos_bins) || !reader->ReadValues(&neg_bins)) {
+      return MalformedBinarySummaryError();
+    }
+    if (pos_bins_.size() != pos_bins.size() ||
+        neg_bins_.size() != neg_bins.size()) {
+      return base::InternalError(
+          "Merged approximate max summary must have the same number of "
+          "bin counts as this histogram.");
+    }
+    return BinarySummaryMerge([this, pos_bins, neg_bins]() {
+      pos_bins.ForEachNonzero([this](int64_t i, int64_t count) {
+        int64_t& bin = pos_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, count, &bin);
+      });
+      neg_bins.ForEachNonzero([this](int64_t i, int64_t count) {
+        int64_t& bin = neg_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, count, &bin);
+      });
+      return base::OkStatus();
+    });
+  }
+
+  // The bin layout is shared by all instances with the same histogram
+  // parameters and is not included.
   int64_t MemoryUsed() override {
-    int64_t memory = sizeof(ApproxBounds<T>) +
-                   sizeof(int64_t) * neg_bins_.capacity() +
-                   sizeof(int64_t) * pos_bins_.capacity() +
+    int64_t memory = sizeof(ApproxBounds<T>) + neg_bins_.MemoryUsed() +
+                   pos_bins_.MemoryUsed() +
                    sizeof(T) * noisy_neg_bins_.capacity() +
-                   sizeof(T) * noisy_pos_bins_.capacity();
+                   sizeof(T) * noisy_pos_bins_.capacity() +
+                   sizeof(double) * noised_bins_.capacity() +
+                   sizeof(int) * nonempty_bin_codes_.capacity() +
+                   sizeof(T) * nonempty_noisy_bins_.capacity() +
+                   sizeof(int) * crossing_bin_codes_.capacity();
     if (mechanism_) {
       memory += mechanism_->MemoryUsed();
     }
@@ -270,18 +465,17 @@ class ApproxBounds : public Algorithm<T> {
       abs = std::abs(value);
     }
 
-    // Calculate the most significant bit and clamp to a valid bin index.
-    int msb = std::ceil((std::log(abs) - std::log(scale_)) / std::log(base_));
-    int bin_index =
-        std::max(0, std::min(msb, static_cast<int>(pos_bins_.size() - 1)));
-
-    // Floating-point precision errors mean that for some bin boundaries, we'll
-    // end up calculating the larger-magnitude bin rather than the smaller.
-    if ((value > 0 && value <= PosLeftBinBoundary(bin_index)) ||
-        (value < 0 && value >= NegLeftBinBoundary(bin_index))) {
-      return std::max(0, bin_index - 1);
+    // The bin index is that of the first bin boundary >= abs, clamped to the
+    // last bin.
+    if (power_of_two_bins_) {
+      return std::max(0, std::min(CeilLog2(abs) - log2_scale_,
+                                  last_bin_index_));
     }
-    return bin_index;
+    const std::vector<T>& boundaries = layout_->bin_boundaries;
+    int bin_index =
+        std::lower_bound(boundaries.begin(), boundaries.end(), abs) -
+        boundaries.begin();
+    return std::min(bin_index, last_bin_index_);
   }
 
   // Splits the value into the elements of the partials vector, each of which
@@ -303,9 +497,9 @@ class ApproxBounds : public Algorithm<T> {
   // that lie in bins that are included in the bounds. In our case it is bins
   // (0, 1], (1, 2], (2, 4]. So 1 + 1 + 2 = 4. This is the same result if our
   // value 7 was initially clamped between [0, 4].
-  template <typename T2>
+  template <typename T2, typename MakePartial>
   void AddToPartials(std::vector<T2>* partials, T value,
-                     std::function<T2(T, T)> make_partial) {
+                     MakePartial make_partial) {
     AddMultipleEntriesToPartials<T2>(partials, value, 1, make_partial);
   }
 
@@ -314,6 +508,40 @@ class ApproxBounds : public Algorithm<T> {
     AddMultipleEntriesToPartialSums<T2>(sums, value, 1);
   }
 
+  // Same as AddMultipleEntriesToPartialSums(), but only updates the bin of
+  // value in binned, which must have NumPositiveBins() bins. The partial sums
+  // are obtained by AddBinnedPartialSums().
+  template <typename T2>
+  void AddMultipleEntriesToBinnedPartialSums(BinnedPartials<T2>* binned,
+                                             T value,
+                                             uint64_t num_of_entries) {
+    AddMultipleEntriesToBinnedPartials<T2>(binned, value, num_of_entries,
+                                           MaxPartialSums(value >= 0),
+                                           DifferenceOfValues);
+  }
+
+  void AddMultipleEntriesToBinnedPartialSumsOfSquares(
+      BinnedPartials<double>* binned, T value, uint64_t num_of_entries) {
+    AddMultipleEntriesToBinnedPartials<double>(binned, value, num_of_entries,
+                                               MaxPartialSquares(value >= 0),
+                                               DifferenceOfSquares);
+  }
+
+  // Adds the partial sums of the entries in binned to sums. positive tells
+  // whether binned holds the positive or negative entries.
+  template <typename T2>
+  void AddBinnedPartialSums(const BinnedPartials<T2>& binned, bool positive,
+                            std::vector<T2>* sums) {
+    AddBinnedPartials<T2>(binned, MaxPartialSums(positive), sums);
+  }
+
+  void AddBinnedPartialSumsOfSquares(const BinnedPartials<double>& binned,
+                                     bool positive,
+                                     std::vector<double>* sums_of_squares) {
+    AddBinnedPartials<double>(binned, MaxPartialSquares(positive),
+                              sums_of_squares);
+  }
+
   // Given two vectors of partial values, add the partials in the bins between
   // the boundaries corresponding to lower and upper to get the clamped value.
   // The value_transform and count parameters are used to calculate the
@@ -390,26 +618,17 @@ class ApproxBounds : public Algorithm<T> {
                double k, bool preset_k,
                std::unique_ptr<NumericalMechanism> mechanism)
       : Algorithm<T>(epsilon),
-        pos_bins_(num_bins, 0),
-        neg_bins_(num_bins, 0),
-        bin_boundaries_(num_bins, 0),
+        pos_bins_(num_bins),
+        neg_bins_(num_bins),
+        layout_(GetBinLayout(num_bins, scale, base)),
         scale_(scale),
         base_(base),
+        last_bin_index_(layout_->last_bin_index),
+        power_of_two_bins_(layout_->power_of_two_bins),
+        log2_scale_(layout_->log2_scale),
         k_(k),
         preset_k_(preset_k),
-        mechanism_(std::move(mechanism)) {
-    // Cache the bin boundary magnitudes for performance. Note that casting
-    // numeric limits lead to inconsistencies.
-    auto get_boundary = [boundary = scale_, base = base_]() mutable {
-      if (boundary >= std::numeric_limits<T>::max() / base) {
-        return std::numeric_limits<T>::max();
-      }
-      double this_boundary = boundary;
-      boundary *= base;
-      return static_cast<T>(this_boundary);
-    };
-    std::generate(bin_boundaries_.begin(), bin_boundaries_.end(), get_boundary);
-  }
+        mechanism_(std::move(mechanism)) {}
 
   // Returns an output containing approximate min as the first element and
   // approximate max as the second element. If not enough inputs exist to pass
@@ -427,42 +646,27 @@ class ApproxBounds : public Algorithm<T> {
       threshold /= privacy_budget;
     }
 
-    // Populate noisy versions of the histogram bins.
-    noisy_pos_bins_ = AddNoise(privacy_budget, pos_bins_);
-    noisy_neg_bins_ = AddNoise(privacy_budget, neg_bins_);
+    // Find the lowest and highest positive and negative bins whose noisy
+    // counts reach the threshold.
+    BinsAboveThreshold above(pos_bins_.size());
+    if (!FindSparseBinsAboveThreshold(privacy_budget, threshold, &above)) {
+      FindBinsAboveThreshold(privacy_budget, threshold, &above);
+    }
 
     Output output;
 
     // Find first bin above threshold for minimum.
-    for (int i = neg_bins_.size() - 1; i >= 0; --i) {
-      if (noisy_neg_bins_[i] >= threshold) {
-        AddToOutput<T>(&output, NegRightBinBoundary(i));
-        break;
-      }
-    }
-    if (output.elements_size() == 0) {
-      for (int i = 0; i < pos_bins_.size(); ++i) {
-        if (noisy_pos_bins_[i] >= threshold) {
-          AddToOutput<T>(&output, PosLeftBinBoundary(i));
-          break;
-        }
-      }
+    if (above.max_neg >= 0) {
+      AddToOutput<T>(&output, NegRightBinBoundary(above.max_neg));
+    } else if (above.min_pos < pos_bins_.size()) {
+      AddToOutput<T>(&output, PosLeftBinBoundary(above.min_pos));
     }
 
     // Find first bin above threshold for maximum.
-    for (int i = pos_bins_.size() - 1; i >= 0; --i) {
-      if (noisy_pos_bins_[i] >= threshold) {
-        AddToOutput<T>(&output, PosRightBinBoundary(i));
-        break;
-      }
-    }
-    if (output.elements_size() < 2) {
-      for (int i = 0; i < neg_bins_.size(); ++i) {
-        if (noisy_neg_bins_[i] >= threshold) {
-          AddToOutput<T>(&output, NegLeftBinBoundary(i));
-          break;
-        }
-      }
+    if (above.max_pos >= 0) {
+      AddToOutput<T>(&output, PosRightBinBoundary(above.max_pos));
+    } else if (above.min_neg < neg_bins_.size()) {
+      AddToOutput<T>(&output, NegLeftBinBoundary(above.min_neg));
     }
 
     // Record error status if approx min or max was not found.
@@ -477,8 +681,63 @@ class ApproxBounds : public Algorithm<T> {
   }
 
   void ResetState() override {
-    std::fill(pos_bins_.begin(), pos_bins_.end(), 0);
-    std::fill(neg_bins_.begin(), neg_bins_.end(), 0);
+    pos_bins_.Clear();
+    neg_bins_.Clear();
+  }
+
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other is an ApproxBounds.
+    return MergeBounds(static_cast<const ApproxBounds<T>&>(other));
+  }
+
+  base::Status MergeAlgorithm(Algorithm<T>&& other) override {
+    return MergeBounds(static_cast<ApproxBounds<T>&&>(other));
+  }
+
+  // Histograms the entries into local counters that are merged into the bins
+  // at the end. Bin indices are computed a block at a time, which lets the
+  // compiler vectorize the bit manipulations of the power of two fast path.
+  // Batches with fewer entries than bins are added one at a time, since
+  // merging the counters would cost more than it saves.
+  void AddContiguousEntries(absl::Span<const T> entries) override {
+    const int num_bins = pos_bins_.size();
+    if (entries.size() < static_cast<size_t>(num_bins)) {
+      for (const T& entry : entries) {
+        AddEntry(entry);
+      }
+      return;
+    }
+    // Positive bins, negative bins, and a last counter for dropped NaNs. The
+    // counters are shared by all instances on a thread and are all zero between
+    // calls, so that they are neither allocated per batch nor kept per
+    // partition.
+    thread_local std::vector<int64_t> counts;
+    if (counts.size() < 2 * num_bins + 1) {
+      counts.resize(2 * num_bins + 1);
+    }
+    int bin_codes[kBinCodeBlockSize];
+    for (size_t start = 0; start < entries.size();
+         start += kBinCodeBlockSize) {
+      absl::Span<const T> block =
+          entries.subspan(start, kBinCodeBlockSize);
+      ComputeBinCodes(block, bin_codes);
+      for (int i = 0; i < block.size(); ++i) {
+        ++counts[bin_codes[i]];
+      }
+    }
+    for (int i = 0; i < num_bins; ++i) {
+      if (counts[i] != 0) {
+        int64_t& bin = pos_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, counts[i], &bin);
+        counts[i] = 0;
+      }
+      if (counts[num_bins + i] != 0) {
+        int64_t& bin = neg_bins_.Mutable(i);
+        SafeAdd<int64_t>(bin, counts[num_bins + i], &bin);
+        counts[num_bins + i] = 0;
+      }
+    }
+    counts[2 * num_bins] = 0;
   }
 
   // Given a bin index, finds the larger-magnitude boundary of the corresponding
@@ -493,9 +752,25 @@ class ApproxBounds : public Algorithm<T> {
 
   // Given a bin index, finds the larger-magnitude boundary of the corresponding
   // bin for positive bin.
-  T PosRightBinBoundary(int bin_index) { return bin_boundaries_[bin_index]; }
+  T PosRightBinBoundary(int bin_index) {
+    return layout_->bin_boundaries[bin_index];
+  }
 
  private:
+  // Merges the bins of bounds, which are copied if bounds is an lvalue and
+  // moved otherwise.
+  template <typename Bounds>
+  base::Status MergeBounds(Bounds&& bounds) {
+    if (pos_bins_.size() != bounds.pos_bins_.size() ||
+        scale_ != bounds.scale_ || base_ != bounds.base_) {
+      return base::InternalError(
+          "Merged approximate bounds must have the same histogram bins.");
+    }
+    pos_bins_.Add(ForwardMember<Bounds>(bounds.pos_bins_));
+    neg_bins_.Add(ForwardMember<Bounds>(bounds.neg_bins_));
+    return base::OkStatus();
+  }
+
   // Add input num_of_entries times to the bins.
   void AddMultipleEntries(const T& input, uint64_t num_of_entries) {
     // REF:
@@ -507,61 +782,46 @@ class ApproxBounds : public Algorithm<T> {
     // Place into correct bin according to most significant bit and sign. Note
     // that MostSignificantBit returns 0 for 0.
     int index = MostSignificantBit(input);
-    if (input >= 0) {
-      SafeAdd<int64_t>(pos_bins_[index], num_of_entries, &pos_bins_[index]);
-    } else {  // value < 0
-      SafeAdd<int64_t>(neg_bins_[index], num_of_entries, &neg_bins_[index]);
-    }
+    int64_t& bin =
+        input >= 0 ? pos_bins_.Mutable(index) : neg_bins_.Mutable(index);
+    SafeAdd<int64_t>(bin, num_of_entries, &bin);
   }
 
   // Adds value to partials (as described in comment for AddToPartials())
   // num_of_entries times. This function more efficiently adds multiple entries
-  // at once, instead of using AddToPartials() in a for-loop.
-  template <typename T2>
+  // at once, instead of using AddToPartials() in a for-loop. MakePartial is a
+  // template parameter so that make_partial is inlined into the per-bin loop.
+  template <typename T2, typename MakePartial>
   void AddMultipleEntriesToPartials(std::vector<T2>* partials, T value,
                                     uint64_t num_of_entries,
-                                    std::function<T2(T, T)> make_partial) {
+                                    MakePartial make_partial) {
     int msb = MostSignificantBit(value);
 
     // Each bin of the logarithmic histograms in ApproxBounds can be a candidate
     // for auto-determined upper and lower bounds. Thus, we store a contribution
-    // of the value from the value for each bin.
-    for (int i = 0; i <= msb; ++i) {
-      // The maximum contribution to the bin is the partial between boundaries.
+    // of the value from the value for each bin. For indices below the msb, add
+    // the maximum contribution (num_of_entries times) to the partial, which is
+    // the partial between the boundaries.
+    for (int i = 0; i < msb; ++i) {
       T2 partial = 0;
       if (value >= 0) {
         partial = make_partial(PosRightBinBoundary(i), PosLeftBinBoundary(i));
       } else {
         partial = make_partial(NegRightBinBoundary(i), NegLeftBinBoundary(i));
       }
+      AddToPartial<T2>(partial, num_of_entries, &(*partials)[i]);
+    }
 
-      T2 multiplied_partial;
-      if (i < msb) {
-        // For indices below the msb, add the maximum contribution
-        // (num_of_entries times) to the partial.
-
-        SafeMultiply<T2>(partial, num_of_entries, &multiplied_partial);
-        SafeAdd<T2>((*partials)[i], multiplied_partial, &(*partials)[i]);
-      } else {
-        // For i = msb, add the remaining contribution (num_of_entries times),
-        // but not more than the maximum contribution to the partial for this
-        // bin. This may occur if the msb was clamped by the ApproxBounds not
-        // having enough bins.
-        T2 remainder;
-        if (value > 0) {
-          remainder = make_partial(value, PosLeftBinBoundary(i));
-        } else {
-          remainder = make_partial(value, NegLeftBinBoundary(i));
-        }
-        if (std::abs(partial) < std::abs(remainder)) {
-          SafeMultiply<T2>(partial, num_of_entries, &multiplied_partial);
-          SafeAdd<T2>((*partials)[msb], multiplied_partial, &(*partials)[msb]);
-        } else {
-          SafeMultiply<T2>(remainder, num_of_entries, &multiplied_partial);
-          SafeAdd<T2>((*partials)[msb], multiplied_partial, &(*partials)[msb]);
-        }
-      }
+    T2 max_partial = 0;
+    if (value >= 0) {
+      max_partial =
+          make_partial(PosRightBinBoundary(msb), PosLeftBinBoundary(msb));
+    } else {
+      max_partial =
+          make_partial(NegRightBinBoundary(msb), NegLeftBinBoundary(msb));
     }
+    AddToPartial<T2>(MsbPartial<T2>(value, msb, max_partial, make_partial),
+                     num_of_entries, &(*partials)[msb]);
   }
 
   // Break value into its partial sums and store it into the sums vector. A
@@ -569,21 +829,306 @@ class ApproxBounds : public Algorithm<T> {
   template <typename T2>
   void AddMultipleEntriesToPartialSums(std::vector<T2>* sums, T value,
                                        uint64_t num_of_entries) {
-    AddMultipleEntriesToPartials<T2>(
-        sums, value, num_of_entries,
-        [](T val1, T val2) { return val1 - val2; });
+    AddMultipleEntriesToPrecomputedPartials<T2>(sums, value, num_of_entries,
+                                                MaxPartialSums(value >= 0),
+                                                DifferenceOfValues);
+  }
+
+  // Break value into its partial sums of squares and store it into the
+  // sums_of_squares vector.
+  void AddMultipleEntriesToPartialSumsOfSquares(
+      std::vector<double>* sums_of_squares, T value, uint64_t num_of_entries) {
+    AddMultipleEntriesToPrecomputedPartials<double>(
+        sums_of_squares, value, num_of_entries, MaxPartialSquares(value >= 0),
+        DifferenceOfSquares);
+  }
+
+  // Same as AddMultipleEntriesToPartials(), but reads the maximum partial of
+  // each bin from max_partials instead of calling make_partial on the bin
+  // boundaries.
+  template <typename T2, typename T3, typename MakePartial>
+  void AddMultipleEntriesToPrecomputedPartials(
+      std::vector<T2>* partials, T value, uint64_t num_of_entries,
+      const std::vector<T3>& max_partials, MakePartial make_partial) {
+    const int msb = MostSignificantBit(value);
+    T2* out = partials->data();
+    const T3* in = max_partials.data();
+    if (num_of_entries == 1) {
+      for (int i = 0; i < msb; ++i) {
+        SafeAdd<T2>(out[i], static_cast<T2>(in[i]), &out[i]);
+      }
+    } else {
+      for (int i = 0; i < msb; ++i) {
+        AddToPartial<T2>(static_cast<T2>(in[i]), num_of_entries, &out[i]);
+      }
+    }
+    AddToPartial<T2>(
+        MsbPartial<T2>(value, msb, static_cast<T2>(in[msb]), make_partial),
+        num_of_entries, &out[msb]);
+  }
+
+  // Adds partial num_of_entries times to *result.
+  template <typename T2>
+  static void AddToPartial(T2 partial, uint64_t num_of_entries, T2* result) {
+    T2 multiplied_partial;
+    SafeMultiply<T2>(partial, num_of_entries, &multiplied_partial);
+    SafeAdd<T2>(*result, multiplied_partial, result);
+  }
+
+  // Returns the partial of value for the bin of its msb: the remaining
+  // contribution, but not more than the maximum contribution to the partial for
+  // this bin. This may occur if the msb was clamped by the ApproxBounds not
+  // having enough bins.
+  template <typename T2, typename MakePartial>
+  T2 MsbPartial(T value, int msb, T2 max_partial, MakePartial make_partial) {
+    T2 remainder;
+    if (value > 0) {
+      remainder = make_partial(value, PosLeftBinBoundary(msb));
+    } else {
+      remainder = make_partial(value, NegLeftBinBoundary(msb));
+    }
+    if (std::abs(max_partial) < std::abs(remainder)) {
+      return max_partial;
+    }
+    return remainder;
   }
 
-  // Add noise to each member of bins and return noisy vector.
-  const std::vector<T> AddNoise(double privacy_budget,
-                                const std::vector<int64_t>& bins) {
-    std::vector<T> noisy_bins(bins.size());
+  template <typename T2, typename T3, typename MakePartial>
+  void AddMultipleEntriesToBinnedPartials(BinnedPartials<T2>* binned, T value,
+                                          uint64_t num_of_entries,
+                                          const std::vector<T3>& max_partials,
+                                          MakePartial make_partial) {
+    const int msb = MostSignificantBit(value);
+    int64_t& count = binned->counts.Mutable(msb);
+    SafeAdd<int64_t>(count, num_of_entries, &count);
+    AddToPartial<T2>(MsbPartial<T2>(value, msb,
+                                    static_cast<T2>(max_partials[msb]),
+                                    make_partial),
+                     num_of_entries, &binned->partials.Mutable(msb));
+  }
+
+  // Walks the bins from the top, adding the maximum partial of each bin for
+  // every entry in a higher bin. Since all partials of one sign have the same
+  // sign, saturating arithmetic gives the same result as adding the entries to
+  // the partials one by one.
+  template <typename T2, typename T3>
+  void AddBinnedPartials(const BinnedPartials<T2>& binned,
+                         const std::vector<T3>& max_partials,
+                         std::vector<T2>* partials) {
+    int64_t num_above = 0;
+    for (int i = binned.counts.end_index() - 1; i >= 0; --i) {
+      if (num_above > 0) {
+        AddToPartial<T2>(static_cast<T2>(max_partials[i]), num_above,
+                         &(*partials)[i]);
+      }
+      SafeAdd<T2>((*partials)[i], binned.partials[i], &(*partials)[i]);
+      SafeAdd<int64_t>(num_above, binned.counts[i], &num_above);
+    }
+  }
+
+  const std::vector<T>& MaxPartialSums(bool positive) {
+    return positive ? layout_->pos_max_partial_sums
+                    : layout_->neg_max_partial_sums;
+  }
+
+  const std::vector<double>& MaxPartialSquares(bool positive) {
+    return positive ? layout_->pos_max_partial_squares
+                    : layout_->neg_max_partial_squares;
+  }
+
+  // The partial functions of the partial sums and partial sums of squares.
+  static T DifferenceOfValues(T val1, T val2) { return val1 - val2; }
+  static double DifferenceOfSquares(T val1, T val2) {
+    // Lessen the chance of becoming inf/-inf by calculating it like this.
+    return (static_cast<double>(val1) + val2) *
+           (static_cast<double>(val1) - val2);
+  }
+
+  // The lowest and highest indices of the positive and negative bins that
+  // reach the threshold, or one past the range if there are none.
+  struct BinsAboveThreshold {
+    explicit BinsAboveThreshold(int num_bins)
+        : num_bins(num_bins),
+          min_pos(num_bins),
+          max_pos(-1),
+          min_neg(num_bins),
+          max_neg(-1) {}
+
+    // Adds the bin of a bin code as returned by ComputeBinCodes().
+    void Add(int bin_code) {
+      if (bin_code < num_bins) {
+        min_pos = std::min(min_pos, bin_code);
+        max_pos = std::max(max_pos, bin_code);
+      } else {
+        min_neg = std::min(min_neg, bin_code - num_bins);
+        max_neg = std::max(max_neg, bin_code - num_bins);
+      }
+    }
+
+    int num_bins;
+    int min_pos;
+    int max_pos;
+    int min_neg;
+    int max_neg;
+  };
+
+  // Adds noise to every bin and finds the bins above threshold.
+  void FindBinsAboveThreshold(double privacy_budget, double threshold,
+                              BinsAboveThreshold* above) {
+    AddNoise(privacy_budget, pos_bins_, &noisy_pos_bins_);
+    AddNoise(privacy_budget, neg_bins_, &noisy_neg_bins_);
+    noisy_bins_pending_ = false;
+    const int num_bins = pos_bins_.size();
+    for (int i = 0; i < num_bins; ++i) {
+      if (noisy_pos_bins_[i] >= threshold) {
+        above->Add(i);
+      }
+      if (noisy_neg_bins_[i] >= threshold) {
+        above->Add(num_bins + i);
+      }
+    }
+  }
+
+  // Finds the bins above threshold with work proportional to the number of
+  // nonempty bins instead of the number of bins. Noise is only drawn for the
+  // nonempty bins. The empty bins all reach the threshold with the same
+  // probability p, so the empty bins that do are found by skipping over runs of
+  // empty bins whose lengths are geometric with parameter p. The noisy counts
+  // of the empty bins are only drawn by MaterializeNoisyBins(), consistently
+  // with the outcome here, once a bounding report needs them. Returns false if
+  // the mechanism does not support drawing noise conditioned on reaching the
+  // threshold, or cannot provide p.
+  bool FindSparseBinsAboveThreshold(double privacy_budget, double threshold,
+                                    BinsAboveThreshold* above) {
+    if (!mechanism_->SupportsNoiseAtLeast()) {
+      return false;
+    }
+    // The noised value that a noisy count has to reach. A positive threshold
+    // keeps the noise of the empty bins mostly below it.
+    if (!(threshold > 0)) {
+      return false;
+    }
+    double at_least;
+    if (std::is_integral<T>::value) {
+      // Casts truncate towards zero, so a cast noised value reaches a positive
+      // threshold iff the noised value reaches the ceiling of the threshold.
+      at_least = std::ceil(threshold);
+    } else if (std::is_same<T, double>::value) {
+      at_least = threshold;
+    } else {
+      return false;
+    }
+    base::StatusOr<double> probability =
+        mechanism_->ProbabilityOfNoisedValueAtLeast(0, at_least,
+                                                    privacy_budget);
+    if (!probability.ok()) {
+      return false;
+    }
+
+    // Noise the nonempty bins, in the order of their bin codes.
+    const int num_bins = pos_bins_.size();
+    nonempty_bin_codes_.clear();
+    noised_bins_.clear();
+    for (int i = pos_bins_.begin_index(); i < pos_bins_.end_index(); ++i) {
+      if (pos_bins_[i] != 0) {
+        nonempty_bin_codes_.push_back(i);
+        noised_bins_.push_back(pos_bins_[i]);
+      }
+    }
+    for (int i = neg_bins_.begin_index(); i < neg_bins_.end_index(); ++i) {
+      if (neg_bins_[i] != 0) {
+        nonempty_bin_codes_.push_back(num_bins + i);
+        noised_bins_.push_back(neg_bins_[i]);
+      }
+    }
+    mechanism_->AddNoiseInPlace(absl::MakeSpan(noised_bins_), privacy_budget);
+    nonempty_noisy_bins_.resize(noised_bins_.size());
+    for (int j = 0; j < noised_bins_.size(); ++j) {
+      SafeCastFromDouble<T>(noised_bins_[j], nonempty_noisy_bins_[j]);
+      if (nonempty_noisy_bins_[j] >= threshold) {
+        above->Add(nonempty_bin_codes_[j]);
+      }
+    }
+
+    // Find the empty bins that reach the threshold. ordinal counts the empty
+    // bins and j the nonempty bins before the current bin code.
+    crossing_bin_codes_.clear();
+    const int64_t num_empty = 2 * num_bins - nonempty_bin_codes_.size();
+    if (probability.value() > 0) {
+      internal::GeometricDistribution run_length(
+          -std::log1p(-probability.value()));
+      int64_t ordinal = run_length.Sample();
+      int j = 0;
+      while (ordinal < num_empty) {
+        while (j < nonempty_bin_codes_.size() &&
+               nonempty_bin_codes_[j] <= ordinal + j) {
+          ++j;
+        }
+        crossing_bin_codes_.push_back(ordinal + j);
+        above->Add(ordinal + j);
+        int64_t skipped = run_length.Sample();
+        if (skipped >= num_empty - ordinal - 1) {
+          break;
+        }
+        ordinal += skipped + 1;
+      }
+    }
+
+    noisy_bins_pending_ = true;
+    pending_privacy_budget_ = privacy_budget;
+    pending_at_least_ = at_least;
+    return true;
+  }
+
+  // Populates the noisy bins from the most recent sparse search. Empty bins
+  // that reached the threshold get noise conditioned on reaching it, and the
+  // other empty bins get noise conditioned on staying below it. The latter is
+  // rejection sampled; at least half of the draws are accepted since the
+  // threshold is positive.
+  void MaterializeNoisyBins() {
+    const int num_bins = pos_bins_.size();
+    noisy_pos_bins_.resize(num_bins);
+    noisy_neg_bins_.resize(num_bins);
+    int next_nonempty = 0;
+    int next_crossing = 0;
+    for (int code = 0; code < 2 * num_bins; ++code) {
+      T& noisy_bin = code < num_bins ? noisy_pos_bins_[code]
+                                     : noisy_neg_bins_[code - num_bins];
+      if (next_nonempty < nonempty_bin_codes_.size() &&
+          nonempty_bin_codes_[next_nonempty] == code) {
+        noisy_bin = nonempty_noisy_bins_[next_nonempty++];
+        continue;
+      }
+      double noised;
+      if (next_crossing < crossing_bin_codes_.size() &&
+          crossing_bin_codes_[next_crossing] == code) {
+        ++next_crossing;
+        base::StatusOr<double> noised_at_least = mechanism_->AddNoiseAtLeast(
+            0, pending_at_least_, pending_privacy_budget_);
+        noised = noised_at_least.ok() ? noised_at_least.value()
+                                      : pending_at_least_;
+      } else {
+        do {
+          noised = mechanism_->AddNoise(0, pending_privacy_budget_);
+        } while (noised >= pending_at_least_);
+      }
+      SafeCastFromDouble<T>(noised, noisy_bin);
+    }
+    noisy_bins_pending_ = false;
+  }
+
+  // Adds noise to each member of bins and writes the noisy bins to noisy_bins.
+  void AddNoise(double privacy_budget, const BinVector<int64_t>& bins,
+                std::vector<T>* noisy_bins) {
+    noised_bins_.assign(bins.size(), 0);
+    for (int i = bins.begin_index(); i < bins.end_index(); ++i) {
+      noised_bins_[i] = bins[i];
+    }
+    mechanism_->AddNoiseInPlace(absl::MakeSpan(noised_bins_), privacy_budget);
+    noisy_bins->resize(bins.size());
     for (int i = 0; i < bins.size(); ++i) {
-      double noised_dbl =
-          mechanism_->AddNoise(static_cast<double>(bins[i]), privacy_budget);
-      SafeCastFromDouble<T>(noised_dbl, noisy_bins[i]);
+      SafeCastFromDouble<T>(noised_bins_[i], (*noisy_bins)[i]);
     }
-    return noisy_bins;
   }
 
   // Given a bin index, finds the smaller-magnitude boundary of the
@@ -606,6 +1151,9 @@ class ApproxBounds : public Algorithm<T> {
   // be part of the count. Input lower and upper are rounded to the nearest
   // larger-magnitude bin boundary.
   base::StatusOr<double> NumInputsOutside(T lower, T upper) {
+    if (noisy_bins_pending_) {
+      MaterializeNoisyBins();
+    }
     // Check that noisy bins have been populated.
     if (noisy_pos_bins_.empty()) {
       return base::InvalidArgumentError(
@@ -665,7 +1213,191 @@ class ApproxBounds : public Algorithm<T> {
   // Friend class for testing only.
   friend class ApproxBoundsTestPeer;
 
-  // Needed for classes that rely on ApproxBounds::AddMultipleEntries()
+  static constexpr int kBinCodeBlockSize = 256;
+
+  // Returns the counter AddContiguousEntries() increments for value: its bin
+  // index for non-negative values, the number of bins plus its bin index for
+  // negative values, and twice the number of bins for NaN.
+  int BinCode(T value) {
+    const int num_bins = pos_bins_.size();
+    if (std::isnan(static_cast<double>(value))) {
+      return 2 * num_bins;
+    }
+    int index = MostSignificantBit(value);
+    return value >= 0 ? index : num_bins + index;
+  }
+
+  // Writes BinCode() of each value in block to bin_codes.
+  void ComputeBinCodes(absl::Span<const T> block, int* bin_codes) {
+    if constexpr (std::is_same<T, double>::value) {
+      if (power_of_two_bins_) {
+        PowerOfTwoBinCodes(block, bin_codes);
+        return;
+      }
+    }
+    for (int i = 0; i < block.size(); ++i) {
+      bin_codes[i] = BinCode(block[i]);
+    }
+  }
+
+  // BinCode() for doubles with power of two bin boundaries. Reads the bin
+  // index off the IEEE 754 exponent and mantissa without branches and only
+  // falls back to BinCode() for zeros, subnormals and NaNs.
+  void PowerOfTwoBinCodes(absl::Span<const double> block, int* bin_codes) {
+    constexpr uint64_t kMantissaMask = (uint64_t{1} << 52) - 1;
+    constexpr int64_t kExponentBias = 1023;
+    constexpr int64_t kMaxExponent = 0x7ff;
+    const int num_bins = pos_bins_.size();
+    bool has_special_values = false;
+    for (int i = 0; i < block.size(); ++i) {
+      uint64_t bits;
+      std::memcpy(&bits, &block[i], sizeof(bits));
+      const int64_t exponent = (bits >> 52) & kMaxExponent;
+      const uint64_t mantissa = bits & kMantissaMask;
+      // Infinities get the exponent of 2^1024 and end up in the last bin.
+      const int64_t ceil_log2 =
+          exponent - kExponentBias + (mantissa != 0 ? 1 : 0);
+      const int64_t index =
+          std::max<int64_t>(0, std::min<int64_t>(ceil_log2 - log2_scale_,
+                                                 last_bin_index_));
+      bin_codes[i] = static_cast<int>(index) + ((bits >> 63) ? num_bins : 0);
+      has_special_values |=
+          exponent == 0 || (exponent == kMaxExponent && mantissa != 0);
+    }
+    if (has_special_values) {
+      for (int i = 0; i < block.size(); ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &block[i], sizeof(bits));
+        const int64_t exponent = (bits >> 52) & kMaxExponent;
+        if (exponent == 0 || exponent == kMaxExponent) {
+          bin_codes[i] = BinCode(block[i]);
+        }
+      }
+    }
+  }
+
+  // Returns the smallest integer i with abs <= 2^i, for positive abs.
+  static int CeilLog2(T abs) {
+    if constexpr (std::is_integral<T>::value) {
+      return BitWidth(static_cast<uint64_t>(abs) - 1);
+    } else {
+      int exponent;
+      double mantissa = std::frexp(static_cast<double>(abs), &exponent);
+      return mantissa == 0.5 ? exponent - 1 : exponent;
+    }
+  }
+
+  // Everything about the bins that only depends on the histogram parameters.
+  struct BinLayout {
+    // The bin boundary magnitudes, starting from lowest positive magnitude.
+    std::vector<T> bin_boundaries;
+
+    // Index of the last bin that is not shadowed by an equal boundary.
+    int last_bin_index;
+
+    // Whether all bin boundaries are scale * 2^i, with scale = 2^log2_scale,
+    // which enables the exponent based MostSignificantBit().
+    bool power_of_two_bins;
+    int log2_scale;
+
+    // The maximum partial sum and partial sum of squares of each positive and
+    // negative bin, which is the partial between its boundaries.
+    std::vector<T> pos_max_partial_sums;
+    std::vector<T> neg_max_partial_sums;
+    std::vector<double> pos_max_partial_squares;
+    std::vector<double> neg_max_partial_squares;
+  };
+
+  // Returns the bin layout for the histogram parameters. Layouts are shared by
+  // all instances with the same parameters, which matters when there are many
+  // instances, e.g., one per partition.
+  static std::shared_ptr<const BinLayout> GetBinLayout(int64_t num_bins,
+                                                       double scale,
+                                                       double base) {
+    static absl::Mutex* mutex = new absl::Mutex();
+    static auto* layouts =
+        new std::map<std::tuple<int64_t, double, double>,
+                     std::weak_ptr<const BinLayout>>();
+    absl::MutexLock lock(mutex);
+    std::shared_ptr<const BinLayout> layout =
+        (*layouts)[std::make_tuple(num_bins, scale, base)].lock();
+    if (!layout) {
+      // Drop the layouts that are no longer used before adding a new one.
+      for (auto it = layouts->begin(); it != layouts->end();) {
+        it = it->second.expired() ? layouts->erase(it) : std::next(it);
+      }
+      layout = CreateBinLayout(num_bins, scale, base);
+      (*layouts)[std::make_tuple(num_bins, scale, base)] = layout;
+    }
+    return layout;
+  }
+
+  static std::shared_ptr<const BinLayout> CreateBinLayout(int64_t num_bins,
+                                                          double scale,
+                                                          double base) {
+    auto layout = std::make_shared<BinLayout>();
+    std::vector<T>& boundaries = layout->bin_boundaries;
+
+    // Cache the bin boundary magnitudes for performance. Note that casting
+    // numeric limits lead to inconsistencies.
+    boundaries.resize(num_bins);
+    auto get_boundary = [boundary = scale, base]() mutable {
+      if (boundary >= std::numeric_limits<T>::max() / base) {
+        return std::numeric_limits<T>::max();
+      }
+      double this_boundary = boundary;
+      boundary *= base;
+      return static_cast<T>(this_boundary);
+    };
+    std::generate(boundaries.begin(), boundaries.end(), get_boundary);
+
+    // Boundaries from the first one clamped to the numeric limit onwards are
+    // all equal, so values beyond the previous boundary fall into that bin.
+    layout->last_bin_index =
+        std::find(boundaries.begin(), boundaries.end(),
+                  std::numeric_limits<T>::max()) -
+        boundaries.begin();
+    layout->last_bin_index = std::min(layout->last_bin_index,
+                                      static_cast<int>(boundaries.size() - 1));
+
+    // For power of two boundaries, which are the default, the bin index can be
+    // read from the binary representation of the input. This requires every
+    // boundary below the numeric limit to be exactly scale * 2^i.
+    int scale_exponent = 0;
+    layout->power_of_two_bins =
+        base == 2 && std::frexp(scale, &scale_exponent) == 0.5;
+    layout->log2_scale = scale_exponent - 1;
+    for (int i = 0; layout->power_of_two_bins && i < boundaries.size(); ++i) {
+      layout->power_of_two_bins =
+          boundaries[i] == std::numeric_limits<T>::max() ||
+          static_cast<double>(boundaries[i]) ==
+              std::ldexp(1.0, layout->log2_scale + i);
+    }
+
+    // The boundaries below match PosRightBinBoundary() and friends.
+    for (int i = 0; i < num_bins; ++i) {
+      T pos_right = boundaries[i];
+      T pos_left = i == 0 ? 0 : boundaries[i - 1];
+      T neg_right = pos_right == std::numeric_limits<T>::max()
+                        ? std::numeric_limits<T>::lowest()
+                        : -1 * pos_right;
+      T neg_left = -1 * pos_left;
+      layout->pos_max_partial_sums.push_back(
+          DifferenceOfValues(pos_right, pos_left));
+      layout->neg_max_partial_sums.push_back(
+          DifferenceOfValues(neg_right, neg_left));
+      layout->pos_max_partial_squares.push_back(
+          DifferenceOfSquares(pos_right, pos_left));
+      layout->neg_max_partial_squares.push_back(
+          DifferenceOfSquares(neg_right, neg_left));
+    }
+    return layout;
+  }
+
+  // Needed for classes that rely on ApproxBounds::AddMultipleEntries() or
+  // merge their ApproxBounds with MergeAlgorithm().
+  template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
+  friend class BoundedSum;
   template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
   friend class BoundedMean;
   template <typename T2, std::enable_if_t<std::is_arithmetic<T2>::value>*>
@@ -673,16 +1405,30 @@ class ApproxBounds : public Algorithm<T> {
 
  private:
   // Count the values in each logarithmic bin for positives and negatives.
-  std::vector<int64_t> pos_bins_;
-  std::vector<int64_t> neg_bins_;
+  BinVector<int64_t> pos_bins_;
+  BinVector<int64_t> neg_bins_;
 
   // Noisy DP counts of the positive and negative bins. Populated upon
-  // generating the result.
+  // generating the result, or when first needed after a sparse search.
   std::vector<T> noisy_pos_bins_;
   std::vector<T> noisy_neg_bins_;
 
-  // The bin boundary magnitudes, starting from lowest positive magnitude.
-  std::vector<T> bin_boundaries_;
+  // Buffer for the noised counts before they are cast to T.
+  std::vector<double> noised_bins_;
+
+  // The outcome of the most recent sparse search, from which the noisy bins
+  // are populated if noisy_bins_pending_ is set: the nonempty bins with their
+  // noisy counts, the empty bins that reached the threshold, and the noise
+  // parameters.
+  bool noisy_bins_pending_ = false;
+  std::vector<int> nonempty_bin_codes_;
+  std::vector<T> nonempty_noisy_bins_;
+  std::vector<int> crossing_bin_codes_;
+  double pending_privacy_budget_ = 0;
+  double pending_at_least_ = 0;
+
+  // The bin boundaries and the values derived from them.
+  std::shared_ptr<const BinLayout> layout_;
 
   // Multiplicative factor for inputs
   double scale_;
@@ -690,6 +1436,11 @@ class ApproxBounds : public Algorithm<T> {
   // Base of the logarithm.
   double base_;
 
+  // Copies of the layout fields read by MostSignificantBit().
+  int last_bin_index_;
+  bool power_of_two_bins_;
+  int log2_scale_;
+
   // The bin count threshold for choosing a minimum / maximum.
   double k_;
 
@@ -16,7 +16,12 @@
 
 #include "algorithms/approx-bounds.h"
 
+#include <cmath>
 #include <limits>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "base/testing/proto_matchers.h"
 #include "base/testing/status_matchers.h"
@@ -52,12 +57,26 @@ class ApproxBoundsTestPeer {
                                               ApproxBounds<T>* ab) {
     ab->AddMultipleEntriesToPartialSums(sums, value, num_of_entries);
   }
+
+  template <typename T>
+  static void AddMultipleEntriesToPartialSumsOfSquares(
+      std::vector<double>* sums_of_squares, T value, uint64_t num_of_entries,
+      ApproxBounds<T>* ab) {
+    ab->AddMultipleEntriesToPartialSumsOfSquares(sums_of_squares, value,
+                                                 num_of_entries);
+  }
+
+  template <typename T>
+  static T PosRightBinBoundary(int bin_index, ApproxBounds<T>* ab) {
+    return ab->PosRightBinBoundary(bin_index);
+  }
 };
 
 namespace {
 
 using ::differential_privacy::test_utils::ZeroNoiseMechanism;
 using ::differential_privacy::base::testing::EqualsProto;
+using ::testing::ElementsAreArray;
 using ::testing::HasSubstr;
 using ::differential_privacy::base::testing::StatusIs;
 
@@ -289,6 +308,45 @@ TYPED_TEST(ApproxBoundsTest, SerializeAndMergeTest) {
                   result2->elements(1).value().float_value());
 }
 
+TYPED_TEST(ApproxBoundsTest, MergeFromTest) {
+  std::vector<TypeParam> a = {-1, -11, 6};
+  std::vector<TypeParam> b = {3, 5, 15, 56};
+  typename ApproxBounds<TypeParam>::Builder builder;
+  builder.SetNumBins(3).SetBase(10).SetScale(1).SetThreshold(2)
+      .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  std::vector<std::unique_ptr<ApproxBounds<TypeParam>>> bounds;
+  for (int i = 0; i < 4; ++i) {
+    base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> built =
+        builder.Build();
+    ASSERT_OK(built);
+    bounds.push_back(std::move(*built));
+  }
+  bounds[1]->AddEntries(a.begin(), a.end());
+  bounds[2]->AddEntries(b.begin(), b.end());
+  bounds[3]->AddEntries(a.begin(), a.end());
+  bounds[3]->AddEntries(b.begin(), b.end());
+
+  // The empty bounds take the bins of the moved bounds and add the copied ones.
+  EXPECT_OK(bounds[0]->MergeFrom(std::move(*bounds[1])));
+  EXPECT_OK(bounds[0]->MergeFrom(*bounds[2]));
+
+  base::StatusOr<Output> merged = bounds[0]->PartialResult();
+  ASSERT_OK(merged);
+  base::StatusOr<Output> expected = bounds[3]->PartialResult();
+  ASSERT_OK(expected);
+  EXPECT_FLOAT_EQ(GetValue<double>(merged->elements(0).value()),
+                  GetValue<double>(expected->elements(0).value()));
+  EXPECT_FLOAT_EQ(GetValue<double>(merged->elements(1).value()),
+                  GetValue<double>(expected->elements(1).value()));
+
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> other_scale =
+      builder.SetScale(2).Build();
+  ASSERT_OK(other_scale);
+  EXPECT_THAT(bounds[0]->MergeFrom(**other_scale),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("same histogram bins")));
+}
+
 TYPED_TEST(ApproxBoundsTest, SerializeAndMergeOverflowPosBinsTest) {
   typename ApproxBounds<int64_t>::Builder builder;
 
@@ -650,6 +708,90 @@ TYPED_TEST(ApproxBoundsTest, AddMultipleEntriesToPartialSums) {
   }
 }
 
+TYPED_TEST(ApproxBoundsTest, PrecomputedPartialsMatchMakePartial) {
+  int n_bins = 8;
+  int n_entries = 3;
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(n_bins)
+          .SetBase(2)
+          .SetScale(1)
+          .Build();
+  ASSERT_OK(bounds);
+  auto difference = [](TypeParam val1, TypeParam val2) { return val1 - val2; };
+  auto difference_of_squares = [](TypeParam val1, TypeParam val2) {
+    return (static_cast<double>(val1) + val2) *
+           (static_cast<double>(val1) - val2);
+  };
+
+  for (TypeParam value : std::vector<TypeParam>{-1000, -200, -3, 0, 1, 6, 100,
+                                                1000}) {
+    std::vector<TypeParam> sums(n_bins, 0);
+    std::vector<TypeParam> expected_sums(n_bins, 0);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSums<TypeParam, TypeParam>(
+        &sums, value, n_entries, bounds.value().get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartials<TypeParam, TypeParam>(
+        &expected_sums, value, n_entries, difference, bounds.value().get());
+    EXPECT_THAT(sums, ElementsAreArray(expected_sums)) << value;
+
+    std::vector<double> sums_of_squares(n_bins, 0);
+    std::vector<double> expected_sums_of_squares(n_bins, 0);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSumsOfSquares<TypeParam>(
+        &sums_of_squares, value, n_entries, bounds.value().get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartials<TypeParam, double>(
+        &expected_sums_of_squares, value, n_entries, difference_of_squares,
+        bounds.value().get());
+    EXPECT_THAT(sums_of_squares, ElementsAreArray(expected_sums_of_squares))
+        << value;
+  }
+}
+
+TYPED_TEST(ApproxBoundsTest, BinnedPartialsMatchPartials) {
+  int n_bins = 8;
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetNumBins(n_bins)
+          .SetBase(2)
+          .SetScale(1)
+          .Build();
+  ASSERT_OK(bounds);
+
+  BinnedPartials<TypeParam> binned_sums(n_bins);
+  BinnedPartials<double> binned_squares(n_bins);
+  std::vector<TypeParam> sums(n_bins, 0);
+  std::vector<TypeParam> expected_sums(n_bins, 0);
+  std::vector<double> squares(n_bins, 0);
+  std::vector<double> expected_squares(n_bins, 0);
+  int n_entries = 1;
+  for (TypeParam value : std::vector<TypeParam>{0, 1, 3, 6, 6, 50, 1000}) {
+    (*bounds)->template AddMultipleEntriesToBinnedPartialSums<TypeParam>(
+        &binned_sums, value, n_entries);
+    (*bounds)->AddMultipleEntriesToBinnedPartialSumsOfSquares(
+        &binned_squares, value, n_entries);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSums<TypeParam, TypeParam>(
+        &expected_sums, value, n_entries, bounds.value().get());
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSumsOfSquares<TypeParam>(
+        &expected_squares, value, n_entries, bounds.value().get());
+    ++n_entries;
+  }
+  (*bounds)->AddBinnedPartialSums(binned_sums, true, &sums);
+  (*bounds)->AddBinnedPartialSumsOfSquares(binned_squares, true, &squares);
+  EXPECT_THAT(sums, ElementsAreArray(expected_sums));
+  EXPECT_THAT(squares, ElementsAreArray(expected_squares));
+
+  binned_sums.Clear();
+  std::fill(expected_sums.begin(), expected_sums.end(), 0);
+  std::fill(sums.begin(), sums.end(), 0);
+  for (TypeParam value : std::vector<TypeParam>{-1, -2, -7, -7, -300}) {
+    (*bounds)->template AddMultipleEntriesToBinnedPartialSums<TypeParam>(
+        &binned_sums, value, n_entries);
+    ApproxBoundsTestPeer::AddMultipleEntriesToPartialSums<TypeParam, TypeParam>(
+        &expected_sums, value, n_entries, bounds.value().get());
+  }
+  (*bounds)->AddBinnedPartialSums(binned_sums, false, &sums);
+  EXPECT_THAT(sums, ElementsAreArray(expected_sums));
+}
+
 TEST(ApproxBoundsTest, OverflowAddMultipleEntriesToPartialSums) {
   int n_bins = 4;
   int64_t n_entries = std::numeric_limits<int64_t>::max();
@@ -791,6 +933,304 @@ TYPED_TEST(ApproxBoundsTest, GetBoundingReport) {
   EXPECT_EQ((*bounds)->GetBoundingReport(-1, 0).num_outside(), 11);  // [-1, 0)
 }
 
+// Returns the index of the first bin whose right boundary is at least the
+// magnitude of value, or the last bin if there is none.
+template <typename T>
+int ExpectedBinIndex(T value, ApproxBounds<T>* bounds) {
+  // The magnitude of the lowest integer is clamped to the largest one.
+  T abs;
+  if (value <= -std::numeric_limits<T>::max()) {
+    abs = std::numeric_limits<T>::max();
+  } else {
+    abs = std::abs(value);
+  }
+  int num_bins = bounds->NumPositiveBins();
+  for (int i = 0; i < num_bins; ++i) {
+    if (abs <= ApproxBoundsTestPeer::PosRightBinBoundary(i, bounds)) {
+      return i;
+    }
+  }
+  return num_bins - 1;
+}
+
+// Checks MostSignificantBit() against bin boundaries for values around each
+// boundary and the numeric limits.
+template <typename T>
+void CheckMostSignificantBitAgainstBoundaries(ApproxBounds<T>* bounds) {
+  std::vector<T> values = {std::numeric_limits<T>::max(),
+                           std::numeric_limits<T>::lowest(), 1};
+  for (int i = 0; i < bounds->NumPositiveBins(); ++i) {
+    T boundary = ApproxBoundsTestPeer::PosRightBinBoundary(i, bounds);
+    values.push_back(boundary);
+    if constexpr (std::is_integral<T>::value) {
+      if (boundary < std::numeric_limits<T>::max()) {
+        values.push_back(boundary + 1);
+      }
+      values.push_back(boundary - 1);
+    } else {
+      values.push_back(
+          std::nextafter(boundary, std::numeric_limits<T>::max()));
+      values.push_back(std::nextafter(boundary, T{0}));
+    }
+  }
+  for (T value : values) {
+    for (T signed_value : {value, static_cast<T>(-value)}) {
+      if (signed_value == 0) continue;
+      EXPECT_EQ(bounds->MostSignificantBit(signed_value),
+                ExpectedBinIndex(signed_value, bounds))
+          << signed_value;
+    }
+  }
+}
+
+TEST(ApproxBoundsTest, MostSignificantBitMatchesBoundaries) {
+  auto default_double = ApproxBounds<double>::Builder().Build();
+  ASSERT_OK(default_double);
+  CheckMostSignificantBitAgainstBoundaries(default_double->get());
+
+  auto default_int = ApproxBounds<int64_t>::Builder().Build();
+  ASSERT_OK(default_int);
+  CheckMostSignificantBitAgainstBoundaries(default_int->get());
+
+  auto scaled_double =
+      ApproxBounds<double>::Builder().SetScale(0.25).SetNumBins(20).Build();
+  ASSERT_OK(scaled_double);
+  CheckMostSignificantBitAgainstBoundaries(scaled_double->get());
+
+  auto base_three_double =
+      ApproxBounds<double>::Builder().SetBase(3).SetNumBins(30).Build();
+  ASSERT_OK(base_three_double);
+  CheckMostSignificantBitAgainstBoundaries(base_three_double->get());
+
+  auto base_three_int = ApproxBounds<int64_t>::Builder()
+                            .SetBase(3)
+                            .SetScale(1)
+                            .SetNumBins(50)
+                            .Build();
+  ASSERT_OK(base_three_int);
+  CheckMostSignificantBitAgainstBoundaries(base_three_int->get());
+
+  auto fractional_scale_int =
+      ApproxBounds<int64_t>::Builder().SetScale(0.5).SetNumBins(10).Build();
+  ASSERT_OK(fractional_scale_int);
+  CheckMostSignificantBitAgainstBoundaries(fractional_scale_int->get());
+}
+
+// Adding an array of entries at once must produce the same histogram as
+// adding them one by one.
+template <typename T>
+void CheckAddEntriesMatchesAddEntry(typename ApproxBounds<T>::Builder& builder,
+                                    const std::vector<T>& entries) {
+  auto one_by_one = builder.Build();
+  ASSERT_OK(one_by_one);
+  for (const T& entry : entries) {
+    (*one_by_one)->AddEntry(entry);
+  }
+  auto bulk = builder.Build();
+  ASSERT_OK(bulk);
+  (*bulk)->AddEntries(entries.begin(), entries.end());
+  EXPECT_THAT((*bulk)->Serialize(), EqualsProto((*one_by_one)->Serialize()));
+}
+
+TEST(ApproxBoundsTest, AddEntriesMatchesAddEntry) {
+  std::vector<double> doubles = {0.0,
+                                 -0.0,
+                                 std::numeric_limits<double>::quiet_NaN(),
+                                 std::numeric_limits<double>::infinity(),
+                                 -std::numeric_limits<double>::infinity(),
+                                 std::numeric_limits<double>::max(),
+                                 std::numeric_limits<double>::lowest(),
+                                 std::numeric_limits<double>::min(),
+                                 std::numeric_limits<double>::denorm_min(),
+                                 -std::numeric_limits<double>::denorm_min()};
+  // Enough values to span several blocks, around each power of two.
+  for (int i = -40; i < 1000; ++i) {
+    double power = std::ldexp(1.0, i);
+    doubles.push_back(power);
+    doubles.push_back(-std::nextafter(power, 0.0));
+    doubles.push_back(std::nextafter(power, 2 * power));
+  }
+  ApproxBounds<double>::Builder default_builder;
+  CheckAddEntriesMatchesAddEntry<double>(default_builder, doubles);
+  ApproxBounds<double>::Builder scaled_builder;
+  scaled_builder.SetScale(1).SetNumBins(20);
+  CheckAddEntriesMatchesAddEntry<double>(scaled_builder, doubles);
+  ApproxBounds<double>::Builder base_three_builder;
+  base_three_builder.SetBase(3).SetNumBins(30);
+  CheckAddEntriesMatchesAddEntry<double>(base_three_builder, doubles);
+
+  std::vector<int64_t> ints = {0, 1, -1, std::numeric_limits<int64_t>::max(),
+                               std::numeric_limits<int64_t>::lowest()};
+  for (int i = 0; i < 1000; ++i) {
+    ints.push_back((i % 2 ? -1 : 1) * (int64_t{1} << (i % 62)) + i % 3 - 1);
+  }
+  ApproxBounds<int64_t>::Builder int_builder;
+  CheckAddEntriesMatchesAddEntry<int64_t>(int_builder, ints);
+}
+
+TEST(ApproxBoundsTest, RepeatedAddEntriesMatchesAddEntry) {
+  std::vector<int64_t> large(1000);
+  for (int i = 0; i < large.size(); ++i) {
+    large[i] = (i % 2 ? -1 : 1) * (int64_t{1} << (i % 62));
+  }
+  std::vector<int64_t> small = {5, -7, 1 << 20};
+  ApproxBounds<int64_t>::Builder builder;
+  auto one_by_one = builder.Build();
+  ASSERT_OK(one_by_one);
+  auto bulk = builder.Build();
+  ASSERT_OK(bulk);
+  // The counters of a large batch are reused by the next one, and a batch
+  // with fewer entries than bins is added one at a time.
+  for (const std::vector<int64_t>* batch : {&large, &small, &large}) {
+    for (int64_t entry : *batch) {
+      (*one_by_one)->AddEntry(entry);
+    }
+    (*bulk)->AddEntries(batch->begin(), batch->end());
+  }
+  EXPECT_THAT((*bulk)->Serialize(), EqualsProto((*one_by_one)->Serialize()));
+}
+
+TEST(BinVectorTest, AllocatesRangeOfWrittenBins) {
+  BinVector<int64_t> bins(10);
+  EXPECT_EQ(bins.size(), 10);
+  EXPECT_EQ(bins.MemoryUsed(), 0);
+  EXPECT_EQ(bins[3], 0);
+
+  bins.Mutable(5) = 2;
+  bins.Mutable(7) += 3;
+  bins.Mutable(4) = 1;
+  EXPECT_EQ(bins.begin_index(), 4);
+  EXPECT_EQ(bins.end_index(), 8);
+  std::vector<int64_t> values;
+  for (int i = 0; i < bins.size(); ++i) {
+    values.push_back(bins[i]);
+  }
+  EXPECT_THAT(values, ElementsAreArray({0, 0, 0, 0, 1, 2, 0, 3, 0, 0}));
+
+  bins.Clear();
+  EXPECT_EQ(bins[5], 0);
+  EXPECT_EQ(bins.MemoryUsed(), 0);
+}
+
+TEST(ApproxBoundsTest, MemoryGrowsWithSpannedBins) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> bounds =
+      ApproxBounds<double>::Builder().Build();
+  ASSERT_OK(bounds);
+  int64_t empty_memory = (*bounds)->MemoryUsed();
+
+  // Inputs spanning few orders of magnitude only allocate the bins between
+  // them, far fewer than the thousands of default bins.
+  (*bounds)->AddEntries({1.0, 3.0, -5.0, 100.0});
+  EXPECT_LE((*bounds)->MemoryUsed() - empty_memory, 16 * sizeof(int64_t));
+
+  (*bounds)->Reset();
+  EXPECT_EQ((*bounds)->MemoryUsed(), empty_memory);
+}
+
+TEST(ApproxBoundsTest, BatchesDoNotKeepCounters) {
+  base::StatusOr<std::unique_ptr<ApproxBounds<double>>> bounds =
+      ApproxBounds<double>::Builder().Build();
+  ASSERT_OK(bounds);
+  int64_t empty_memory = (*bounds)->MemoryUsed();
+
+  // A batch with more entries than bins takes the counting path, whose
+  // counters are not kept by the instance.
+  std::vector<double> batch((*bounds)->NumPositiveBins(), 2.0);
+  (*bounds)->AddEntries(batch.begin(), batch.end());
+  EXPECT_LE((*bounds)->MemoryUsed() - empty_memory, 4 * sizeof(int64_t));
+}
+
+TEST(LazyPartialsTest, AllocatesUpToHighestNonzeroPartial) {
+  std::vector<double> partials;
+  AddToLazyPartials(0.0, 7, &partials);
+  EXPECT_TRUE(partials.empty());
+
+  AddToLazyPartials(2.0, 3, &partials);
+  EXPECT_THAT(partials, ElementsAreArray({0.0, 0.0, 0.0, 2.0}));
+
+  std::vector<double> other = {1.0, 0.0, 0.0, 0.0, 0.0, 4.0};
+  AddLazyPartials(other, &partials);
+  EXPECT_THAT(partials, ElementsAreArray({1.0, 0.0, 0.0, 2.0, 0.0, 4.0}));
+}
+
+// A Laplace mechanism without support for the sparse threshold search, so that
+// ApproxBounds adds noise to every bin.
+class DenseLaplaceMechanism : public LaplaceMechanism {
+ public:
+  class Builder : public LaplaceMechanism::Builder {
+   public:
+    base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() override {
+      return base::StatusOr<std::unique_ptr<NumericalMechanism>>(
+          absl::make_unique<DenseLaplaceMechanism>(
+              GetEpsilon().value_or(1), GetL0Sensitivity().value_or(1) *
+                                            GetLInfSensitivity().value_or(1)));
+    }
+
+    std::unique_ptr<NumericalMechanismBuilder> Clone() const override {
+      return absl::make_unique<Builder>(*this);
+    }
+  };
+
+  DenseLaplaceMechanism(double epsilon, double sensitivity)
+      : LaplaceMechanism(epsilon, sensitivity) {}
+
+  bool SupportsNoiseAtLeast() const override { return false; }
+};
+
+// Returns how often each approximate min and max pair, or failure, is the
+// result of bounds over repeated runs, as well as the mean noisy number of
+// inputs of the bounding reports.
+std::map<std::pair<int64_t, int64_t>, double> BoundsFrequencies(
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder,
+    double* mean_num_inputs) {
+  const int num_runs = 4000;
+  std::vector<int64_t> a = {3, 3, 3, 3, 3, 40};
+  std::map<std::pair<int64_t, int64_t>, double> frequencies;
+  *mean_num_inputs = 0;
+  for (int i = 0; i < num_runs; ++i) {
+    std::unique_ptr<ApproxBounds<int64_t>> bounds =
+        ApproxBounds<int64_t>::Builder()
+            .SetNumBins(8)
+            .SetBase(2)
+            .SetScale(1)
+            .SetThreshold(1)
+            .SetLaplaceMechanism(mechanism_builder->Clone())
+            .Build()
+            .ValueOrDie();
+    bounds->AddEntries(a.begin(), a.end());
+    base::StatusOr<Output> result = bounds->PartialResult();
+    std::pair<int64_t, int64_t> min_max = {0, 0};
+    if (result.ok()) {
+      min_max = {GetValue<int64_t>(result.value().elements(0).value()),
+                 GetValue<int64_t>(result.value().elements(1).value())};
+    }
+    frequencies[min_max] += 1.0 / num_runs;
+    *mean_num_inputs +=
+        bounds->GetBoundingReport(0, 0).num_inputs() / num_runs;
+  }
+  return frequencies;
+}
+
+TEST(ApproxBoundsTest, SparseThresholdSearchMatchesDenseSearch) {
+  double sparse_mean_num_inputs;
+  std::map<std::pair<int64_t, int64_t>, double> sparse = BoundsFrequencies(
+      absl::make_unique<LaplaceMechanism::Builder>(), &sparse_mean_num_inputs);
+  double dense_mean_num_inputs;
+  std::map<std::pair<int64_t, int64_t>, double> dense =
+      BoundsFrequencies(absl::make_unique<DenseLaplaceMechanism::Builder>(),
+                        &dense_mean_num_inputs);
+
+  for (const auto& min_max_and_frequency : dense) {
+    EXPECT_NEAR(sparse[min_max_and_frequency.first],
+                min_max_and_frequency.second, 0.05);
+  }
+  for (const auto& min_max_and_frequency : sparse) {
+    EXPECT_NEAR(dense[min_max_and_frequency.first],
+                min_max_and_frequency.second, 0.05);
+  }
+  EXPECT_NEAR(sparse_mean_num_inputs, dense_mean_num_inputs, 1);
+}
+
 TYPED_TEST(ApproxBoundsTest, Memory) {
   base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds_small =
       typename ApproxBounds<TypeParam>::Builder().SetNumBins(1).Build();
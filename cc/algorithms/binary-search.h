@@ -17,6 +17,8 @@
 #ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SEARCH_H_
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SEARCH_H_
 
+#include <vector>
+
 #include "base/percentile.h"
 #include "google/protobuf/any.pb.h"
 #include "base/status.h"
@@ -55,7 +57,7 @@
 
 namespace differential_privacy {
 
-// Bayesian search creates a map entry for each iteration. Bound this to prevent
+// Bayesian search creates a bucket for each iteration. Bound this to prevent
 // out of memory exception.
 const size_t kMaxBayesianIterations = 10000;
 
@@ -91,7 +93,7 @@ class BinarySearch : public Algorithm<T> {
   }
 
   Summary Serialize() override {
-    BinarySearchSummary bs_summary;
+    PackedBinarySearchSummary bs_summary;
     quantiles_->SerializeToProto(bs_summary.mutable_input());
     Summary summary;
     summary.mutable_data()->PackFrom(bs_summary);
@@ -103,6 +105,16 @@ class BinarySearch : public Algorithm<T> {
       return base::InternalError(
           "Cannot merge summary with no binary search data.");
     }
+    if (summary.data().Is<PackedBinarySearchSummary>()) {
+      PackedBinarySearchSummary bs_summary;
+      if (!summary.data().UnpackTo(&bs_summary)) {
+        return base::InternalError(
+            "Binary search summary unable to be unpacked.");
+      }
+      quantiles_->MergeFromProto(bs_summary.input());
+      return base::OkStatus();
+    }
+    // Summaries of older versions.
     BinarySearchSummary bs_summary;
     if (!summary.data().UnpackTo(&bs_summary)) {
       return base::InternalError(
@@ -138,16 +150,49 @@ class BinarySearch : public Algorithm<T> {
 
   void ResetState() override { quantiles_->Reset(); }
 
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other has the same type.
+    quantiles_->MergeFrom(
+        *static_cast<const BinarySearch<T>&>(other).quantiles_);
+    return base::OkStatus();
+  }
+
+  base::Status MergeAlgorithm(Algorithm<T>&& other) override {
+    quantiles_->MergeFrom(
+        std::move(*static_cast<BinarySearch<T>&>(other).quantiles_));
+    return base::OkStatus();
+  }
+
+  // Applies the multipliers to the weights. For the buckets below split,
+  // apply left update. For buckets above, apply right update. The updated
+  // weights are then normalized by their actual sum, so that rounding errors
+  // do not accumulate over the iterations. Protected for testing.
+  static void UpdateWeight(std::vector<double>* weight, size_t split,
+                           double update_left) {
+    double update_right = 1 - update_left;
+    double sum_w = 0;
+    for (size_t i = 0; i < weight->size(); ++i) {
+      (*weight)[i] *= i < split ? update_left : update_right;
+      sum_w += (*weight)[i];
+    }
+
+    // Normalize so weights sum to 1.
+    for (double& w : *weight) {
+      w /= sum_w;
+    }
+  }
+
   base::StatusOr<Output> GenerateResult(double privacy_budget,
                                         double noise_interval_level) override {
     DCHECK_GT(privacy_budget, 0.0)
         << "Privacy budget should be greater than zero.";
     if (privacy_budget == 0.0) return Output();
-    return BayesianSearch(privacy_budget, noise_interval_level);
+    return BayesianSearch(quantile_, privacy_budget, noise_interval_level);
   }
 
- private:
-  base::StatusOr<Output> BayesianSearch(double privacy_budget,
+  // Searches for the given quantile of the inputs with the given fraction of
+  // the privacy budget. Searches for different quantiles share the inputs.
+  base::StatusOr<Output> BayesianSearch(double quantile, double privacy_budget,
                                         double noise_interval_level) {
     // If the bounds are equal, we return the only possible value with total
     // confidence.
@@ -166,16 +211,17 @@ class BinarySearch : public Algorithm<T> {
     double remaining_budget = privacy_budget;
     double max_local_budget = privacy_budget * kMaxLocalBudgetFraction;
 
-    // Stores probability that the target value is the subrange. Since the map
-    // is sorted, it contains a sequence of key-value pairs (k_i, v_i) for
-    // i = 1, 2, ..., n, where n is the dictionary size. Then for
-    // i = 1, ..., n-1, the subrange [k_i. k_(i+1)) has probability v_i of
-    // containing the target value. [k_n, upper_] has probability v_n of
-    // containing the target value.
-    std::map<double, double> weight;
+    // Stores probability that the target value is the subrange. The sorted
+    // bucket lower bounds k_i and their weights v_i, for i = 0, 1, ..., n-1,
+    // are kept in two parallel arrays. Then for i = 0, ..., n-2, the subrange
+    // [k_i, k_(i+1)) has probability v_i of containing the target value.
+    // [k_(n-1), upper_] has probability v_(n-1) of containing the target
+    // value.
     double m = lower_ / 2.0 + upper_ / 2.0;
-    weight[lower_] = .5;
-    weight[m] = .5;
+    std::vector<double> bucket_lower = {static_cast<double>(lower_), m};
+    std::vector<double> weight = {.5, .5};
+    // The index of the first bucket starting at or above m.
+    size_t split = 1;
 
     // Keep doing search iterations while we have enough budget left.
     int iterations = 0;
@@ -194,15 +240,15 @@ class BinarySearch : public Algorithm<T> {
       double noised_size = noisy_less + noisy_more;
       // For extreme percentiles, we want to push the result toward the range of
       // the input data.
-      if (quantile_ < kSingularityTolerance) {
+      if (quantile < kSingularityTolerance) {
         noisy_less -= GetDatapoints(noised_size);
-      } else if ((1 - quantile_) < kSingularityTolerance) {
+      } else if ((1 - quantile) < kSingularityTolerance) {
         noisy_more -= GetDatapoints(noised_size);
       }
 
       // Calculate update multipliers.
-      double update_left =
-          BayesianProbabilityLeft(local_budget, noisy_less, noisy_more);
+      double update_left = BayesianProbabilityLeft(quantile, local_budget,
+                                                   noisy_less, noisy_more);
 
       // Adjust the local budget based on certainty.
       remaining_budget -= local_budget;
@@ -210,26 +256,25 @@ class BinarySearch : public Algorithm<T> {
                               max_local_budget);
 
       // Apply update multipliers.
-      UpdateWeight(&weight, m, update_left);
+      UpdateWeight(&weight, split, update_left);
 
       // Find the subrange to split the bucket and its weight in two.
       double sum_w = 0.0;
-      double lower_bound = static_cast<double>(lower_);
-      double w = 0;
-      auto it = weight.begin();
-      for (; it != weight.end(); it++) {
-        sum_w += it->second;
-        lower_bound = it->first;
-        w = it->second;
+      size_t i = 0;
+      for (; i < weight.size(); ++i) {
+        sum_w += weight[i];
         if (sum_w >= .5) {
           break;
         }
       }
-
-      double upper_bound = static_cast<double>(upper_);
-      if (it != weight.end() && ++it != weight.end()) {
-        upper_bound = it->first;
+      if (i == weight.size()) {
+        --i;
       }
+      double lower_bound = bucket_lower[i];
+      double w = weight[i];
+      double upper_bound = i + 1 < bucket_lower.size()
+                               ? bucket_lower[i + 1]
+                               : static_cast<double>(upper_);
 
       // Split the bucket into two assuming uniform distribution of probability
       // within the bucket. The bucket starting at lower_bound will retain the
@@ -238,9 +283,15 @@ class BinarySearch : public Algorithm<T> {
       // m is lower_bound or upper_bound.
       m = (.5 - sum_w + w) / w * (upper_bound - lower_bound) + lower_bound;
       if (lower_bound < m && m < upper_bound) {
-        weight[lower_bound] =
-            w * (m - lower_bound) / (upper_bound - lower_bound);
-        weight[m] = w * (upper_bound - m) / (upper_bound - lower_bound);
+        weight[i] = w * (m - lower_bound) / (upper_bound - lower_bound);
+        bucket_lower.insert(bucket_lower.begin() + i + 1, m);
+        weight.insert(weight.begin() + i + 1,
+                      w * (upper_bound - m) / (upper_bound - lower_bound));
+        split = i + 1;
+      } else if (m <= lower_bound) {
+        split = i;
+      } else {
+        split = i + 1;
       }
     }
 
@@ -254,11 +305,12 @@ class BinarySearch : public Algorithm<T> {
     // Return 95% confidence interval of the error.
     Output output = MakeOutput<T>(m);
     *(output.mutable_error_report()->mutable_noise_confidence_interval()) =
-        ErrorConfidenceInterval(noise_interval_level, weight, m);
+        ErrorConfidenceInterval(noise_interval_level, bucket_lower, weight, m);
 
     return output;
   }
 
+ private:
   // The "datapoints" is used to buffer the noisy less and noisy more
   // count for finding extreme quantiles (at 0 and 1). It approximately can be
   // thought of as you're looking for a value within datapoints away from the
@@ -272,12 +324,11 @@ class BinarySearch : public Algorithm<T> {
 
   // Given a noisy lower L and noisy greater count U for some value in a set,
   // and that the noise of these counts were generated by this mechanism with
-  // local privacy_budget, find the probability that the percentile p element of
+  // local privacy_budget, find the probability that the quantile p element of
   // the set is to the left of the investigated value. The tolerance is the
   // distance from removable singularities to use the value at singularity.
-  virtual double BayesianProbabilityLeft(double privacy_budget, double L,
-                                         double U) {
-    double p = quantile_;
+  virtual double BayesianProbabilityLeft(double p, double privacy_budget,
+                                         double L, double U) {
     double b = privacy_budget / mechanism_->GetDiversity();
 
     // Removable singularity at p=1/2.
@@ -318,36 +369,6 @@ class BinarySearch : public Algorithm<T> {
     return (-2 + num1 * std::pow(-1 + p, 2) + 4 * p - num2 * p * p) / denom;
   }
 
-  void UpdateWeight(std::map<double, double>* weight, double m,
-                    double update_left) {
-    // Apply the multipliers. For buckets below, apply left update. For buckets
-    // above, apply right update. m is always the lower bound of some bucket.
-    double sum_w = 0;
-    for (std::map<double, double>::iterator it = weight->begin();
-         it != weight->end(); it++) {
-      // Get bounds and weight of the bucket.
-      double lower_bound = it->first;
-      double w = it->second;
-
-      // Apply multiplier for the bucket according to position wrt m.
-      double new_w = w;
-      double update_right = 1 - update_left;
-      if (lower_bound < m) {
-        new_w *= update_left;
-      } else {  // lower_bound >= m
-        new_w *= update_right;
-      }
-      (*weight)[lower_bound] = new_w;
-      sum_w += new_w;
-    }
-
-    // Normalize so weights sum to 1.
-    for (auto const& bucket : *weight) {
-      double lower_bound = bucket.first;
-      (*weight)[lower_bound] /= sum_w;
-    }
-  }
-
   base::StatusOr<double> Percentile(double m) {
     // If there are no inputs, getting the relative rank will return an error.
     // Arbitrarilty say the percentile is 1/2.
@@ -386,25 +407,23 @@ class BinarySearch : public Algorithm<T> {
   }
 
   ConfidenceInterval ErrorConfidenceInterval(
-      double confidence_level, const std::map<double, double>& weight,
-      double result) {
+      double confidence_level, const std::vector<double>& bucket_lower,
+      const std::vector<double>& weight, double result) {
     ConfidenceInterval interval;
     interval.set_confidence_level(confidence_level);
     double sum_w = 0.0;
     bool found_lower = false;
-    std::map<double, double>::const_iterator it;
-    for (it = weight.begin(); it != weight.end(); it++) {
-      sum_w += it->second;
+    for (size_t i = 0; i < weight.size(); ++i) {
+      sum_w += weight[i];
       if (!found_lower && sum_w >= .5 - confidence_level / 2) {
-        interval.set_upper_bound(result - it->first);
+        interval.set_upper_bound(result - bucket_lower[i]);
         found_lower = true;
       }
       if (sum_w > (.5 + confidence_level / 2)) {
-        std::map<double, double>::const_iterator it_next = std::next(it, 1);
-        if (it_next == weight.end()) {
+        if (i + 1 == weight.size()) {
           interval.set_lower_bound(result - upper_);
         } else {
-          interval.set_lower_bound(result - it_next->first);
+          interval.set_lower_bound(result - bucket_lower[i + 1]);
         }
         break;
       }
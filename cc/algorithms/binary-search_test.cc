@@ -18,11 +18,13 @@
 
 #include <climits>
 #include <memory>
+#include <vector>
 
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/random/distributions.h"
+#include "absl/random/random.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/numerical-mechanisms-testing.h"
 #include "algorithms/numerical-mechanisms.h"
@@ -47,6 +49,8 @@ class TestPercentileSearch : public BinarySearch<T> {
                 builder->Build().ValueOrDie().release())),
             absl::make_unique<base::Percentile<T>>()
         ) {}
+
+  using BinarySearch<T>::UpdateWeight;
 };
 
 TEST(BinarySearchTest, MedianTest) {
@@ -123,9 +127,12 @@ TEST(BinarySearchTest, SerializeMergeTest) {
   }
   Summary summary = search.Serialize();
 
-  BinarySearchSummary bs_summary;
+  // Readers of the unpacked summary fail instead of dropping the inputs.
+  PackedBinarySearchSummary bs_summary;
   EXPECT_TRUE(summary.has_data());
   EXPECT_TRUE(summary.data().UnpackTo(&bs_summary));
+  BinarySearchSummary legacy_summary;
+  EXPECT_FALSE(summary.data().UnpackTo(&legacy_summary));
 
   // Merge the summary back.
   TestPercentileSearch<int64_t> search_2(
@@ -139,6 +146,25 @@ TEST(BinarySearchTest, SerializeMergeTest) {
   EXPECT_EQ(GetValue<int64_t>(search_2.PartialResult(1.0).ValueOrDie()), 200);
 }
 
+TEST(BinarySearchTest, MergesOlderSummaries) {
+  BinarySearchSummary bs_summary;
+  for (int64_t i = 0; i < 100; ++i) {
+    SetValue<int64_t>(bs_summary.add_input(), 200);
+  }
+  Summary summary;
+  summary.mutable_data()->PackFrom(bs_summary);
+
+  TestPercentileSearch<int64_t> search(
+      .5, std::log(3), 0, 400,
+      absl::make_unique<test_utils::ZeroNoiseMechanism::Builder>());
+  for (int64_t i = 0; i < 100; ++i) {
+    search.AddEntry(100);
+    search.AddEntry(300);
+  }
+  EXPECT_OK(search.Merge(summary));
+  EXPECT_EQ(GetValue<int64_t>(search.PartialResult(1.0).ValueOrDie()), 200);
+}
+
 TEST(BinarySearchTest, DropNanEntries) {
   double epsilon = 1;
   int64_t lower = 0, upper = 400;
@@ -201,5 +227,37 @@ TEST(BinarySearchTest, LowerEqualsUpper) {
   EXPECT_EQ(output.error_report().noise_confidence_interval().upper_bound(), 1);
 }
 
+TEST(BinarySearchTest, UpdateWeightKeepsWeightsNormalized) {
+  std::vector<double> weight(64, 1.0 / 64);
+  for (int i = 0; i < 10000; ++i) {
+    TestPercentileSearch<double>::UpdateWeight(&weight, 1 + i % 63,
+                                               i % 2 ? .9999 : .3);
+    double sum = 0;
+    for (double w : weight) {
+      sum += w;
+    }
+    EXPECT_NEAR(sum, 1, 1e-12);
+  }
+}
+
+TEST(BinarySearchTest, ResultsStayWithinBounds) {
+  const double lower = 0, upper = 100;
+  absl::BitGen gen;
+  for (double percentile : {0.0, .5, 1.0}) {
+    for (int i = 0; i < 100; ++i) {
+      auto builder = absl::make_unique<LaplaceMechanism::Builder>();
+      builder->SetEpsilon(1);
+      TestPercentileSearch<double> search(percentile, 1, lower, upper,
+                                          std::move(builder));
+      for (int j = 0; j < 1000; ++j) {
+        search.AddEntry(absl::Uniform(gen, lower, upper));
+      }
+      double result = GetValue<double>(search.PartialResult().ValueOrDie());
+      EXPECT_GE(result, lower);
+      EXPECT_LE(result, upper);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -0,0 +1,323 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SUMMARY_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SUMMARY_H_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "base/logging.h"
+#include "base/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "base/canonical_errors.h"
+
+// A compact binary layout for algorithm summaries, written and merged by
+// Algorithm::SerializeToBinary() and Algorithm::MergeFromBinary() without
+// building protos. A summary starts with a version byte and a byte for the type
+// of the algorithm that wrote it, followed by the fields of the algorithm:
+// varints for unsigned integers, zigzag varints for signed integers, little
+// endian doubles, and sequences of values with runs of zeros elided. Summaries
+// of nested algorithms, like the ApproxBounds of a BoundedSum, follow inline.
+
+namespace differential_privacy {
+
+// The version of the layout written by BinarySummaryWriter.
+const uint8_t kBinarySummaryVersion = 1;
+
+// The algorithm that wrote a binary summary.
+enum class BinarySummaryType : uint8_t {
+  // A Summary proto, written by algorithms without a layout of their own.
+  kProto = 0,
+  kCount = 1,
+  kApproxBounds = 2,
+  kBoundedSum = 3,
+  kBoundedMean = 4,
+  kBoundedVariance = 5,
+};
+
+// Merges a binary summary that was read and validated as a whole, so that a
+// summary is either merged completely or not at all.
+using BinarySummaryMerge = std::function<base::Status()>;
+
+// Returned for binary summaries that end early or hold invalid fields.
+inline base::Status MalformedBinarySummaryError() {
+  return base::InternalError("Binary summary is malformed.");
+}
+
+// Appends the fields of a binary summary to a buffer.
+class BinarySummaryWriter {
+ public:
+  explicit BinarySummaryWriter(std::string* buffer) : buffer_(buffer) {}
+
+  void WriteHeader(BinarySummaryType type) {
+    buffer_->push_back(static_cast<char>(kBinarySummaryVersion));
+    buffer_->push_back(static_cast<char>(type));
+  }
+
+  void WriteVarint(uint64_t value) {
+    while (value >= 0x80) {
+      buffer_->push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    buffer_->push_back(static_cast<char>(value));
+  }
+
+  void WriteSigned(int64_t value) {
+    WriteVarint((static_cast<uint64_t>(value) << 1) ^
+                static_cast<uint64_t>(value >> 63));
+  }
+
+  void WriteDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) {
+      buffer_->push_back(static_cast<char>(bits >> (8 * i)));
+    }
+  }
+
+  void WriteBool(bool value) { buffer_->push_back(value ? 1 : 0); }
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value>::type* =
+                nullptr>
+  void WriteValue(T value) {
+    WriteSigned(value);
+  }
+
+  template <typename T, typename std::enable_if<
+                            std::is_floating_point<T>::value>::type* = nullptr>
+  void WriteValue(T value) {
+    WriteDouble(value);
+  }
+
+  // Writes the values of a container with size() and operator[], like a
+  // std::vector: its size and number of nonzero values, followed by each
+  // nonzero value preceded by the number of zeros before it.
+  template <typename Container>
+  void WriteValues(const Container& values) {
+    int64_t size = values.size();
+    int64_t num_nonzero = 0;
+    for (int64_t i = 0; i < size; ++i) {
+      num_nonzero += values[i] != 0;
+    }
+    WriteVarint(size);
+    WriteVarint(num_nonzero);
+    uint64_t zero_run = 0;
+    for (int64_t i = 0; i < size; ++i) {
+      if (values[i] == 0) {
+        ++zero_run;
+        continue;
+      }
+      WriteVarint(zero_run);
+      WriteValue(values[i]);
+      zero_run = 0;
+    }
+  }
+
+  void WriteBytes(absl::string_view bytes) {
+    WriteVarint(bytes.size());
+    buffer_->append(bytes.data(), bytes.size());
+  }
+
+ private:
+  std::string* buffer_;
+};
+
+// A sequence of values read by BinarySummaryReader::ReadValues(). It refers to
+// the summary and decodes the values on each call to ForEachNonzero().
+template <typename T>
+class BinaryValues {
+ public:
+  int64_t size() const { return size_; }
+
+  // Calls f(i, value) for the nonzero values at positions i, in order.
+  template <typename Function>
+  void ForEachNonzero(const Function& f) const;
+
+ private:
+  friend class BinarySummaryReader;
+
+  absl::string_view data_;
+  int64_t size_ = 0;
+  int64_t num_nonzero_ = 0;
+};
+
+// Reads the fields of a binary summary. The Read methods return false if the
+// summary ends early or the field is invalid.
+class BinarySummaryReader {
+ public:
+  explicit BinarySummaryReader(absl::string_view data) : data_(data) {}
+
+  base::Status ReadHeader(BinarySummaryType type) {
+    if (data_.size() < 2) {
+      return MalformedBinarySummaryError();
+    }
+    if (static_cast<uint8_t>(data_[0]) != kBinarySummaryVersion) {
+      return base::InternalError(
+          absl::StrCat("Unsupported binary summary version ",
+                       static_cast<int>(static_cast<uint8_t>(data_[0])),
+                       "."));
+    }
+    if (static_cast<uint8_t>(data_[1]) != static_cast<uint8_t>(type)) {
+      return base::InternalError(
+          "Binary summary was written by a different algorithm.");
+    }
+    data_.remove_prefix(2);
+    return base::OkStatus();
+  }
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      if (data_.empty()) {
+        return false;
+      }
+      uint8_t byte = data_[0];
+      data_.remove_prefix(1);
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool ReadSigned(int64_t* value) {
+    uint64_t zigzag = 0;
+    if (!ReadVarint(&zigzag)) {
+      return false;
+    }
+    *value = static_cast<int64_t>(zigzag >> 1) ^
+             -static_cast<int64_t>(zigzag & 1);
+    return true;
+  }
+
+  bool ReadDouble(double* value) {
+    if (data_.size() < 8) {
+      return false;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i) {
+      bits |= static_cast<uint64_t>(static_cast<uint8_t>(data_[i])) << (8 * i);
+    }
+    std::memcpy(value, &bits, sizeof(bits));
+    data_.remove_prefix(8);
+    return true;
+  }
+
+  bool ReadBool(bool* value) {
+    if (data_.empty() || static_cast<uint8_t>(data_[0]) > 1) {
+      return false;
+    }
+    *value = data_[0] == 1;
+    data_.remove_prefix(1);
+    return true;
+  }
+
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value>::type* =
+                nullptr>
+  bool ReadValue(T* value) {
+    int64_t signed_value = 0;
+    if (!ReadSigned(&signed_value)) {
+      return false;
+    }
+    *value = static_cast<T>(signed_value);
+    return true;
+  }
+
+  template <typename T, typename std::enable_if<
+                            std::is_floating_point<T>::value>::type* = nullptr>
+  bool ReadValue(T* value) {
+    double double_value = 0;
+    if (!ReadDouble(&double_value)) {
+      return false;
+    }
+    *value = static_cast<T>(double_value);
+    return true;
+  }
+
+  // Reads and validates values written by WriteValues(), without decoding
+  // them into memory.
+  template <typename T>
+  bool ReadValues(BinaryValues<T>* values) {
+    uint64_t size = 0;
+    uint64_t num_nonzero = 0;
+    if (!ReadVarint(&size) || !ReadVarint(&num_nonzero) ||
+        size > std::numeric_limits<int>::max() || num_nonzero > size) {
+      return false;
+    }
+    absl::string_view begin = data_;
+    uint64_t end_position = 0;
+    for (uint64_t i = 0; i < num_nonzero; ++i) {
+      uint64_t zero_run = 0;
+      T value{};
+      if (!ReadVarint(&zero_run) || zero_run >= size - end_position ||
+          !ReadValue(&value)) {
+        return false;
+      }
+      end_position += zero_run + 1;
+    }
+    values->data_ = begin.substr(0, begin.size() - data_.size());
+    values->size_ = size;
+    values->num_nonzero_ = num_nonzero;
+    return true;
+  }
+
+  bool ReadBytes(absl::string_view* bytes) {
+    uint64_t size = 0;
+    if (!ReadVarint(&size) || size > data_.size()) {
+      return false;
+    }
+    *bytes = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  // Returns whether the whole summary was read.
+  bool empty() const { return data_.empty(); }
+
+ private:
+  absl::string_view data_;
+};
+
+template <typename T>
+template <typename Function>
+void BinaryValues<T>::ForEachNonzero(const Function& f) const {
+  // The values were validated when they were read.
+  BinarySummaryReader reader(data_);
+  int64_t position = 0;
+  for (int64_t i = 0; i < num_nonzero_; ++i) {
+    uint64_t zero_run = 0;
+    T value{};
+    const bool read_zero_run = reader.ReadVarint(&zero_run);
+    DCHECK(read_zero_run);
+    const bool read_value = reader.ReadValue(&value);
+    DCHECK(read_value);
+    position += zero_run;
+    f(position++, value);
+  }
+}
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_BINARY_SUMMARY_H_
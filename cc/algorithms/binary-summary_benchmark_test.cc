@@ -0,0 +1,87 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/count.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace {
+
+std::unique_ptr<Algorithm<int64_t>> MakeCount() {
+  std::unique_ptr<Algorithm<int64_t>> count =
+      Count<int64_t>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  for (int64_t i = 0; i < 1000; ++i) {
+    count->AddEntry(i);
+  }
+  return count;
+}
+
+// A BoundedMean with automatic bounds, which serializes the partial sums of
+// each bin and the bins of its ApproxBounds.
+std::unique_ptr<Algorithm<int64_t>> MakeBoundedMean() {
+  std::unique_ptr<Algorithm<int64_t>> mean =
+      BoundedMean<int64_t>::Builder().SetEpsilon(1).Build().ValueOrDie();
+  for (int64_t i = 0; i < 1000; ++i) {
+    mean->AddEntry(i * i - 500 * i);
+  }
+  return mean;
+}
+
+// Serializes the algorithm and merges the summary into a second one, either
+// through the Summary proto or through the binary layout.
+template <bool kBinary>
+void SerializeMerge(benchmark::State& state,
+                    std::unique_ptr<Algorithm<int64_t>> (*make)()) {
+  std::unique_ptr<Algorithm<int64_t>> algorithm = make();
+  std::unique_ptr<Algorithm<int64_t>> merged = make();
+  std::string buffer;
+  for (auto _ : state) {
+    if (kBinary) {
+      buffer.clear();
+      algorithm->SerializeToBinary(&buffer);
+      benchmark::DoNotOptimize(merged->MergeFromBinary(buffer));
+    } else {
+      Summary summary = algorithm->Serialize();
+      benchmark::DoNotOptimize(merged->Merge(summary));
+    }
+  }
+  buffer.clear();
+  algorithm->SerializeToBinary(&buffer);
+  state.counters["binary_bytes"] = buffer.size();
+  state.counters["proto_bytes"] = algorithm->Serialize().ByteSizeLong();
+}
+
+template <bool kBinary>
+void BM_CountSerializeMerge(benchmark::State& state) {
+  SerializeMerge<kBinary>(state, &MakeCount);
+}
+BENCHMARK_TEMPLATE(BM_CountSerializeMerge, false);
+BENCHMARK_TEMPLATE(BM_CountSerializeMerge, true);
+
+template <bool kBinary>
+void BM_BoundedMeanSerializeMerge(benchmark::State& state) {
+  SerializeMerge<kBinary>(state, &MakeBoundedMean);
+}
+BENCHMARK_TEMPLATE(BM_BoundedMeanSerializeMerge, false);
+BENCHMARK_TEMPLATE(BM_BoundedMeanSerializeMerge, true);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,140 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/binary-summary.h"
+
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Pair;
+using ::differential_privacy::base::testing::StatusIs;
+
+template <typename T>
+std::vector<std::pair<int64_t, T>> Nonzero(const BinaryValues<T>& values) {
+  std::vector<std::pair<int64_t, T>> nonzero;
+  values.ForEachNonzero(
+      [&nonzero](int64_t i, T value) { nonzero.emplace_back(i, value); });
+  return nonzero;
+}
+
+TEST(BinarySummaryTest, RoundTrip) {
+  std::string buffer;
+  BinarySummaryWriter writer(&buffer);
+  writer.WriteHeader(BinarySummaryType::kCount);
+  writer.WriteVarint(300);
+  writer.WriteVarint(std::numeric_limits<uint64_t>::max());
+  writer.WriteSigned(-3);
+  writer.WriteSigned(std::numeric_limits<int64_t>::lowest());
+  writer.WriteDouble(-1.5);
+  writer.WriteBool(true);
+  writer.WriteBytes("bytes");
+
+  BinarySummaryReader reader(buffer);
+  EXPECT_OK(reader.ReadHeader(BinarySummaryType::kCount));
+  uint64_t unsigned_value;
+  ASSERT_TRUE(reader.ReadVarint(&unsigned_value));
+  EXPECT_EQ(unsigned_value, 300);
+  ASSERT_TRUE(reader.ReadVarint(&unsigned_value));
+  EXPECT_EQ(unsigned_value, std::numeric_limits<uint64_t>::max());
+  int64_t signed_value;
+  ASSERT_TRUE(reader.ReadSigned(&signed_value));
+  EXPECT_EQ(signed_value, -3);
+  ASSERT_TRUE(reader.ReadSigned(&signed_value));
+  EXPECT_EQ(signed_value, std::numeric_limits<int64_t>::lowest());
+  double double_value;
+  ASSERT_TRUE(reader.ReadDouble(&double_value));
+  EXPECT_EQ(double_value, -1.5);
+  bool bool_value;
+  ASSERT_TRUE(reader.ReadBool(&bool_value));
+  EXPECT_TRUE(bool_value);
+  absl::string_view bytes;
+  ASSERT_TRUE(reader.ReadBytes(&bytes));
+  EXPECT_EQ(bytes, "bytes");
+  EXPECT_TRUE(reader.empty());
+  EXPECT_FALSE(reader.ReadVarint(&unsigned_value));
+}
+
+TEST(BinarySummaryTest, ValuesElideZeros) {
+  std::string buffer;
+  BinarySummaryWriter writer(&buffer);
+  writer.WriteValues(std::vector<int64_t>{0, 0, 7, 0, -2, 0});
+  writer.WriteValues(std::vector<double>{.5});
+  // Size, number of nonzero values, and a zero run before each value: six
+  // bytes for the integers and three plus a double for the single double.
+  EXPECT_EQ(buffer.size(), 6 + 3 + 8);
+
+  BinarySummaryReader reader(buffer);
+  BinaryValues<int64_t> ints;
+  BinaryValues<double> doubles;
+  ASSERT_TRUE(reader.ReadValues(&ints));
+  ASSERT_TRUE(reader.ReadValues(&doubles));
+  EXPECT_TRUE(reader.empty());
+  EXPECT_EQ(ints.size(), 6);
+  EXPECT_THAT(Nonzero(ints), ElementsAre(Pair(2, 7), Pair(4, -2)));
+  EXPECT_EQ(doubles.size(), 1);
+  EXPECT_THAT(Nonzero(doubles), ElementsAre(Pair(0, .5)));
+}
+
+TEST(BinarySummaryTest, RejectsValuesBeyondSize) {
+  std::string buffer;
+  BinarySummaryWriter writer(&buffer);
+  writer.WriteVarint(3);  // Size.
+  writer.WriteVarint(1);  // Number of nonzero values.
+  writer.WriteVarint(3);  // Zero run.
+  writer.WriteSigned(1);
+  BinarySummaryReader reader(buffer);
+  BinaryValues<int64_t> values;
+  EXPECT_FALSE(reader.ReadValues(&values));
+}
+
+TEST(BinarySummaryTest, RejectsTruncatedValues) {
+  std::string buffer;
+  BinarySummaryWriter writer(&buffer);
+  writer.WriteValues(std::vector<double>{1, 2});
+  buffer.pop_back();
+  BinarySummaryReader reader(buffer);
+  BinaryValues<double> values;
+  EXPECT_FALSE(reader.ReadValues(&values));
+}
+
+TEST(BinarySummaryTest, RejectsOtherHeaders) {
+  std::string buffer;
+  BinarySummaryWriter(&buffer).WriteHeader(BinarySummaryType::kBoundedSum);
+  EXPECT_THAT(BinarySummaryReader(buffer).ReadHeader(
+                  BinarySummaryType::kBoundedMean),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("different algorithm")));
+  buffer[0] = kBinarySummaryVersion + 1;
+  EXPECT_THAT(
+      BinarySummaryReader(buffer).ReadHeader(BinarySummaryType::kBoundedSum),
+      StatusIs(base::StatusCode::kInternal, HasSubstr("version 2")));
+  EXPECT_THAT(BinarySummaryReader("").ReadHeader(BinarySummaryType::kCount),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("malformed")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
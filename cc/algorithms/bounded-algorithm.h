@@ -23,8 +23,12 @@
 #include "base/status.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
+#include "absl/strings/str_cat.h"
 #include "algorithms/approx-bounds.h"
+#include "algorithms/util.h"
+#include "proto/util.h"
 #include "base/canonical_errors.h"
+#include "base/status_macros.h"
 
 namespace differential_privacy {
 
@@ -43,6 +47,12 @@ const double kDefaultBoundsBudgetFraction = 0.5;
 //      or ApproxBounds algorithm are passed in, then a default ApproxBounds
 //      may be constructed. Child builders can call BoundSettingSetup() upon
 //      Build to do this.
+//   4. Determine bounds in a separate first pass over the input. Feed every
+//      entry to the ApproxBounds returned by BuildFirstPass() and pass it to
+//      SetFirstPass(). Build() then fixes the bounds it finds and the algorithm
+//      aggregates a second pass over the input with them, as with manually set
+//      bounds. This reads the input twice, but the algorithm does not need to
+//      keep partial results for every bin of the automatic bounds.
 //
 // Currently, all bounded algorithms use the Laplace mechanism.
 template <typename T, class Algorithm, class Builder>
@@ -62,11 +72,15 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
   }
 
   // ClearBounds resets the builder. Erases bounds and bounding objects that
-  // were previously set.
+  // were previously set. The epsilon spent by a first pass that Build() has
+  // already consumed stays spent.
   Builder& ClearBounds() {
     lower_.reset();
     upper_.reset();
+    remaining_epsilon_.reset();
     approx_bounds_ = nullptr;
+    first_pass_ = nullptr;
+    first_pass_status_ = base::OkStatus();
     return *static_cast<Builder*>(this);
   }
 
@@ -78,6 +92,31 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
     return *static_cast<Builder*>(this);
   }
 
+  // Returns the ApproxBounds for the first pass of two-pass bounding. It spends
+  // the same share of the unspent epsilon on the bounds as the default
+  // ApproxBounds.
+  base::StatusOr<std::unique_ptr<ApproxBounds<T>>> BuildFirstPass() const {
+    ASSIGN_OR_RETURN(double epsilon, GetUnspentEpsilon());
+    return typename ApproxBounds<T>::Builder()
+        .SetEpsilon(epsilon * kDefaultBoundsBudgetFraction)
+        .SetLaplaceMechanism(AlgorithmBuilder::GetMechanismBuilderClone())
+        .Build();
+  }
+
+  // Sets the ApproxBounds that has seen the first pass over the input. Its
+  // epsilon is part of the epsilon of this builder, and the algorithm gets the
+  // remainder. Upon Build(), its result becomes the bounds of the algorithm,
+  // which removes manually set bounds. Further algorithms built afterwards, for
+  // instance one per shard of the second pass, use the same bounds. If the
+  // first pass finds no bounds, its epsilon is spent regardless, and Build()
+  // fails until the bounds are cleared or set in another way. In either case,
+  // the epsilon of the first pass is not available to later algorithms.
+  Builder& SetFirstPass(std::unique_ptr<ApproxBounds<T>> first_pass) {
+    ClearBounds();
+    first_pass_ = std::move(first_pass);
+    return *static_cast<Builder*>(this);
+  }
+
  protected:
   // This method needs to be overwritten by childs to build bounded algorithms.
   virtual base::StatusOr<std::unique_ptr<Algorithm>>
@@ -92,10 +131,9 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
     // If either bound is not set and we do not have an ApproxBounds,
     // construct the default one.
     if (!BoundsAreSet() && !approx_bounds_) {
-      double bounds_epsilon =
-          AlgorithmBuilder::GetEpsilon().value() * kDefaultBoundsBudgetFraction;
-      remaining_epsilon_ =
-          AlgorithmBuilder::GetEpsilon().value() - bounds_epsilon;
+      ASSIGN_OR_RETURN(double epsilon, GetUnspentEpsilon());
+      double bounds_epsilon = epsilon * kDefaultBoundsBudgetFraction;
+      remaining_epsilon_ = epsilon - bounds_epsilon;
       auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
       ASSIGN_OR_RETURN(approx_bounds_,
                        typename ApproxBounds<T>::Builder()
@@ -123,12 +161,15 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
   // specified, this will be the full epsilon. If an ApproxBounds was created
   // automatically this will be the full epsilon - epsilon spent on that
   // ApproxBounds. If called before BoundsSetup this will always return the full
-  // epsilon.
+  // epsilon. Epsilon spent by a consumed first pass is never part of it.
   absl::optional<double> GetRemainingEpsilon() {
     if (remaining_epsilon_.has_value()) {
       return remaining_epsilon_;
     }
-    return AlgorithmBuilder::GetEpsilon();
+    if (!AlgorithmBuilder::GetEpsilon().has_value()) {
+      return absl::nullopt;
+    }
+    return AlgorithmBuilder::GetEpsilon().value() - first_pass_epsilon_;
   }
 
   std::unique_ptr<ApproxBounds<T>> MoveApproxBoundsPointer() {
@@ -152,6 +193,55 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
   // lower and upper bounds, respectively.
   std::unique_ptr<ApproxBounds<T>> approx_bounds_;
 
+  // The first pass of two-pass bounding, until its bounds are fixed.
+  std::unique_ptr<ApproxBounds<T>> first_pass_;
+
+  // The error of a first pass that found no bounds. A failed first pass has
+  // spent its epsilon, so the builder must not fall back to bounds that assume
+  // the full epsilon.
+  base::Status first_pass_status_;
+
+  // Epsilon spent by the first passes that Build() has consumed. Unlike the
+  // bounds, it is not reset by ClearBounds().
+  double first_pass_epsilon_ = 0;
+
+  // Returns the epsilon of the builder that no consumed first pass has spent.
+  base::StatusOr<double> GetUnspentEpsilon() const {
+    ASSIGN_OR_RETURN(double epsilon,
+                     GetValueIfSetAndPositive(AlgorithmBuilder::GetEpsilon(),
+                                              "Epsilon"));
+    return epsilon - first_pass_epsilon_;
+  }
+
+  // Sets the bounds to the approximate minimum and maximum of the first pass
+  // and the remaining epsilon to what the first pass did not spend.
+  base::Status FixBoundsFromFirstPass() {
+    ASSIGN_OR_RETURN(double epsilon, GetUnspentEpsilon());
+    double remaining_epsilon = epsilon - first_pass_->GetEpsilon();
+    if (!(remaining_epsilon > 0)) {
+      return base::InvalidArgumentError(absl::StrCat(
+          "Epsilon of the first pass has to be less than the unspent epsilon ",
+          epsilon, " but is ", first_pass_->GetEpsilon()));
+    }
+    // The first pass can only be released once, so it is consumed whether or
+    // not it finds bounds.
+    std::unique_ptr<ApproxBounds<T>> first_pass = std::move(first_pass_);
+    first_pass_epsilon_ += first_pass->GetEpsilon();
+    base::StatusOr<Output> bounds = first_pass->PartialResult();
+    if (!bounds.ok()) {
+      first_pass_status_ = base::Status(
+          bounds.status().code(),
+          absl::StrCat("The first pass found no bounds and has spent its "
+                       "epsilon; clear the bounds or set new ones: ",
+                       bounds.status().message()));
+      return first_pass_status_;
+    }
+    lower_ = GetValue<T>(bounds.value().elements(0).value());
+    upper_ = GetValue<T>(bounds.value().elements(1).value());
+    remaining_epsilon_ = remaining_epsilon;
+    return base::OkStatus();
+  }
+
   base::Status CheckBoundsOrder() {
     if (BoundsAreSet() && lower_.value() > upper_.value()) {
       return base::InvalidArgumentError(
@@ -162,6 +252,10 @@ class BoundedAlgorithmBuilder : public AlgorithmBuilder<T, Algorithm, Builder> {
 
   // Common initialization and checks for building bounded algorithms.
   base::StatusOr<std::unique_ptr<Algorithm>> BuildAlgorithm() final {
+    RETURN_IF_ERROR(first_pass_status_);
+    if (first_pass_) {
+      RETURN_IF_ERROR(FixBoundsFromFirstPass());
+    }
     RETURN_IF_ERROR(CheckBoundsOrder());
     return BuildBoundedAlgorithm();
   }
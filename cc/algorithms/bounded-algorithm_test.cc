@@ -16,16 +16,22 @@
 
 #include "algorithms/bounded-algorithm.h"
 
+#include <vector>
+
 #include "base/testing/status_matchers.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "base/statusor.h"
 #include "algorithms/algorithm.h"
 #include "algorithms/approx-bounds.h"
+#include "algorithms/numerical-mechanisms-testing.h"
 
 namespace differential_privacy {
 namespace {
 
+using ::testing::HasSubstr;
+using ::differential_privacy::base::testing::StatusIs;
+
 template <typename T>
 class BoundedAlgorithmTest : public testing::Test {};
 
@@ -49,6 +55,9 @@ class BoundedAlgorithm : public Algorithm<T> {
     ApproxBounds<T>* GetApproxBounds() {
       return BoundedBuilder::GetApproxBounds();
     }
+    double RemainingEpsilon() {
+      return BoundedBuilder::GetRemainingEpsilon().value();
+    }
 
    private:
     base::StatusOr<std::unique_ptr<BoundedAlgorithm<T>>> BuildBoundedAlgorithm()
@@ -104,5 +113,58 @@ TYPED_TEST(BoundedAlgorithmTest, AutomaticApproxBounds) {
   EXPECT_TRUE(builder.GetApproxBounds());
 }
 
+TYPED_TEST(BoundedAlgorithmTest, FirstPassSetsBounds) {
+  typename BoundedAlgorithm<TypeParam>::Builder builder;
+  builder.SetEpsilon(1).SetLower(-1).SetUpper(1).SetLaplaceMechanism(
+      absl::make_unique<test_utils::ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> first_pass =
+      builder.BuildFirstPass();
+  ASSERT_OK(first_pass);
+  EXPECT_DOUBLE_EQ((*first_pass)->GetEpsilon(), 0.5);
+  std::vector<TypeParam> a(100, 3);
+  (*first_pass)->AddEntries(a.begin(), a.end());
+
+  builder.SetFirstPass(std::move(*first_pass));
+  EXPECT_FALSE(builder.HasLower());
+  EXPECT_FALSE(builder.HasUpper());
+  EXPECT_OK(builder.Build());
+  EXPECT_EQ(builder.Lower(), 2);
+  EXPECT_EQ(builder.Upper(), 4);
+  EXPECT_FALSE(builder.GetApproxBounds());
+
+  // Later builds keep the bounds of the first pass.
+  EXPECT_OK(builder.Build());
+  EXPECT_EQ(builder.Lower(), 2);
+  EXPECT_EQ(builder.Upper(), 4);
+}
+
+TYPED_TEST(BoundedAlgorithmTest, FirstPassWithoutEnoughInputsFails) {
+  typename BoundedAlgorithm<TypeParam>::Builder builder;
+  builder.SetEpsilon(1);
+  builder.SetFirstPass(builder.BuildFirstPass().ValueOrDie());
+  EXPECT_THAT(builder.Build(),
+              StatusIs(base::StatusCode::kFailedPrecondition,
+                       HasSubstr("first pass found no bounds")));
+
+  // The empty first pass has spent its epsilon, so retrying fails the same
+  // way instead of falling back to automatic bounds.
+  EXPECT_THAT(builder.Build(),
+              StatusIs(base::StatusCode::kFailedPrecondition,
+                       HasSubstr("first pass found no bounds")));
+  EXPECT_FALSE(builder.GetApproxBounds());
+
+  // Clearing the bounds does not refund the epsilon of the first pass.
+  builder.ClearBounds().SetLower(-1).SetUpper(1);
+  EXPECT_DOUBLE_EQ(builder.RemainingEpsilon(), 0.5);
+  EXPECT_OK(builder.Build());
+  EXPECT_DOUBLE_EQ(builder.RemainingEpsilon(), 0.5);
+
+  // Neither does a default ApproxBounds, which gets its share of the rest.
+  builder.ClearBounds();
+  EXPECT_OK(builder.Build());
+  EXPECT_DOUBLE_EQ(builder.RemainingEpsilon(), 0.25);
+  EXPECT_DOUBLE_EQ(builder.GetApproxBounds()->GetEpsilon(), 0.25);
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -133,12 +133,8 @@ class BoundedMean : public Algorithm<T> {
     // Create BoundedMeanSummary.
     BoundedMeanSummary bm_summary;
     bm_summary.set_count(raw_count_);
-    for (T x : pos_sum_) {
-      SetValue(bm_summary.add_pos_sum(), x);
-    }
-    for (T x : neg_sum_) {
-      SetValue(bm_summary.add_neg_sum(), x);
-    }
+    SetPackedValues(PartialSums(true), bm_summary.mutable_packed_pos_sum());
+    SetPackedValues(PartialSums(false), bm_summary.mutable_packed_neg_sum());
     if (approx_bounds_) {
       Summary approx_bounds_summary = approx_bounds_->Serialize();
       approx_bounds_summary.data().UnpackTo(
@@ -167,17 +163,24 @@ class BoundedMean : public Algorithm<T> {
       return base::InternalError("Bounded mean summary unable to be unpacked.");
     }
     SafeAdd<uint64_t>(raw_count_, bm_summary.count(), &raw_count_);
-    if (pos_sum_.size() != bm_summary.pos_sum_size() ||
-        neg_sum_.size() != bm_summary.neg_sum_size()) {
+    PackedValues legacy_pos_sum, legacy_neg_sum;
+    const PackedValues& pos_sum = PackedOrLegacy<T>(
+        bm_summary.packed_pos_sum(), bm_summary.pos_sum(), &legacy_pos_sum);
+    const PackedValues& neg_sum = PackedOrLegacy<T>(
+        bm_summary.packed_neg_sum(), bm_summary.neg_sum(), &legacy_neg_sum);
+    int num_pos_sums = PackedValuesSize<T>(pos_sum);
+    int num_neg_sums = PackedValuesSize<T>(neg_sum);
+    if (NumPartialSums(true) != num_pos_sums ||
+        NumPartialSums(false) != num_neg_sums) {
       return base::InternalError(
           "Merged BoundedMeans must have equal number of partial sums.");
     }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      SafeAdd(pos_sum_[i], GetValue<T>(bm_summary.pos_sum(i)), &pos_sum_[i]);
-    }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      SafeAdd(neg_sum_[i], GetValue<T>(bm_summary.neg_sum(i)), &neg_sum_[i]);
-    }
+    ForEachPackedValue<T>(pos_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &pos_sum_);
+    });
+    ForEachPackedValue<T>(neg_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &neg_sum_);
+    });
     if (approx_bounds_) {
       Summary approx_bounds_summary;
       approx_bounds_summary.mutable_data()->PackFrom(
@@ -188,9 +191,57 @@ class BoundedMean : public Algorithm<T> {
     return base::OkStatus();
   }
 
+  void WriteBinarySummary(BinarySummaryWriter* writer) override {
+    writer->WriteHeader(BinarySummaryType::kBoundedMean);
+    writer->WriteVarint(raw_count_);
+    writer->WriteValues(PartialSums(true));
+    writer->WriteValues(PartialSums(false));
+    writer->WriteBool(approx_bounds_ != nullptr);
+    if (approx_bounds_) {
+      approx_bounds_->WriteBinarySummary(writer);
+    }
+  }
+
+  base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) override {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kBoundedMean));
+    uint64_t count;
+    BinaryValues<T> pos_sum;
+    BinaryValues<T> neg_sum;
+    bool has_bounds;
+    if (!reader->ReadVarint(&count) || !reader->ReadValues(&pos_sum) ||
+        !reader->ReadValues(&neg_sum) || !reader->ReadBool(&has_bounds)) {
+      return MalformedBinarySummaryError();
+    }
+    if (NumPartialSums(true) != pos_sum.size() ||
+        NumPartialSums(false) != neg_sum.size() ||
+        (approx_bounds_ != nullptr) != has_bounds) {
+      return base::InternalError(
+          "Merged BoundedMeans must have equal number of partial sums.");
+    }
+    BinarySummaryMerge merge_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(merge_bounds, approx_bounds_->ReadBinarySummary(reader));
+    }
+    return BinarySummaryMerge([this, count, pos_sum, neg_sum, merge_bounds]() {
+      if (merge_bounds) {
+        RETURN_IF_ERROR(merge_bounds());
+      }
+      SafeAdd<uint64_t>(raw_count_, count, &raw_count_);
+      pos_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &pos_sum_);
+      });
+      neg_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &neg_sum_);
+      });
+      return base::OkStatus();
+    });
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedMean<T>) +
                    sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity());
+    memory += pos_binned_sum_.MemoryUsed() + neg_binned_sum_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
@@ -243,11 +294,11 @@ class BoundedMean : public Algorithm<T> {
         count_mechanism_(std::move(count_mechanism)),
         approx_bounds_(std::move(approx_bounds)) {
     // If automatically determining bounds, we need partial sums for each bin
-    // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
-    // store one already-clamped sum.
+    // of the ApproxBounds logarithmic histogram, which are allocated as they
+    // are needed. Otherwise, we only need to store one already-clamped sum.
     if (approx_bounds_) {
-      pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
-      neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
+      pos_binned_sum_ = BinnedPartials<T>(approx_bounds_->NumPositiveBins());
+      neg_binned_sum_ = BinnedPartials<T>(approx_bounds_->NumPositiveBins());
     } else {
       pos_sum_.push_back(0);
     }
@@ -276,8 +327,8 @@ class BoundedMean : public Algorithm<T> {
 
       // To find the sum, pass the identity function as the transform.
       sum = approx_bounds_->template ComputeFromPartials<T>(
-          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
-          raw_count_);
+          PartialSums(true), PartialSums(false), [](T x) { return x; }, lower_,
+          upper_, raw_count_);
 
       // Populate the bounding report with ApproxBounds information.
       *(output.mutable_error_report()->mutable_bounding_report()) =
@@ -315,12 +366,47 @@ class BoundedMean : public Algorithm<T> {
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
     raw_count_ = 0;
     if (approx_bounds_) {
+      pos_sum_.clear();
+      neg_sum_.clear();
+      pos_binned_sum_.Clear();
+      neg_binned_sum_.Clear();
       approx_bounds_->Reset();
       sum_mechanism_ = nullptr;
     }
   }
 
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other is a BoundedMean.
+    return MergeMean(static_cast<const BoundedMean<T>&>(other));
+  }
+
+  base::Status MergeAlgorithm(Algorithm<T>&& other) override {
+    return MergeMean(static_cast<BoundedMean<T>&&>(other));
+  }
+
  private:
+  // Merges mean, whose state is copied if it is an lvalue and moved otherwise.
+  template <typename Mean>
+  base::Status MergeMean(Mean&& mean) {
+    if ((approx_bounds_ != nullptr) != (mean.approx_bounds_ != nullptr) ||
+        (!approx_bounds_ &&
+         (lower_ != mean.lower_ || upper_ != mean.upper_))) {
+      return base::InternalError(
+          "Merged BoundedMean must have the same bounds as this BoundedMean.");
+    }
+    // The bounds are merged first, since merging them may still fail.
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(approx_bounds_->MergeAlgorithm(
+          ForwardMember<Mean>(*mean.approx_bounds_)));
+      pos_binned_sum_.Add(ForwardMember<Mean>(mean.pos_binned_sum_));
+      neg_binned_sum_.Add(ForwardMember<Mean>(mean.neg_binned_sum_));
+    }
+    SafeAdd<uint64_t>(raw_count_, mean.raw_count_, &raw_count_);
+    AddLazyPartials(ForwardMember<Mean>(mean.pos_sum_), &pos_sum_);
+    AddLazyPartials(ForwardMember<Mean>(mean.neg_sum_), &neg_sum_);
+    return base::OkStatus();
+  }
+
   // Note that for manual bounds, pos_sum_[0] will not surpass T's numeric
   // limit (see SafeAdd implementation), but will continue to increment
   // raw_count_ for every call to AddEntry(). Thus, the resulting mean will be
@@ -346,11 +432,11 @@ class BoundedMean : public Algorithm<T> {
 
       // Find partial sums.
       if (input >= 0) {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &pos_sum_, input, num_of_entries);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &pos_binned_sum_, input, num_of_entries);
       } else {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &neg_sum_, input, num_of_entries);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &neg_binned_sum_, input, num_of_entries);
       }
     }
   }
@@ -370,9 +456,35 @@ class BoundedMean : public Algorithm<T> {
   // Friend class for testing only.
   friend class BoundedMeanTestPeer;
 
-  // Vectors of partial values stored for automatic clamping.
+  // Returns the number of positive or negative partial sums.
+  int NumPartialSums(bool positive) {
+    if (approx_bounds_) {
+      return approx_bounds_->NumPositiveBins();
+    }
+    return positive ? 1 : 0;
+  }
+
+  // Returns the positive or negative partial sums of all entries, merged and
+  // added ones.
+  std::vector<T> PartialSums(bool positive) {
+    std::vector<T> sums = positive ? pos_sum_ : neg_sum_;
+    if (approx_bounds_) {
+      sums.resize(NumPartialSums(positive), 0);
+      approx_bounds_->AddBinnedPartialSums(
+          positive ? pos_binned_sum_ : neg_binned_sum_, positive, &sums);
+    }
+    return sums;
+  }
+
+  // Vectors of partial values stored for automatic clamping. With automatic
+  // bounds, these only hold merged partial sums and are empty until a summary
+  // with nonzero partial sums is merged.
   std::vector<T> pos_sum_, neg_sum_;
 
+  // Partial sums of the added entries for automatic clamping, which keeps
+  // adding an entry constant time and only allocates bins holding entries.
+  BinnedPartials<T> pos_binned_sum_, neg_binned_sum_;
+
   uint64_t raw_count_;
   T lower_, upper_;
   double midpoint_;
@@ -448,6 +448,105 @@ TYPED_TEST(BoundedMeanTest, SerializeMergePartialSumsTest) {
   EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
 }
 
+TYPED_TEST(BoundedMeanTest, BinarySerializeMergePartialSumsTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedMean<TypeParam>::Builder builder;
+
+  // Automatic bounding, so entries will be split and stored as partial sums.
+  auto bounds =
+      bounds_builder.SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds);
+  auto bm1 =
+      builder
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetApproxBounds(std::move(*bounds))
+          .Build();
+  ASSERT_OK(bm1);
+  (*bm1)->AddEntry(-10);
+  (*bm1)->AddEntry(4);
+  std::string summary;
+  (*bm1)->SerializeToBinary(&summary);
+  (*bm1)->AddEntry(6);
+
+  // Merge summary into second BoundedVariance.
+  auto bounds2 = bounds_builder.Build();
+  ASSERT_OK(bounds2);
+  auto bm2 = builder.SetApproxBounds(std::move(*bounds2)).Build();
+  ASSERT_OK(bm2);
+  (*bm2)->AddEntry(6);
+  EXPECT_OK((*bm2)->MergeFromBinary(summary));
+
+  // Check equality.  Bounds are set to [-16, 8].
+  auto result1 = (*bm1)->PartialResult();
+  ASSERT_OK(result1);
+  auto result2 = (*bm2)->PartialResult();
+  ASSERT_OK(result2);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
+}
+
+TYPED_TEST(BoundedMeanTest, MergeFromPartialSumsTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedMean<TypeParam>::Builder builder;
+  bounds_builder.SetThreshold(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  // Automatic bounding, so entries are merged as partial sums.
+  std::vector<std::unique_ptr<BoundedMean<TypeParam>>> means;
+  for (int i = 0; i < 6; ++i) {
+    auto bounds = bounds_builder.Build();
+    ASSERT_OK(bounds);
+    auto mean = builder.SetApproxBounds(std::move(*bounds)).Build();
+    ASSERT_OK(mean);
+    means.push_back(std::move(*mean));
+  }
+  means[0]->AddEntry(6);
+  means[1]->AddEntry(-10);
+  means[2]->AddEntry(4);
+  for (TypeParam entry : {6, -10, 4}) {
+    means[3]->AddEntry(entry);
+  }
+  means[4]->AddEntry(-10);
+  means[5]->AddEntry(5);
+  EXPECT_OK(means[0]->MergeFrom(*means[1]));
+  EXPECT_OK(means[0]->MergeFrom(std::move(*means[2])));
+
+  auto merged = means[0]->PartialResult();
+  ASSERT_OK(merged);
+  auto expected = means[3]->PartialResult();
+  ASSERT_OK(expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*merged), GetValue<double>(*expected));
+
+  // The copied BoundedMean is unchanged, and the moved one is reset.
+  auto copied = means[1]->PartialResult();
+  ASSERT_OK(copied);
+  auto copied_expected = means[4]->PartialResult();
+  ASSERT_OK(copied_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*copied),
+                   GetValue<double>(*copied_expected));
+  means[2]->AddEntry(5);
+  auto moved = means[2]->PartialResult();
+  ASSERT_OK(moved);
+  auto moved_expected = means[5]->PartialResult();
+  ASSERT_OK(moved_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*moved), GetValue<double>(*moved_expected));
+}
+
+TYPED_TEST(BoundedMeanTest, MergeFromRejectsDifferentBounds) {
+  typename BoundedMean<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto mean1 = builder.SetLower(0).SetUpper(10).Build();
+  ASSERT_OK(mean1);
+  auto mean2 = builder.SetLower(0).SetUpper(20).Build();
+  ASSERT_OK(mean2);
+  EXPECT_THAT((*mean1)->MergeFrom(**mean2),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("same bounds")));
+  EXPECT_THAT((*mean1)->MergeFrom(**mean1),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("itself")));
+}
+
 TYPED_TEST(BoundedMeanTest, AutomaticBoundsNegative) {
   std::vector<TypeParam> a = {9, -2, -2, -1, -6, -6};
   auto bounds =
@@ -519,6 +618,37 @@ TYPED_TEST(BoundedMeanTest, AutomaticBoundsPositive) {
   EXPECT_THAT(*actual_output, EqualsProto(expected_output));
 }
 
+TYPED_TEST(BoundedMeanTest, TwoPassBounds) {
+  std::vector<TypeParam> a = {-9, 2, 2, 1, 6, 6};
+  std::unique_ptr<ApproxBounds<TypeParam>> first_pass =
+      typename ApproxBounds<TypeParam>::Builder()
+          .SetEpsilon(0.25)
+          .SetNumBins(5)
+          .SetBase(2)
+          .SetScale(1)
+          .SetThreshold(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  first_pass->AddEntries(a.begin(), a.end());
+  auto bm =
+      typename BoundedMean<TypeParam>::Builder()
+          .SetEpsilon(1)
+          .SetFirstPass(std::move(first_pass))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bm);
+  EXPECT_DOUBLE_EQ((*bm)->GetEpsilon(), 0.75);
+  (*bm)->AddEntries(a.begin(), a.end());
+
+  // -9 gets clamped to 1, as with automatic bounds, but the second pass does
+  // not keep partial sums for every bin.
+  auto actual_output = (*bm)->PartialResult();
+  ASSERT_OK(actual_output);
+  EXPECT_DOUBLE_EQ(GetValue<double>(actual_output->elements(0).value()), 3);
+  EXPECT_FALSE(actual_output->error_report().has_bounding_report());
+}
+
 TEST(BoundedMeanTest, DropNanEntries) {
   std::vector<double> a = {2, 4, 6, NAN, 8};
   auto mean = BoundedMean<double>::Builder()
@@ -712,6 +842,21 @@ TYPED_TEST(BoundedMeanTest, MemoryUsed) {
   EXPECT_GT((*bm)->MemoryUsed(), 0);
 }
 
+TEST(BoundedMeanTest, AutomaticBoundsMemoryIsProportionalToSpannedBins) {
+  auto bm = BoundedMean<double>::Builder().Build();
+  ASSERT_OK(bm);
+  int64_t empty_memory = (*bm)->MemoryUsed();
+
+  // The default histogram has thousands of bins, of which only the few
+  // spanned by the entries are allocated.
+  std::vector<double> a = {1, 2, 4};
+  (*bm)->AddEntries(a.begin(), a.end());
+  EXPECT_LT((*bm)->MemoryUsed() - empty_memory, 200);
+
+  (*bm)->Reset();
+  EXPECT_EQ((*bm)->MemoryUsed(), empty_memory);
+}
+
 TYPED_TEST(BoundedMeanTest, SplitsEpsilonWithAutomaticBounds) {
   double epsilon = 1.0;
   auto bm =
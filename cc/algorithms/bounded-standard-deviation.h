@@ -70,12 +70,13 @@ class BoundedStandardDeviation : public Algorithm<T> {
       auto mech_builder = AlgorithmBuilder::GetMechanismBuilderClone();
       ASSIGN_OR_RETURN(
           variance,
-          variance_builder_.SetEpsilon(AlgorithmBuilder::GetEpsilon().value())
+          variance_builder_
+              .SetEpsilon(BoundedBuilder::GetRemainingEpsilon().value())
               .SetLaplaceMechanism(std::move(mech_builder))
               .Build());
 
       return absl::WrapUnique(new BoundedStandardDeviation(
-          AlgorithmBuilder::GetEpsilon().value(), std::move(variance)));
+          BoundedBuilder::GetRemainingEpsilon().value(), std::move(variance)));
     }
 
     typename BoundedVariance<T>::Builder variance_builder_;
@@ -114,9 +114,11 @@ class BoundedSum : public Algorithm<T> {
 
       // Find partial sums.
       if (t >= 0) {
-        approx_bounds_->template AddToPartialSums<T>(&pos_sum_, t);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &pos_binned_sum_, t, 1);
       } else {
-        approx_bounds_->template AddToPartialSums<T>(&neg_sum_, t);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &neg_binned_sum_, t, 1);
       }
     }
   }
@@ -139,12 +141,8 @@ class BoundedSum : public Algorithm<T> {
   Summary Serialize() override {
     // Create BoundedSumSummary.
     BoundedSumSummary bs_summary;
-    for (T x : pos_sum_) {
-      SetValue(bs_summary.add_pos_sum(), x);
-    }
-    for (T x : neg_sum_) {
-      SetValue(bs_summary.add_neg_sum(), x);
-    }
+    SetPackedValues(PartialSums(true), bs_summary.mutable_packed_pos_sum());
+    SetPackedValues(PartialSums(false), bs_summary.mutable_packed_neg_sum());
     if (approx_bounds_) {
       Summary approx_bounds_summary = approx_bounds_->Serialize();
       approx_bounds_summary.data().UnpackTo(
@@ -168,18 +166,25 @@ class BoundedSum : public Algorithm<T> {
     if (!summary.data().UnpackTo(&bs_summary)) {
       return base::InternalError("Bounded sum summary unable to be unpacked.");
     }
-    if (pos_sum_.size() != bs_summary.pos_sum_size() ||
-        neg_sum_.size() != bs_summary.neg_sum_size()) {
+    PackedValues legacy_pos_sum, legacy_neg_sum;
+    const PackedValues& pos_sum = PackedOrLegacy<T>(
+        bs_summary.packed_pos_sum(), bs_summary.pos_sum(), &legacy_pos_sum);
+    const PackedValues& neg_sum = PackedOrLegacy<T>(
+        bs_summary.packed_neg_sum(), bs_summary.neg_sum(), &legacy_neg_sum);
+    int num_pos_sums = PackedValuesSize<T>(pos_sum);
+    int num_neg_sums = PackedValuesSize<T>(neg_sum);
+    if (NumPartialSums(true) != num_pos_sums ||
+        NumPartialSums(false) != num_neg_sums) {
       return base::InternalError(
           "Merged BoundedSum must have the same amount of partial sum "
           "values as this BoundedSum.");
     }
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      SafeAdd(pos_sum_[i], GetValue<T>(bs_summary.pos_sum(i)), &pos_sum_[i]);
-    }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      SafeAdd(neg_sum_[i], GetValue<T>(bs_summary.neg_sum(i)), &neg_sum_[i]);
-    }
+    ForEachPackedValue<T>(pos_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &pos_sum_);
+    });
+    ForEachPackedValue<T>(neg_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &neg_sum_);
+    });
     if (approx_bounds_) {
       Summary approx_bounds_summary;
       approx_bounds_summary.mutable_data()->PackFrom(
@@ -189,6 +194,51 @@ class BoundedSum : public Algorithm<T> {
     return base::OkStatus();
   }
 
+  void WriteBinarySummary(BinarySummaryWriter* writer) override {
+    writer->WriteHeader(BinarySummaryType::kBoundedSum);
+    writer->WriteValues(PartialSums(true));
+    writer->WriteValues(PartialSums(false));
+    writer->WriteBool(approx_bounds_ != nullptr);
+    if (approx_bounds_) {
+      approx_bounds_->WriteBinarySummary(writer);
+    }
+  }
+
+  base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) override {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kBoundedSum));
+    BinaryValues<T> pos_sum;
+    BinaryValues<T> neg_sum;
+    bool has_bounds;
+    if (!reader->ReadValues(&pos_sum) || !reader->ReadValues(&neg_sum) ||
+        !reader->ReadBool(&has_bounds)) {
+      return MalformedBinarySummaryError();
+    }
+    if (NumPartialSums(true) != pos_sum.size() ||
+        NumPartialSums(false) != neg_sum.size() ||
+        (approx_bounds_ != nullptr) != has_bounds) {
+      return base::InternalError(
+          "Merged BoundedSum must have the same amount of partial sum "
+          "values as this BoundedSum.");
+    }
+    BinarySummaryMerge merge_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(merge_bounds, approx_bounds_->ReadBinarySummary(reader));
+    }
+    return BinarySummaryMerge([this, pos_sum, neg_sum, merge_bounds]() {
+      if (merge_bounds) {
+        RETURN_IF_ERROR(merge_bounds());
+      }
+      pos_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &pos_sum_);
+      });
+      neg_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &neg_sum_);
+      });
+      return base::OkStatus();
+    });
+  }
+
   double GetEpsilon() const override {
     if (approx_bounds_) {
       return approx_bounds_->GetEpsilon() + Algorithm<T>::GetEpsilon();
@@ -212,6 +262,7 @@ class BoundedSum : public Algorithm<T> {
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedSum<T>) +
                    sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity());
+    memory += pos_binned_sum_.MemoryUsed() + neg_binned_sum_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
@@ -240,11 +291,11 @@ class BoundedSum : public Algorithm<T> {
         mechanism_(std::move(mechanism)),
         approx_bounds_(std::move(approx_bounds)) {
     // If automatically determining bounds, we need partial values for each bin
-    // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
-    // store one already-clamped value.
+    // of the ApproxBounds logarithmic histogram, which are allocated as they
+    // are needed. Otherwise, we only need to store one already-clamped value.
     if (approx_bounds_) {
-      pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
-      neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
+      pos_binned_sum_ = BinnedPartials<T>(approx_bounds_->NumPositiveBins());
+      neg_binned_sum_ = BinnedPartials<T>(approx_bounds_->NumPositiveBins());
     } else {
       pos_sum_.push_back(0);
     }
@@ -279,7 +330,8 @@ class BoundedSum : public Algorithm<T> {
       // To find the sum, pass the identity function as the transform. We pass
       // count = 0 because the count should never be used.
       sum = approx_bounds_->template ComputeFromPartials<T>(
-          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_, 0);
+          PartialSums(true), PartialSums(false), [](T x) { return x; }, lower_,
+          upper_, 0);
 
       // Populate the bounding report with ApproxBounds information.
       *(output.mutable_error_report()->mutable_bounding_report()) =
@@ -326,12 +378,46 @@ class BoundedSum : public Algorithm<T> {
     std::fill(pos_sum_.begin(), pos_sum_.end(), 0);
     std::fill(neg_sum_.begin(), neg_sum_.end(), 0);
     if (approx_bounds_) {
+      pos_sum_.clear();
+      neg_sum_.clear();
+      pos_binned_sum_.Clear();
+      neg_binned_sum_.Clear();
       approx_bounds_->Reset();
       mechanism_ = nullptr;
     }
   }
 
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other is a BoundedSum.
+    return MergeSum(static_cast<const BoundedSum<T>&>(other));
+  }
+
+  base::Status MergeAlgorithm(Algorithm<T>&& other) override {
+    return MergeSum(static_cast<BoundedSum<T>&&>(other));
+  }
+
  private:
+  // Merges sum, whose state is copied if it is an lvalue and moved otherwise.
+  template <typename Sum>
+  base::Status MergeSum(Sum&& sum) {
+    if ((approx_bounds_ != nullptr) != (sum.approx_bounds_ != nullptr) ||
+        (!approx_bounds_ &&
+         (lower_ != sum.lower_ || upper_ != sum.upper_))) {
+      return base::InternalError(
+          "Merged BoundedSum must have the same bounds as this BoundedSum.");
+    }
+    // The bounds are merged first, since merging them may still fail.
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(approx_bounds_->MergeAlgorithm(
+          ForwardMember<Sum>(*sum.approx_bounds_)));
+      pos_binned_sum_.Add(ForwardMember<Sum>(sum.pos_binned_sum_));
+      neg_binned_sum_.Add(ForwardMember<Sum>(sum.neg_binned_sum_));
+    }
+    AddLazyPartials(ForwardMember<Sum>(sum.pos_sum_), &pos_sum_);
+    AddLazyPartials(ForwardMember<Sum>(sum.neg_sum_), &neg_sum_);
+    return base::OkStatus();
+  }
+
   base::StatusOr<ConfidenceInterval> NoiseConfidenceIntervalImpl(
       double confidence_level, double privacy_budget = 1) {
     if (!mechanism_) {
@@ -355,9 +441,35 @@ class BoundedSum : public Algorithm<T> {
         .Build();
   }
 
-  // Vectors of partial values stored for automatic clamping.
+  // Returns the number of positive or negative partial sums.
+  int NumPartialSums(bool positive) {
+    if (approx_bounds_) {
+      return approx_bounds_->NumPositiveBins();
+    }
+    return positive ? 1 : 0;
+  }
+
+  // Returns the positive or negative partial sums of all entries, merged and
+  // added ones.
+  std::vector<T> PartialSums(bool positive) {
+    std::vector<T> sums = positive ? pos_sum_ : neg_sum_;
+    if (approx_bounds_) {
+      sums.resize(NumPartialSums(positive), 0);
+      approx_bounds_->AddBinnedPartialSums(
+          positive ? pos_binned_sum_ : neg_binned_sum_, positive, &sums);
+    }
+    return sums;
+  }
+
+  // Vectors of partial values stored for automatic clamping. With automatic
+  // bounds, these only hold merged partial sums and are empty until a summary
+  // with nonzero partial sums is merged.
   std::vector<T> pos_sum_, neg_sum_;
 
+  // Partial sums of the added entries for automatic clamping, which keeps
+  // adding an entry constant time and only allocates bins holding entries.
+  BinnedPartials<T> pos_binned_sum_, neg_binned_sum_;
+
   // If manually set, these values are determined upon construction. Otherwise,
   // they are found in GenerateResult().
   T lower_, upper_;
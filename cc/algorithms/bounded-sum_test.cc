@@ -34,6 +34,8 @@ using ::differential_privacy::test_utils::ZeroNoiseMechanism;
 using ::testing::Eq;
 using ::differential_privacy::base::testing::EqualsProto;
 using ::differential_privacy::base::testing::IsOkAndHolds;
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
 
 constexpr double kNumSamples = 10000;
 
@@ -308,6 +310,157 @@ TYPED_TEST(BoundedSumTest, SerializeMergePartialSumsTest) {
   EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
 }
 
+TYPED_TEST(BoundedSumTest, BinarySerializeMergePartialSumsTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedSum<TypeParam>::Builder builder;
+
+  // BoundedSums have automatic bounding, so entries will be split and stored as
+  // partial sums.
+  auto bounds1 =
+      bounds_builder.SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds1);
+  auto bs1 =
+      builder
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetApproxBounds(std::move(*bounds1))
+          .Build();
+  ASSERT_OK(bs1);
+  (*bs1)->AddEntry(-10);
+  (*bs1)->AddEntry(4);
+  std::string summary;
+  (*bs1)->SerializeToBinary(&summary);
+  (*bs1)->AddEntry(6);
+
+  // Merge summary into second BoundedVariance.
+  auto bounds2 = bounds_builder.Build();
+  ASSERT_OK(bounds2);
+  auto bs2 = builder.SetApproxBounds(std::move(*bounds2)).Build();
+  ASSERT_OK(bs2);
+  (*bs2)->AddEntry(6);
+  // A summary with trailing bytes is rejected without merging any of it,
+  // including the nested ApproxBounds.
+  EXPECT_THAT((*bs2)->MergeFromBinary(summary + "x"),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("malformed")));
+  EXPECT_OK((*bs2)->MergeFromBinary(summary));
+
+  // Check equality. Bounds are set to [-16, 16].
+  auto output1 = (*bs1)->PartialResult();
+  ASSERT_OK(output1);
+  auto output2 = (*bs2)->PartialResult();
+  ASSERT_OK(output2);
+  EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
+}
+
+TYPED_TEST(BoundedSumTest, MergeFromPartialSumsTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedSum<TypeParam>::Builder builder;
+  bounds_builder.SetThreshold(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  // Automatic bounding, so entries are merged as partial sums.
+  std::vector<std::unique_ptr<BoundedSum<TypeParam>>> sums;
+  for (int i = 0; i < 6; ++i) {
+    auto bounds = bounds_builder.Build();
+    ASSERT_OK(bounds);
+    auto sum = builder.SetApproxBounds(std::move(*bounds)).Build();
+    ASSERT_OK(sum);
+    sums.push_back(std::move(*sum));
+  }
+  sums[0]->AddEntry(6);
+  sums[1]->AddEntry(-10);
+  sums[2]->AddEntry(4);
+  for (TypeParam entry : {6, -10, 4}) {
+    sums[3]->AddEntry(entry);
+  }
+  sums[4]->AddEntry(-10);
+  sums[5]->AddEntry(5);
+  const BoundedSum<TypeParam>& copied_sum = *sums[1];
+  EXPECT_OK(sums[0]->MergeFrom(copied_sum));
+  EXPECT_OK(sums[0]->MergeFrom(std::move(*sums[2])));
+
+  auto merged = sums[0]->PartialResult();
+  ASSERT_OK(merged);
+  auto expected = sums[3]->PartialResult();
+  ASSERT_OK(expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*merged), GetValue<double>(*expected));
+
+  // The copied BoundedSum is unchanged, and the moved one is reset.
+  auto copied = sums[1]->PartialResult();
+  ASSERT_OK(copied);
+  auto copied_expected = sums[4]->PartialResult();
+  ASSERT_OK(copied_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*copied),
+                   GetValue<double>(*copied_expected));
+  sums[2]->AddEntry(5);
+  auto moved = sums[2]->PartialResult();
+  ASSERT_OK(moved);
+  auto moved_expected = sums[5]->PartialResult();
+  ASSERT_OK(moved_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*moved), GetValue<double>(*moved_expected));
+}
+
+TYPED_TEST(BoundedSumTest, MergeFromRejectsDifferentBounds) {
+  typename BoundedSum<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto sum1 = builder.SetLower(0).SetUpper(10).Build();
+  ASSERT_OK(sum1);
+  auto sum2 = builder.SetLower(0).SetUpper(20).Build();
+  ASSERT_OK(sum2);
+  EXPECT_THAT((*sum1)->MergeFrom(**sum2),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("same bounds")));
+  EXPECT_THAT((*sum1)->MergeFrom(**sum1),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("itself")));
+}
+
+TYPED_TEST(BoundedSumTest, MergeLegacySummaryTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedSum<TypeParam>::Builder builder;
+  auto bounds1 =
+      bounds_builder.SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds1);
+  auto bs1 =
+      builder
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetApproxBounds(std::move(*bounds1))
+          .Build();
+  ASSERT_OK(bs1);
+  (*bs1)->AddEntry(-10);
+  (*bs1)->AddEntry(4);
+
+  // Rewrite the summary in the repeated ValueType encoding of older versions.
+  BoundedSumSummary bs_summary;
+  ASSERT_TRUE((*bs1)->Serialize().data().UnpackTo(&bs_summary));
+  ForEachPackedValue<TypeParam>(bs_summary.packed_pos_sum(),
+                                [&bs_summary](int64_t i, TypeParam x) {
+                                  SetValue(bs_summary.add_pos_sum(), x);
+                                });
+  ForEachPackedValue<TypeParam>(bs_summary.packed_neg_sum(),
+                                [&bs_summary](int64_t i, TypeParam x) {
+                                  SetValue(bs_summary.add_neg_sum(), x);
+                                });
+  bs_summary.clear_packed_pos_sum();
+  bs_summary.clear_packed_neg_sum();
+  Summary summary;
+  summary.mutable_data()->PackFrom(bs_summary);
+
+  auto bounds2 = bounds_builder.Build();
+  ASSERT_OK(bounds2);
+  auto bs2 = builder.SetApproxBounds(std::move(*bounds2)).Build();
+  ASSERT_OK(bs2);
+  EXPECT_OK((*bs2)->Merge(summary));
+
+  auto output1 = (*bs1)->PartialResult();
+  ASSERT_OK(output1);
+  auto output2 = (*bs2)->PartialResult();
+  ASSERT_OK(output2);
+  EXPECT_EQ(GetValue<TypeParam>(*output1), GetValue<TypeParam>(*output2));
+}
+
 TEST(BoundedSumTest, OverflowAddEntryManualBounds) {
   typename BoundedSum<int64_t>::Builder builder;
 
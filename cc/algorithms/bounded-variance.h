@@ -162,16 +162,12 @@ class BoundedVariance : public Algorithm<T> {
     // Create BoundedVarianceSummary.
     BoundedVarianceSummary bv_summary;
     bv_summary.set_count(raw_count_);
-    for (T x : pos_sum_) {
-      SetValue(bv_summary.add_pos_sum(), x);
-    }
-    for (T x : neg_sum_) {
-      SetValue(bv_summary.add_neg_sum(), x);
-    }
-    for (double x : pos_sum_of_squares_) {
+    SetPackedValues(PartialSums(true), bv_summary.mutable_packed_pos_sum());
+    SetPackedValues(PartialSums(false), bv_summary.mutable_packed_neg_sum());
+    for (double x : PartialSumsOfSquares(true)) {
       bv_summary.add_pos_sum_of_squares(x);
     }
-    for (double x : neg_sum_of_squares_) {
+    for (double x : PartialSumsOfSquares(false)) {
       bv_summary.add_neg_sum_of_squares(x);
     }
     if (approx_bounds_) {
@@ -202,10 +198,16 @@ class BoundedVariance : public Algorithm<T> {
       return base::InternalError(
           "Merged BoundedVariance must have the same bounding strategy.");
     }
-    if (pos_sum_.size() != bv_summary.pos_sum_size() ||
-        neg_sum_.size() != bv_summary.neg_sum_size() ||
-        pos_sum_of_squares_.size() != bv_summary.pos_sum_of_squares_size() ||
-        neg_sum_of_squares_.size() != bv_summary.neg_sum_of_squares_size()) {
+    PackedValues legacy_pos_sum, legacy_neg_sum;
+    const PackedValues& pos_sum = PackedOrLegacy<T>(
+        bv_summary.packed_pos_sum(), bv_summary.pos_sum(), &legacy_pos_sum);
+    const PackedValues& neg_sum = PackedOrLegacy<T>(
+        bv_summary.packed_neg_sum(), bv_summary.neg_sum(), &legacy_neg_sum);
+    int num_pos = PackedValuesSize<T>(pos_sum);
+    int num_neg = PackedValuesSize<T>(neg_sum);
+    if (NumPartials(true) != num_pos || NumPartials(false) != num_neg ||
+        NumPartials(true) != bv_summary.pos_sum_of_squares_size() ||
+        NumPartials(false) != bv_summary.neg_sum_of_squares_size()) {
       return base::InternalError(
           "Merged BoundedVariance must have the same amount of partial "
           "sum or sum of squares values as this BoundedVariance.");
@@ -213,13 +215,19 @@ class BoundedVariance : public Algorithm<T> {
 
     // Add count and partial values to current ones.
     SafeAdd(raw_count_, bv_summary.count(), &raw_count_);
-    for (int i = 0; i < pos_sum_.size(); ++i) {
-      SafeAdd(pos_sum_[i], GetValue<T>(bv_summary.pos_sum(i)), &pos_sum_[i]);
-      pos_sum_of_squares_[i] += bv_summary.pos_sum_of_squares(i);
+    ForEachPackedValue<T>(pos_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &pos_sum_);
+    });
+    ForEachPackedValue<T>(neg_sum, [this](int i, T x) {
+      AddToLazyPartials(x, i, &neg_sum_);
+    });
+    for (int i = 0; i < num_pos; ++i) {
+      AddToLazyPartials(bv_summary.pos_sum_of_squares(i), i,
+                        &pos_sum_of_squares_);
     }
-    for (int i = 0; i < neg_sum_.size(); ++i) {
-      SafeAdd(neg_sum_[i], GetValue<T>(bv_summary.neg_sum(i)), &neg_sum_[i]);
-      neg_sum_of_squares_[i] += bv_summary.neg_sum_of_squares(i);
+    for (int i = 0; i < num_neg; ++i) {
+      AddToLazyPartials(bv_summary.neg_sum_of_squares(i), i,
+                        &neg_sum_of_squares_);
     }
 
     // Merge approx bounds if auto-clamping.
@@ -233,11 +241,82 @@ class BoundedVariance : public Algorithm<T> {
     return base::OkStatus();
   }
 
+  void WriteBinarySummary(BinarySummaryWriter* writer) override {
+    writer->WriteHeader(BinarySummaryType::kBoundedVariance);
+    writer->WriteVarint(raw_count_);
+    writer->WriteValues(PartialSums(true));
+    writer->WriteValues(PartialSums(false));
+    writer->WriteValues(PartialSumsOfSquares(true));
+    writer->WriteValues(PartialSumsOfSquares(false));
+    writer->WriteBool(approx_bounds_ != nullptr);
+    if (approx_bounds_) {
+      approx_bounds_->WriteBinarySummary(writer);
+    }
+  }
+
+  base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) override {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kBoundedVariance));
+    uint64_t count;
+    BinaryValues<T> pos_sum;
+    BinaryValues<T> neg_sum;
+    BinaryValues<double> pos_sum_of_squares;
+    BinaryValues<double> neg_sum_of_squares;
+    bool has_bounds;
+    if (!reader->ReadVarint(&count) || !reader->ReadValues(&pos_sum) ||
+        !reader->ReadValues(&neg_sum) ||
+        !reader->ReadValues(&pos_sum_of_squares) ||
+        !reader->ReadValues(&neg_sum_of_squares) ||
+        !reader->ReadBool(&has_bounds)) {
+      return MalformedBinarySummaryError();
+    }
+    if ((approx_bounds_ != nullptr) != has_bounds) {
+      return base::InternalError(
+          "Merged BoundedVariance must have the same bounding strategy.");
+    }
+    if (NumPartials(true) != pos_sum.size() ||
+        NumPartials(false) != neg_sum.size() ||
+        NumPartials(true) != pos_sum_of_squares.size() ||
+        NumPartials(false) != neg_sum_of_squares.size()) {
+      return base::InternalError(
+          "Merged BoundedVariance must have the same amount of partial "
+          "sum or sum of squares values as this BoundedVariance.");
+    }
+    BinarySummaryMerge merge_bounds;
+    if (approx_bounds_) {
+      ASSIGN_OR_RETURN(merge_bounds, approx_bounds_->ReadBinarySummary(reader));
+    }
+    return BinarySummaryMerge([this, count, pos_sum, neg_sum,
+                               pos_sum_of_squares, neg_sum_of_squares,
+                               merge_bounds]() {
+      if (merge_bounds) {
+        RETURN_IF_ERROR(merge_bounds());
+      }
+      SafeAdd(raw_count_, count, &raw_count_);
+      pos_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &pos_sum_);
+      });
+      neg_sum.ForEachNonzero([this](int64_t i, T x) {
+        AddToLazyPartials(x, i, &neg_sum_);
+      });
+      pos_sum_of_squares.ForEachNonzero([this](int64_t i, double x) {
+        AddToLazyPartials(x, i, &pos_sum_of_squares_);
+      });
+      neg_sum_of_squares.ForEachNonzero([this](int64_t i, double x) {
+        AddToLazyPartials(x, i, &neg_sum_of_squares_);
+      });
+      return base::OkStatus();
+    });
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(BoundedVariance<T>) +
                    sizeof(T) * (pos_sum_.capacity() + neg_sum_.capacity()) +
                    sizeof(double) * (pos_sum_of_squares_.capacity() +
                                      neg_sum_of_squares_.capacity());
+    memory += pos_binned_sum_.MemoryUsed() + neg_binned_sum_.MemoryUsed() +
+              pos_binned_sum_of_squares_.MemoryUsed() +
+              neg_binned_sum_of_squares_.MemoryUsed();
     if (approx_bounds_) {
       memory += approx_bounds_->MemoryUsed();
     }
@@ -294,10 +373,11 @@ class BoundedVariance : public Algorithm<T> {
     // of the ApproxBounds logarithmic histogram. Otherwise, we only need to
     // store one already-clamped value.
     if (approx_bounds_) {
-      pos_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
-      neg_sum_.resize(approx_bounds_->NumPositiveBins(), 0);
-      pos_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
-      neg_sum_of_squares_.resize(approx_bounds_->NumPositiveBins(), 0);
+      const int num_bins = approx_bounds_->NumPositiveBins();
+      pos_binned_sum_ = BinnedPartials<T>(num_bins);
+      neg_binned_sum_ = BinnedPartials<T>(num_bins);
+      pos_binned_sum_of_squares_ = BinnedPartials<double>(num_bins);
+      neg_binned_sum_of_squares_ = BinnedPartials<double>(num_bins);
     } else {
       pos_sum_.push_back(0);
       pos_sum_of_squares_.push_back(0);
@@ -328,13 +408,13 @@ class BoundedVariance : public Algorithm<T> {
 
       // To find the sum, pass the identity function as the transform.
       sum = approx_bounds_->template ComputeFromPartials<T>(
-          pos_sum_, neg_sum_, [](T x) { return x; }, lower_, upper_,
-          raw_count_);
+          PartialSums(true), PartialSums(false), [](T x) { return x; }, lower_,
+          upper_, raw_count_);
 
       // To find sum of squares, pass the square function.
       sos = approx_bounds_->template ComputeFromPartials<double>(
-          pos_sum_of_squares_, neg_sum_of_squares_, [](T x) { return x * x; },
-          lower_, upper_, raw_count_);
+          PartialSumsOfSquares(true), PartialSumsOfSquares(false),
+          [](T x) { return x * x; }, lower_, upper_, raw_count_);
 
       // Populate the bounding report with ApproxBounds information.
       *(output.mutable_error_report()->mutable_bounding_report()) =
@@ -417,12 +497,61 @@ class BoundedVariance : public Algorithm<T> {
     raw_count_ = 0;
 
     if (approx_bounds_) {
+      pos_sum_.clear();
+      neg_sum_.clear();
+      pos_sum_of_squares_.clear();
+      neg_sum_of_squares_.clear();
+      pos_binned_sum_.Clear();
+      neg_binned_sum_.Clear();
+      pos_binned_sum_of_squares_.Clear();
+      neg_binned_sum_of_squares_.Clear();
       approx_bounds_->Reset();
       sum_mechanism_ = nullptr;
       sos_mechanism_ = nullptr;
     }
   }
 
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other is a BoundedVariance.
+    return MergeVariance(static_cast<const BoundedVariance<T>&>(other));
+  }
+
+  base::Status MergeAlgorithm(Algorithm<T>&& other) override {
+    return MergeVariance(static_cast<BoundedVariance<T>&&>(other));
+  }
+
+  // Merges variance, whose state is copied if it is an lvalue and moved
+  // otherwise.
+  template <typename Variance>
+  base::Status MergeVariance(Variance&& variance) {
+    if ((approx_bounds_ != nullptr) != (variance.approx_bounds_ != nullptr) ||
+        (!approx_bounds_ &&
+         (lower_ != variance.lower_ || upper_ != variance.upper_))) {
+      return base::InternalError(
+          "Merged BoundedVariance must have the same bounds as this "
+          "BoundedVariance.");
+    }
+    // The bounds are merged first, since merging them may still fail.
+    if (approx_bounds_) {
+      RETURN_IF_ERROR(approx_bounds_->MergeAlgorithm(
+          ForwardMember<Variance>(*variance.approx_bounds_)));
+      pos_binned_sum_.Add(ForwardMember<Variance>(variance.pos_binned_sum_));
+      neg_binned_sum_.Add(ForwardMember<Variance>(variance.neg_binned_sum_));
+      pos_binned_sum_of_squares_.Add(
+          ForwardMember<Variance>(variance.pos_binned_sum_of_squares_));
+      neg_binned_sum_of_squares_.Add(
+          ForwardMember<Variance>(variance.neg_binned_sum_of_squares_));
+    }
+    SafeAdd<uint64_t>(raw_count_, variance.raw_count_, &raw_count_);
+    AddLazyPartials(ForwardMember<Variance>(variance.pos_sum_), &pos_sum_);
+    AddLazyPartials(ForwardMember<Variance>(variance.neg_sum_), &neg_sum_);
+    AddLazyPartials(ForwardMember<Variance>(variance.pos_sum_of_squares_),
+                    &pos_sum_of_squares_);
+    AddLazyPartials(ForwardMember<Variance>(variance.neg_sum_of_squares_),
+                    &neg_sum_of_squares_);
+    return base::OkStatus();
+  }
+
   static double IntervalLengthSquared(T lower, T upper) {
     return std::pow(static_cast<double>(upper - lower), 2);
   }
@@ -492,21 +621,16 @@ class BoundedVariance : public Algorithm<T> {
       approx_bounds_->AddMultipleEntries(t, num_of_entries);
 
       // Add to partial sums and sum of squares.
-      auto difference_of_squares = [](T val1, T val2) {
-        // Lessen the chance of becoming inf/-inf by calculating it like this.
-        return (static_cast<double>(val1) + val2) *
-               (static_cast<double>(val1) - val2);
-      };
       if (t >= 0) {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &pos_sum_, t, num_of_entries);
-        approx_bounds_->template AddMultipleEntriesToPartials<double>(
-            &pos_sum_of_squares_, t, num_of_entries, difference_of_squares);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &pos_binned_sum_, t, num_of_entries);
+        approx_bounds_->AddMultipleEntriesToBinnedPartialSumsOfSquares(
+            &pos_binned_sum_of_squares_, t, num_of_entries);
       } else {
-        approx_bounds_->template AddMultipleEntriesToPartialSums<T>(
-            &neg_sum_, t, num_of_entries);
-        approx_bounds_->template AddMultipleEntriesToPartials<double>(
-            &neg_sum_of_squares_, t, num_of_entries, difference_of_squares);
+        approx_bounds_->template AddMultipleEntriesToBinnedPartialSums<T>(
+            &neg_binned_sum_, t, num_of_entries);
+        approx_bounds_->AddMultipleEntriesToBinnedPartialSumsOfSquares(
+            &neg_binned_sum_of_squares_, t, num_of_entries);
       }
     }
   }
@@ -532,9 +656,51 @@ class BoundedVariance : public Algorithm<T> {
   // Friend class for testing only
   friend class BoundedVarianceTestPeer;
 
-  // Vectors of partial values stored for automatic clamping.
+  // Returns the number of positive or negative partial values.
+  int NumPartials(bool positive) {
+    if (approx_bounds_) {
+      return approx_bounds_->NumPositiveBins();
+    }
+    return positive ? 1 : 0;
+  }
+
+  // Returns the positive or negative partial sums of all entries, merged and
+  // added ones.
+  std::vector<T> PartialSums(bool positive) {
+    std::vector<T> sums = positive ? pos_sum_ : neg_sum_;
+    if (approx_bounds_) {
+      sums.resize(NumPartials(positive), 0);
+      approx_bounds_->AddBinnedPartialSums(
+          positive ? pos_binned_sum_ : neg_binned_sum_, positive, &sums);
+    }
+    return sums;
+  }
+
+  // Returns the positive or negative partial sums of squares of all entries,
+  // merged and added ones.
+  std::vector<double> PartialSumsOfSquares(bool positive) {
+    std::vector<double> sums_of_squares =
+        positive ? pos_sum_of_squares_ : neg_sum_of_squares_;
+    if (approx_bounds_) {
+      sums_of_squares.resize(NumPartials(positive), 0);
+      approx_bounds_->AddBinnedPartialSumsOfSquares(
+          positive ? pos_binned_sum_of_squares_ : neg_binned_sum_of_squares_,
+          positive, &sums_of_squares);
+    }
+    return sums_of_squares;
+  }
+
+  // Vectors of partial values stored for automatic clamping. With automatic
+  // bounds, these only hold merged partial values and are empty until a
+  // summary with nonzero partial values is merged.
   std::vector<T> pos_sum_, neg_sum_;
   std::vector<double> pos_sum_of_squares_, neg_sum_of_squares_;
+
+  // Partials of the added entries for automatic clamping, which keeps adding
+  // an entry constant time and only allocates bins holding entries.
+  BinnedPartials<T> pos_binned_sum_, neg_binned_sum_;
+  BinnedPartials<double> pos_binned_sum_of_squares_,
+      neg_binned_sum_of_squares_;
   uint64_t raw_count_;
   T lower_, upper_;
 
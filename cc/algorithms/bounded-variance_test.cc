@@ -359,6 +359,107 @@ TYPED_TEST(BoundedVarianceTest, SerializeMergePartialValuesTest) {
   EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
 }
 
+TYPED_TEST(BoundedVarianceTest, BinarySerializeMergePartialValuesTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedVariance<TypeParam>::Builder builder;
+
+  // Automatic bounding, so entries will be split and stored as partials.
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds1 =
+      bounds_builder.SetThreshold(1)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(bounds1);
+  base::StatusOr<std::unique_ptr<BoundedVariance<TypeParam>>> bv1 =
+      builder
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetApproxBounds(std::move(*bounds1))
+          .Build();
+  ASSERT_OK(bv1);
+  (*bv1)->AddEntry(-10);
+  (*bv1)->AddEntry(4);
+  std::string summary;
+  (*bv1)->SerializeToBinary(&summary);
+  (*bv1)->AddEntry(6);
+
+  // Merge summary into second BoundedVariance.
+  base::StatusOr<std::unique_ptr<ApproxBounds<TypeParam>>> bounds2 =
+      bounds_builder.Build();
+  ASSERT_OK(bounds2);
+  base::StatusOr<std::unique_ptr<BoundedVariance<TypeParam>>> bv2 =
+      builder.SetApproxBounds(std::move(*bounds2)).Build();
+  ASSERT_OK(bv2);
+  (*bv2)->AddEntry(6);
+  EXPECT_OK((*bv2)->MergeFromBinary(summary));
+
+  // Check equality. Bounds are set to [-16, 8].
+  base::StatusOr<Output> result1 = (*bv1)->PartialResult();
+  ASSERT_OK(result1);
+  base::StatusOr<Output> result2 = (*bv2)->PartialResult();
+  ASSERT_OK(result2);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*result1), GetValue<double>(*result2));
+}
+
+TYPED_TEST(BoundedVarianceTest, MergeFromPartialValuesTest) {
+  typename ApproxBounds<TypeParam>::Builder bounds_builder;
+  typename BoundedVariance<TypeParam>::Builder builder;
+  bounds_builder.SetThreshold(1).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+
+  // Automatic bounding, so entries are merged as partial values.
+  std::vector<std::unique_ptr<BoundedVariance<TypeParam>>> variances;
+  for (int i = 0; i < 6; ++i) {
+    auto bounds = bounds_builder.Build();
+    ASSERT_OK(bounds);
+    auto variance = builder.SetApproxBounds(std::move(*bounds)).Build();
+    ASSERT_OK(variance);
+    variances.push_back(std::move(*variance));
+  }
+  variances[0]->AddEntry(6);
+  variances[1]->AddEntry(-10);
+  variances[2]->AddEntry(4);
+  for (TypeParam entry : {6, -10, 4}) {
+    variances[3]->AddEntry(entry);
+  }
+  variances[4]->AddEntry(-10);
+  variances[5]->AddEntry(5);
+  EXPECT_OK(variances[0]->MergeFrom(*variances[1]));
+  EXPECT_OK(variances[0]->MergeFrom(std::move(*variances[2])));
+
+  auto merged = variances[0]->PartialResult();
+  ASSERT_OK(merged);
+  auto expected = variances[3]->PartialResult();
+  ASSERT_OK(expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*merged), GetValue<double>(*expected));
+
+  // The copied BoundedVariance is unchanged, and the moved one is reset.
+  auto copied = variances[1]->PartialResult();
+  ASSERT_OK(copied);
+  auto copied_expected = variances[4]->PartialResult();
+  ASSERT_OK(copied_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*copied),
+                   GetValue<double>(*copied_expected));
+  variances[2]->AddEntry(5);
+  auto moved = variances[2]->PartialResult();
+  ASSERT_OK(moved);
+  auto moved_expected = variances[5]->PartialResult();
+  ASSERT_OK(moved_expected);
+  EXPECT_DOUBLE_EQ(GetValue<double>(*moved), GetValue<double>(*moved_expected));
+}
+
+TYPED_TEST(BoundedVarianceTest, MergeFromRejectsDifferentBounds) {
+  typename BoundedVariance<TypeParam>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto variance1 = builder.SetLower(0).SetUpper(10).Build();
+  ASSERT_OK(variance1);
+  auto variance2 = builder.SetLower(0).SetUpper(20).Build();
+  ASSERT_OK(variance2);
+  EXPECT_THAT((*variance1)->MergeFrom(**variance2),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("same bounds")));
+  EXPECT_THAT((*variance1)->MergeFrom(**variance1),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("itself")));
+}
+
 TEST(BoundedVarianceTest, OverflowRawCountTest) {
   typename BoundedVariance<double>::Builder builder;
 
@@ -0,0 +1,376 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/status.h"
+#include "base/statusor.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/partitioned-aggregator.h"
+#include "algorithms/rand.h"
+#include "base/canonical_errors.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Bounds the contributions of each privacy unit in a stream of entries, so
+// that the bounded entries can be added to algorithms built with the same
+// MaxPartitionsContributed and MaxContributionsPerPartition.
+//
+// For each privacy unit, a uniformly random sample of at most
+// MaxPartitionsContributed of its partitions is kept, and for each kept
+// partition, a uniformly random sample of at most MaxContributionsPerPartition
+// of its entries. Partitions are sampled by keeping those with the smallest
+// priorities, a keyed hash of the privacy unit and partition, so that a
+// privacy unit only needs state for its sampled partitions. Entries are
+// sampled with reservoir sampling. The state of a privacy unit therefore never
+// holds more than MaxPartitionsContributed * MaxContributionsPerPartition
+// entries.
+//
+// If a spill directory is set, entries are not bounded as they are added, but
+// appended to one of several spill files by a hash of their privacy unit. When
+// the bounded entries are requested, the files are bounded one at a time, so
+// that only the state of the privacy units of a single file is in memory.
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class ContributionBounder {
+ public:
+  class Builder {
+   public:
+    Builder& SetMaxPartitionsContributed(int max_partitions) {
+      max_partitions_contributed_ = max_partitions;
+      return *this;
+    }
+
+    Builder& SetMaxContributionsPerPartition(int max_contributions) {
+      max_contributions_per_partition_ = max_contributions;
+      return *this;
+    }
+
+    // Spills the entries to files in directory instead of bounding them in
+    // memory. The files are removed when the bounder is destroyed.
+    Builder& SetSpillDirectory(std::string directory) {
+      spill_directory_ = std::move(directory);
+      return *this;
+    }
+
+    // Number of files to spill to. Bounding in memory needs about this many
+    // times less memory with spilling than without.
+    Builder& SetNumSpillFiles(int num_files) {
+      num_spill_files_ = num_files;
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<ContributionBounder<T>>> Build() {
+      if (max_partitions_contributed_ <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Max number of partitions a user can contribute to has to be"
+            " positive, but is ",
+            max_partitions_contributed_));
+      }
+      if (max_contributions_per_partition_ <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Max contributions per partition has to be positive, but is ",
+            max_contributions_per_partition_));
+      }
+      if (num_spill_files_ <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Number of spill files has to be positive, but is ",
+            num_spill_files_));
+      }
+      auto bounder = absl::WrapUnique(new ContributionBounder<T>(
+          max_partitions_contributed_, max_contributions_per_partition_));
+      if (spill_directory_.has_value()) {
+        RETURN_IF_ERROR(bounder->OpenSpillFiles(spill_directory_.value(),
+                                                num_spill_files_));
+      }
+      return bounder;
+    }
+
+   private:
+    int max_partitions_contributed_ = 1;
+    int max_contributions_per_partition_ = 1;
+    absl::optional<std::string> spill_directory_;
+    int num_spill_files_ = 64;
+  };
+
+  // The bounder owns its spill files and removes them when destroyed.
+  ContributionBounder(const ContributionBounder&) = delete;
+  ContributionBounder& operator=(const ContributionBounder&) = delete;
+
+  ~ContributionBounder() {
+    for (SpillFile& spill_file : spill_files_) {
+      if (spill_file.file != nullptr) {
+        std::fclose(spill_file.file);
+      }
+      std::remove(spill_file.path.c_str());
+    }
+  }
+
+  // Adds an entry of privacy_unit to partition. Errors writing to the spill
+  // files are returned by ForEachBoundedEntry().
+  void AddEntry(int64_t privacy_unit, int64_t partition, T entry) {
+    if (spill_files_.empty()) {
+      SampleEntry(privacy_unit, partition, entry);
+      return;
+    }
+    if (!status_.ok()) {
+      return;
+    }
+    SpillFile& spill_file =
+        spill_files_[Mix(privacy_unit ^ seed_) % spill_files_.size()];
+    char record[kSpillRecordSize];
+    EncodeSpillRecord(privacy_unit, partition, entry, record);
+    if (spill_file.file == nullptr ||
+        std::fwrite(record, kSpillRecordSize, 1, spill_file.file) != 1) {
+      status_ = base::InternalError(
+          absl::StrCat("Unable to write spill file ", spill_file.path, "."));
+    }
+  }
+
+  // Calls add_entry(partition, entry, new_privacy_unit) for each of the bounded
+  // entries, in no particular order, and clears the bounder. new_privacy_unit
+  // is set on exactly one of the entries of each privacy unit and partition.
+  // Returns the first error of writing or reading the spill files, if any.
+  //
+  // When spilling, the files are bounded and emitted one at a time, so this is
+  // not atomic: an error partway through is returned after the entries of the
+  // earlier files have been passed to add_entry, and may leave some samples of
+  // the failed file in memory. The bounder then keeps returning the error.
+  template <typename AddEntryFn>
+  base::Status ForEachBoundedEntry(AddEntryFn add_entry) {
+    RETURN_IF_ERROR(status_);
+    if (spill_files_.empty()) {
+      EmitSamples(add_entry);
+      return base::OkStatus();
+    }
+    std::vector<char> records(kSpillReadBatch * kSpillRecordSize);
+    for (SpillFile& spill_file : spill_files_) {
+      if (spill_file.file == nullptr || std::fflush(spill_file.file) != 0 ||
+          std::fseek(spill_file.file, 0, SEEK_SET) != 0) {
+        status_ = base::InternalError(
+            absl::StrCat("Unable to read spill file ", spill_file.path, "."));
+        return status_;
+      }
+      size_t num_read;
+      do {
+        num_read = std::fread(records.data(), kSpillRecordSize,
+                              kSpillReadBatch, spill_file.file);
+        for (size_t i = 0; i < num_read; ++i) {
+          DecodeAndSampleEntry(records.data() + i * kSpillRecordSize);
+        }
+      } while (num_read == kSpillReadBatch);
+      if (std::ferror(spill_file.file)) {
+        status_ = base::InternalError(
+            absl::StrCat("Unable to read spill file ", spill_file.path, "."));
+        return status_;
+      }
+      EmitSamples(add_entry);
+      // Truncates the file for reuse.
+      std::fclose(spill_file.file);
+      spill_file.file = std::fopen(spill_file.path.c_str(), "w+b");
+      if (spill_file.file == nullptr) {
+        status_ = base::InternalError(absl::StrCat(
+            "Unable to reopen spill file ", spill_file.path, "."));
+        return status_;
+      }
+    }
+    return base::OkStatus();
+  }
+
+  // Adds the bounded entries to aggregator.
+  base::Status AddBoundedEntriesTo(PartitionedAggregator<T>* aggregator) {
+    return ForEachBoundedEntry(
+        [aggregator](int64_t partition, T entry, bool new_privacy_unit) {
+          aggregator->AddEntry(partition, entry, new_privacy_unit);
+        });
+  }
+
+  // Adds the bounded entries of all partitions to algorithm, e.g., to bound
+  // the contributions to a single aggregate of entries with equal partitions.
+  base::Status AddBoundedEntriesTo(Algorithm<T>* algorithm) {
+    return ForEachBoundedEntry(
+        [algorithm](int64_t, T entry, bool) { algorithm->AddEntry(entry); });
+  }
+
+  // Number of privacy units in memory.
+  int64_t NumPrivacyUnits() const { return samples_.size(); }
+
+ private:
+  // Number of spilled entries read at a time.
+  static constexpr size_t kSpillReadBatch = 4096;
+
+  // A spilled entry holds the privacy unit, the partition and the entry. The
+  // fields are copied one by one, so that no padding is written to the files.
+  static constexpr size_t kSpillRecordSize = 2 * sizeof(int64_t) + sizeof(T);
+
+  // A partition of a privacy unit and a sample of its entries.
+  struct PartitionSample {
+    int64_t partition;
+    uint64_t priority;
+    // Number of entries seen, of which entries holds a uniform sample.
+    int64_t num_entries;
+    absl::InlinedVector<T, 1> entries;
+  };
+
+  // Most privacy units contribute to a single partition, which is then stored
+  // without allocations.
+  using PartitionSamples = absl::InlinedVector<PartitionSample, 1>;
+
+  struct SpillFile {
+    std::string path;
+    FILE* file = nullptr;
+  };
+
+  ContributionBounder(int max_partitions_contributed,
+                      int max_contributions_per_partition)
+      : max_partitions_contributed_(max_partitions_contributed),
+        max_contributions_per_partition_(max_contributions_per_partition),
+        seed_(SecureURBG::GetSingleton()()) {}
+
+  // The finalizer of SplitMix64, which maps nearby values to unrelated ones.
+  static uint64_t Mix(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+  }
+
+  base::Status OpenSpillFiles(const std::string& directory, int num_files) {
+    for (int i = 0; i < num_files; ++i) {
+      spill_files_.emplace_back();
+      SpillFile& spill_file = spill_files_.back();
+      spill_file.path =
+          absl::StrCat(directory, "/contributions-", seed_, "-", i);
+      spill_file.file = std::fopen(spill_file.path.c_str(), "w+b");
+      if (spill_file.file == nullptr) {
+        return base::InternalError(absl::StrCat(
+            "Unable to open spill file ", spill_file.path, "."));
+      }
+    }
+    return base::OkStatus();
+  }
+
+  static void EncodeSpillRecord(int64_t privacy_unit, int64_t partition,
+                                T entry, char* record) {
+    std::memcpy(record, &privacy_unit, sizeof(int64_t));
+    std::memcpy(record + sizeof(int64_t), &partition, sizeof(int64_t));
+    std::memcpy(record + 2 * sizeof(int64_t), &entry, sizeof(T));
+  }
+
+  void DecodeAndSampleEntry(const char* record) {
+    int64_t privacy_unit;
+    int64_t partition;
+    T entry;
+    std::memcpy(&privacy_unit, record, sizeof(int64_t));
+    std::memcpy(&partition, record + sizeof(int64_t), sizeof(int64_t));
+    std::memcpy(&entry, record + 2 * sizeof(int64_t), sizeof(T));
+    SampleEntry(privacy_unit, partition, entry);
+  }
+
+  // Adds an entry of privacy_unit to partition to the samples in memory.
+  void SampleEntry(int64_t privacy_unit, int64_t partition, T entry) {
+    PartitionSamples& partitions = samples_[privacy_unit];
+    for (PartitionSample& sample : partitions) {
+      if (sample.partition == partition) {
+        AddToReservoir(entry, &sample);
+        return;
+      }
+    }
+
+    // A partition that is not sampled on its first entry never is, as the
+    // largest sampled priority only decreases.
+    const uint64_t priority = Mix(Mix(privacy_unit ^ seed_) ^ partition);
+    PartitionSample* sample;
+    if (partitions.size() <
+        static_cast<size_t>(max_partitions_contributed_)) {
+      partitions.emplace_back();
+      sample = &partitions.back();
+    } else {
+      sample = &partitions[0];
+      for (PartitionSample& other : partitions) {
+        if (other.priority > sample->priority) {
+          sample = &other;
+        }
+      }
+      if (priority >= sample->priority) {
+        return;
+      }
+    }
+    sample->partition = partition;
+    sample->priority = priority;
+    sample->num_entries = 0;
+    sample->entries.clear();
+    AddToReservoir(entry, sample);
+  }
+
+  // Adds entry to the uniform sample of the entries of a partition.
+  void AddToReservoir(T entry, PartitionSample* sample) {
+    const int64_t index = sample->num_entries++;
+    if (index < max_contributions_per_partition_) {
+      sample->entries.push_back(entry);
+      return;
+    }
+    const int64_t replaced = std::uniform_int_distribution<int64_t>(
+        0, index)(SecureURBG::GetSingleton());
+    if (replaced < max_contributions_per_partition_) {
+      sample->entries[replaced] = entry;
+    }
+  }
+
+  template <typename AddEntryFn>
+  void EmitSamples(AddEntryFn& add_entry) {
+    for (const auto& privacy_unit : samples_) {
+      for (const PartitionSample& sample : privacy_unit.second) {
+        bool new_privacy_unit = true;
+        for (T entry : sample.entries) {
+          add_entry(sample.partition, entry, new_privacy_unit);
+          new_privacy_unit = false;
+        }
+      }
+    }
+    samples_.clear();
+  }
+
+  const int max_partitions_contributed_;
+  const int max_contributions_per_partition_;
+  // Key of the partition priorities and the spill file hash.
+  const uint64_t seed_;
+  base::Status status_;
+
+  // Sampled partitions of each privacy unit in memory.
+  absl::flat_hash_map<int64_t, PartitionSamples> samples_;
+  // Empty unless spilling.
+  std::vector<SpillFile> spill_files_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_CONTRIBUTION_BOUNDER_H_
@@ -0,0 +1,124 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/contribution-bounder.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr int kNumEntries = 1 << 20;
+constexpr int kMaxPartitionsContributed = 4;
+constexpr int kMaxContributionsPerPartition = 2;
+
+struct Entry {
+  int64_t privacy_unit;
+  int64_t partition;
+  int64_t value;
+};
+
+// Returns kNumEntries entries of num_units privacy units, each of which
+// contributes to about 16 partitions.
+std::vector<Entry> Entries(int64_t num_units) {
+  std::vector<Entry> entries(kNumEntries);
+  for (int64_t i = 0; i < kNumEntries; ++i) {
+    const int64_t unit = i * 7919 % num_units;
+    entries[i] = {unit, (unit + i % 16) * 104729 % 65536, i % 100};
+  }
+  return entries;
+}
+
+// Bounds the contributions of kNumEntries entries of state.range(0) privacy
+// units, in memory or with spill files.
+template <bool kSpill>
+void BM_ContributionBounder(benchmark::State& state) {
+  std::vector<Entry> entries = Entries(state.range(0));
+  ContributionBounder<int64_t>::Builder builder;
+  builder.SetMaxPartitionsContributed(kMaxPartitionsContributed)
+      .SetMaxContributionsPerPartition(kMaxContributionsPerPartition);
+  if (kSpill) {
+    builder.SetSpillDirectory("/tmp").SetNumSpillFiles(16);
+  }
+  for (auto _ : state) {
+    std::unique_ptr<ContributionBounder<int64_t>> bounder =
+        builder.Build().ValueOrDie();
+    for (const Entry& entry : entries) {
+      bounder->AddEntry(entry.privacy_unit, entry.partition, entry.value);
+    }
+    int64_t sum = 0;
+    base::Status status = bounder->ForEachBoundedEntry(
+        [&sum](int64_t, int64_t value, bool) { sum += value; });
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEntries);
+}
+BENCHMARK_TEMPLATE(BM_ContributionBounder, false)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+BENCHMARK_TEMPLATE(BM_ContributionBounder, true)
+    ->Arg(1 << 10)
+    ->Arg(1 << 16)
+    ->Arg(1 << 20);
+
+// Same as above, with a pass that sorts the entries by privacy unit, partition
+// priority and a random key, and keeps the first entries of each privacy unit
+// and partition.
+void BM_SortBasedBounding(benchmark::State& state) {
+  std::vector<Entry> entries = Entries(state.range(0));
+  std::mt19937_64 random;
+  for (auto _ : state) {
+    const uint64_t seed = random();
+    std::vector<std::tuple<int64_t, uint64_t, uint64_t, int64_t, int64_t>>
+        keyed(entries.size());
+    for (int64_t i = 0; i < entries.size(); ++i) {
+      keyed[i] = {entries[i].privacy_unit,
+                  std::hash<int64_t>()(entries[i].partition ^ seed),
+                  random(), entries[i].partition, entries[i].value};
+    }
+    std::sort(keyed.begin(), keyed.end());
+    int64_t sum = 0;
+    int num_partitions = 0;
+    int num_contributions = 0;
+    for (int64_t i = 0; i < keyed.size(); ++i) {
+      if (i == 0 || std::get<0>(keyed[i]) != std::get<0>(keyed[i - 1])) {
+        num_partitions = 0;
+        num_contributions = 0;
+      }
+      if (i == 0 || std::get<3>(keyed[i]) != std::get<3>(keyed[i - 1])) {
+        ++num_partitions;
+        num_contributions = 0;
+      }
+      if (num_partitions <= kMaxPartitionsContributed &&
+          ++num_contributions <= kMaxContributionsPerPartition) {
+        sum += std::get<4>(keyed[i]);
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEntries);
+}
+BENCHMARK(BM_SortBasedBounding)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,284 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/contribution-bounder.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
+using ::testing::FieldsAre;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+using ::differential_privacy::base::testing::StatusIs;
+
+// Adds entries of 100 privacy units to bounder: unit u adds 5 entries to each
+// of u % 10 partitions, and partition p of every unit is p.
+void AddEntries(ContributionBounder<int64_t>* bounder) {
+  for (int64_t unit = 0; unit < 100; ++unit) {
+    for (int i = 0; i < 5; ++i) {
+      for (int64_t partition = 0; partition < unit % 10; ++partition) {
+        bounder->AddEntry(unit, partition, 1);
+      }
+    }
+  }
+}
+
+// Returns the number of bounded entries of each partition.
+std::map<int64_t, int64_t> CountBoundedEntries(
+    ContributionBounder<int64_t>* bounder) {
+  std::map<int64_t, int64_t> counts;
+  EXPECT_OK(bounder->ForEachBoundedEntry(
+      [&counts](int64_t partition, int64_t, bool) { ++counts[partition]; }));
+  return counts;
+}
+
+// Sums the bounded entries, which are all 1, over partitions.
+int64_t NumBoundedEntries(const std::map<int64_t, int64_t>& counts) {
+  int64_t total = 0;
+  for (const auto& partition : counts) {
+    total += partition.second;
+  }
+  return total;
+}
+
+TEST(ContributionBounderTest, BoundsPartitionsAndContributions) {
+  std::unique_ptr<ContributionBounder<int64_t>> bounder =
+      ContributionBounder<int64_t>::Builder()
+          .SetMaxPartitionsContributed(3)
+          .SetMaxContributionsPerPartition(2)
+          .Build()
+          .ValueOrDie();
+  AddEntries(bounder.get());
+  EXPECT_EQ(bounder->NumPrivacyUnits(), 90);
+
+  // Each group of 10 units keeps 0, 1, 2, 3, 3, ..., 3 partitions with 2
+  // entries each.
+  std::map<int64_t, int64_t> counts = CountBoundedEntries(bounder.get());
+  EXPECT_EQ(NumBoundedEntries(counts), 10 * 2 * (1 + 2 + 7 * 3));
+  EXPECT_EQ(bounder->NumPrivacyUnits(), 0);
+  EXPECT_THAT(CountBoundedEntries(bounder.get()), SizeIs(0));
+}
+
+TEST(ContributionBounderTest, FlagsOneEntryPerPrivacyUnitAndPartition) {
+  std::unique_ptr<ContributionBounder<int64_t>> bounder =
+      ContributionBounder<int64_t>::Builder()
+          .SetMaxPartitionsContributed(3)
+          .SetMaxContributionsPerPartition(2)
+          .Build()
+          .ValueOrDie();
+  AddEntries(bounder.get());
+  int64_t num_entries = 0;
+  int64_t num_new_units = 0;
+  EXPECT_OK(bounder->ForEachBoundedEntry(
+      [&](int64_t, int64_t, bool new_privacy_unit) {
+        ++num_entries;
+        num_new_units += new_privacy_unit;
+      }));
+  EXPECT_EQ(num_entries, 10 * 2 * (1 + 2 + 7 * 3));
+  EXPECT_EQ(num_new_units, 10 * (1 + 2 + 7 * 3));
+}
+
+TEST(ContributionBounderTest, SpillsToDisk) {
+  std::unique_ptr<ContributionBounder<int64_t>> bounder =
+      ContributionBounder<int64_t>::Builder()
+          .SetMaxPartitionsContributed(3)
+          .SetMaxContributionsPerPartition(2)
+          .SetSpillDirectory(::testing::TempDir())
+          .SetNumSpillFiles(4)
+          .Build()
+          .ValueOrDie();
+  AddEntries(bounder.get());
+  EXPECT_EQ(bounder->NumPrivacyUnits(), 0);
+  EXPECT_EQ(NumBoundedEntries(CountBoundedEntries(bounder.get())),
+            10 * 2 * (1 + 2 + 7 * 3));
+
+  // The spill files are reused.
+  AddEntries(bounder.get());
+  EXPECT_EQ(NumBoundedEntries(CountBoundedEntries(bounder.get())),
+            10 * 2 * (1 + 2 + 7 * 3));
+}
+
+TEST(ContributionBounderTest, SpillsEntriesSmallerThanTheKeys) {
+  std::unique_ptr<ContributionBounder<int>> bounder =
+      ContributionBounder<int>::Builder()
+          .SetMaxContributionsPerPartition(2)
+          .SetSpillDirectory(::testing::TempDir())
+          .SetNumSpillFiles(2)
+          .Build()
+          .ValueOrDie();
+  for (int unit = 0; unit < 100; ++unit) {
+    bounder->AddEntry(unit, unit % 3, unit);
+  }
+  std::map<int64_t, int64_t> sums;
+  EXPECT_OK(bounder->ForEachBoundedEntry(
+      [&sums](int64_t partition, int entry, bool) {
+        sums[partition] += entry;
+      }));
+  EXPECT_THAT(sums, ElementsAre(FieldsAre(0, 1683), FieldsAre(1, 1617),
+                                FieldsAre(2, 1650)));
+}
+
+TEST(ContributionBounderTest, FailsAfterLosingTheSpillDirectory) {
+  const std::string directory =
+      absl::StrCat(::testing::TempDir(), "/contribution-bounder-test");
+  ASSERT_EQ(mkdir(directory.c_str(), 0700), 0);
+  std::unique_ptr<ContributionBounder<int64_t>> bounder =
+      ContributionBounder<int64_t>::Builder()
+          .SetSpillDirectory(directory)
+          .SetNumSpillFiles(2)
+          .Build()
+          .ValueOrDie();
+  AddEntries(bounder.get());
+
+  // The open spill files can still be read, but not reopened.
+  DIR* dir = opendir(directory.c_str());
+  ASSERT_NE(dir, nullptr);
+  while (dirent* file = readdir(dir)) {
+    unlink(absl::StrCat(directory, "/", file->d_name).c_str());
+  }
+  closedir(dir);
+  ASSERT_EQ(rmdir(directory.c_str()), 0);
+
+  int64_t num_entries = 0;
+  EXPECT_THAT(
+      bounder->ForEachBoundedEntry(
+          [&num_entries](int64_t, int64_t, bool) { ++num_entries; }),
+      StatusIs(base::StatusCode::kInternal,
+               HasSubstr("Unable to reopen spill file")));
+  EXPECT_GT(num_entries, 0);
+
+  // The error sticks instead of writing to the lost files.
+  AddEntries(bounder.get());
+  EXPECT_THAT(bounder->ForEachBoundedEntry([](int64_t, int64_t, bool) {}),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("Unable to reopen spill file")));
+}
+
+TEST(ContributionBounderTest, SamplesPartitionsAndEntriesUniformly) {
+  ContributionBounder<int64_t>::Builder builder;
+  std::map<int64_t, int> partition_counts;
+  std::map<int64_t, int> entry_counts;
+  for (int i = 0; i < 2000; ++i) {
+    std::unique_ptr<ContributionBounder<int64_t>> bounder =
+        builder.Build().ValueOrDie();
+    for (int64_t partition = 0; partition < 4; ++partition) {
+      bounder->AddEntry(1, partition, 0);
+    }
+    for (int64_t entry = 0; entry < 4; ++entry) {
+      bounder->AddEntry(2, 10, entry);
+    }
+    ASSERT_OK(bounder->ForEachBoundedEntry([&](int64_t partition,
+                                               int64_t entry, bool) {
+      if (partition == 10) {
+        ++entry_counts[entry];
+      } else {
+        ++partition_counts[partition];
+      }
+    }));
+  }
+  // Each of the 4 choices has an expected count of 500 with a standard
+  // deviation of about 19.
+  EXPECT_THAT(partition_counts, SizeIs(4));
+  EXPECT_THAT(entry_counts, SizeIs(4));
+  for (const auto& counts : {partition_counts, entry_counts}) {
+    for (const auto& count : counts) {
+      EXPECT_GT(count.second, 400);
+      EXPECT_LT(count.second, 600);
+    }
+  }
+}
+
+TEST(ContributionBounderTest, FeedsAlgorithms) {
+  std::unique_ptr<ContributionBounder<int64_t>> bounder =
+      ContributionBounder<int64_t>::Builder()
+          .SetMaxContributionsPerPartition(2)
+          .Build()
+          .ValueOrDie();
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      PartitionedAggregator<int64_t>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(10)
+          .SetMaxContributionsPerPartition(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .SetPublicPartitions({5})
+          .Build()
+          .ValueOrDie();
+  for (int64_t unit = 0; unit < 3; ++unit) {
+    for (int i = 0; i < 4; ++i) {
+      bounder->AddEntry(unit, 5, 3);
+    }
+  }
+  ASSERT_OK(bounder->AddBoundedEntriesTo(aggregator.get()));
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  EXPECT_THAT(*results, ElementsAre(FieldsAre(5, 6, 18)));
+
+  std::unique_ptr<Count<int64_t>> count =
+      Count<int64_t>::Builder()
+          .SetMaxContributionsPerPartition(2)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build()
+          .ValueOrDie();
+  for (int i = 0; i < 4; ++i) {
+    bounder->AddEntry(1, 0, i);
+  }
+  ASSERT_OK(bounder->AddBoundedEntriesTo(count.get()));
+  base::StatusOr<Output> result = count->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 2);
+}
+
+TEST(ContributionBounderTest, BuilderErrors) {
+  EXPECT_THAT(ContributionBounder<int64_t>::Builder()
+                  .SetMaxPartitionsContributed(0)
+                  .Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("has to be positive")));
+  EXPECT_THAT(ContributionBounder<int64_t>::Builder()
+                  .SetMaxContributionsPerPartition(-1)
+                  .Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("has to be positive")));
+  EXPECT_THAT(ContributionBounder<int64_t>::Builder()
+                  .SetSpillDirectory("/nonexistent/directory")
+                  .Build(),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("Unable to open spill file")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
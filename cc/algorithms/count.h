@@ -71,6 +71,24 @@ class Count : public Algorithm<T> {
     return base::OkStatus();
   }
 
+  void WriteBinarySummary(BinarySummaryWriter* writer) override {
+    writer->WriteHeader(BinarySummaryType::kCount);
+    writer->WriteVarint(count_);
+  }
+
+  base::StatusOr<BinarySummaryMerge> ReadBinarySummary(
+      BinarySummaryReader* reader) override {
+    RETURN_IF_ERROR(reader->ReadHeader(BinarySummaryType::kCount));
+    uint64_t count;
+    if (!reader->ReadVarint(&count)) {
+      return MalformedBinarySummaryError();
+    }
+    return BinarySummaryMerge([this, count]() {
+      SafeAdd<uint64_t>(count_, count, &count_);
+      return base::OkStatus();
+    });
+  }
+
   int64_t MemoryUsed() override {
     int64_t memory = sizeof(Count<T>);
     if (mechanism_) {
@@ -99,6 +117,16 @@ class Count : public Algorithm<T> {
 
   void ResetState() override { count_ = 0; }
 
+  // A count has no buffers to move, so merging an rvalue copies as well.
+  using Algorithm<T>::MergeAlgorithm;
+
+  base::Status MergeAlgorithm(const Algorithm<T>& other) override {
+    // MergeFrom() checked that other is a Count.
+    SafeAdd<uint64_t>(count_, static_cast<const Count<T>&>(other).count_,
+                      &count_);
+    return base::OkStatus();
+  }
+
   uint64_t GetCount() const { return count_; }
 
   // The constructor and count_ are non-private for testing.
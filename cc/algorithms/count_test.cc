@@ -17,6 +17,7 @@
 #include "algorithms/count.h"
 
 #include <memory>
+#include <string>
 
 #include "google/protobuf/any.pb.h"
 #include "base/testing/proto_matchers.h"
@@ -46,6 +47,8 @@ namespace {
 using ::differential_privacy::test_utils::ZeroNoiseMechanism;
 using ::differential_privacy::base::testing::EqualsProto;
 using ::differential_privacy::base::testing::IsOkAndHolds;
+using ::differential_privacy::base::testing::StatusIs;
+using ::testing::HasSubstr;
 
 template <typename T>
 class CountTest : public testing::Test {};
@@ -186,6 +189,83 @@ TEST(CountTest, SerializeAndMergeOverflowTest) {
   EXPECT_EQ(GetValue<int64_t>(*result), std::numeric_limits<int64_t>::max());
 }
 
+TEST(CountTest, BinarySerializeMergeTest) {
+  auto count1 =
+      Count<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count1);
+  (*count1)->AddEntry(1);
+  (*count1)->AddEntry(2);
+  std::string summary;
+  (*count1)->SerializeToBinary(&summary);
+
+  auto count2 =
+      Count<double>::Builder()
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(count2);
+  (*count2)->AddEntry(0);
+  EXPECT_OK((*count2)->MergeFromBinary(summary));
+
+  auto result = (*count2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 3);
+
+  EXPECT_THAT((*count2)->MergeFromBinary(summary.substr(0, 2)),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("malformed")));
+}
+
+TEST(CountTest, RejectedBinaryMergeLeavesCountUnchanged) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto count1 = builder.Build();
+  ASSERT_OK(count1);
+  for (int i = 0; i < 5; ++i) {
+    (*count1)->AddEntry(i);
+  }
+  std::string summary;
+  (*count1)->SerializeToBinary(&summary);
+
+  auto count2 = builder.Build();
+  ASSERT_OK(count2);
+  (*count2)->AddEntry(0);
+  EXPECT_THAT((*count2)->MergeFromBinary(summary + "x"),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("malformed")));
+  auto result = (*count2)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 1);
+}
+
+TEST(CountTest, MergeFromTest) {
+  Count<double>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto count1 = builder.Build();
+  ASSERT_OK(count1);
+  auto count2 = builder.Build();
+  ASSERT_OK(count2);
+  auto count3 = builder.Build();
+  ASSERT_OK(count3);
+  (*count1)->AddEntry(1);
+  (*count2)->AddEntry(2);
+  (*count2)->AddEntry(3);
+  (*count3)->AddEntry(4);
+
+  EXPECT_OK((*count1)->MergeFrom(**count2));
+  EXPECT_OK((*count1)->MergeFrom(std::move(**count3)));
+  auto result1 = (*count1)->PartialResult();
+  ASSERT_OK(result1);
+  EXPECT_EQ(GetValue<int64_t>(*result1), 4);
+
+  // The copied Count is unchanged, and the moved one is reset.
+  auto result2 = (*count2)->PartialResult();
+  ASSERT_OK(result2);
+  EXPECT_EQ(GetValue<int64_t>(*result2), 2);
+  auto result3 = (*count3)->PartialResult();
+  ASSERT_OK(result3);
+  EXPECT_EQ(GetValue<int64_t>(*result3), 0);
+}
+
 TEST(CountTest, MemoryUsed) {
   auto count = Count<double>::Builder().Build();
   ASSERT_OK(count);
@@ -15,10 +15,12 @@
 //
 #include "algorithms/distributions.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
 #include "absl/memory/memory.h"
+#include "absl/numeric/int128.h"
 #include "absl/random/random.h"
 #include "base/statusor.h"
 #include "absl/strings/string_view.h"
@@ -40,6 +42,101 @@ static constexpr double kPi = 3.14159265358979323846;
 // root is set to 2^57.
 static constexpr double kBinomialBound = (double)(1LL << 57);
 
+// The number of uniform samples GeometricDistribution::Sample() fetches at
+// once after its first chunk, which is sized for the expected number of steps
+// of the binary search instead.
+static constexpr int kUniformChunkSize = 16;
+
+// The most uniform samples GeometricDistribution::Sample() fetches at once.
+static constexpr int kMaxUniformChunkSize = 64;
+
+// The number of rejection rounds GaussianDistribution::SampleBinomial() draws
+// random numbers for at once. Most samples are accepted within a few rounds.
+static constexpr int kBinomialRoundChunkSize = 8;
+
+// Returns a uniform sample of [0, bound) for bound > 0. The sample is taken
+// from the high bits of word * bound. This is biased for the few words whose
+// low bits fall below 2^64 mod bound, which are rejected and replaced by
+// further random words.
+uint64_t UniformBelow(uint64_t bound, uint64_t word) {
+  absl::uint128 product = absl::uint128(word) * bound;
+  if (absl::Uint128Low64(product) < bound) {
+    uint64_t threshold = -bound % bound;
+    while (absl::Uint128Low64(product) < threshold) {
+      product = absl::uint128(SecureURBG::GetSingleton()()) * bound;
+    }
+  }
+  return absl::Uint128High64(product);
+}
+
+// Returns the number of uniform samples GeometricDistribution::Sample() first
+// fetches for lambda. The binary search ends after about log2(1 / lambda) + 2
+// steps on average, and needs one more sample for the overflow check.
+int FirstUniformChunkSize(double lambda) {
+  double expected_steps = std::max(std::ceil(-std::log2(lambda)), 0.0) + 4;
+  return static_cast<int>(
+      std::min(expected_steps, static_cast<double>(kMaxUniformChunkSize)));
+}
+
+// Returns the probability 1 / (1 + e^x) for x >= 0, which is the probability
+// that a binary digit of weight w is set in a geometric sample with parameter
+// lambda = x / w.
+double DigitProbability(double x) {
+  if (x < 1) {
+    // Avoids the rounding error of 1 + e^x for small x.
+    return 0.5 - 0.5 * std::tanh(0.5 * x);
+  }
+  double e = std::exp(-x);
+  return e / (1 + e);
+}
+
+// Returns the probability that a geometric sample with parameter lambda
+// exceeds the int64_t range.
+double OverflowProbability(double lambda) {
+  return std::exp(-1.0 * lambda * std::numeric_limits<int64_t>::max());
+}
+
+// The number of binary digits SampleBitwise() draws, which covers every sample
+// below 2^63.
+static constexpr int kNumBitwiseDigits = 63;
+
+// Hands out the bytes of secure random words one at a time.
+class RandomByteStream {
+ public:
+  int Next() {
+    if (remaining_ == 0) {
+      word_ = SecureURBG::GetSingleton()();
+      remaining_ = sizeof(word_);
+    }
+    --remaining_;
+    int byte = static_cast<int>(word_ & 0xff);
+    word_ >>= 8;
+    return byte;
+  }
+
+ private:
+  uint64_t word_ = 0;
+  int remaining_ = 0;
+};
+
+// Returns true with probability p, where p is in [0, 1]. Compares a uniformly
+// random bit string to the binary expansion of p, 8 bits at a time, until they
+// differ. The expansion of a double is finite and each step is exact, so the
+// result is an exact Bernoulli(p) sample. Consumes a single byte in all but a
+// 2^-8 fraction of cases.
+bool SampleBernoulli(double p, RandomByteStream& bytes) {
+  while (p > 0) {
+    p *= 256;
+    double digits = std::floor(p);
+    p -= digits;
+    int byte = bytes.Next();
+    if (byte != digits) {
+      return byte < digits;
+    }
+  }
+  return false;
+}
+
 // Approximates the probability of a random sample m + n / 2 drawn from a
 // binomial distribution of n Bernoulli trials that have a success probability
 // of 1 / 2 each. The approximation is taken from Lemma 7 of the noise
@@ -89,14 +186,25 @@ double GaussianDistribution::cdf(double stddev, double x) {
   return (1 + std::erf(x / (stddev * sqrt(2)))) / 2;
 }
 
-GeometricDistribution::GeometricDistribution(double lambda) : lambda_(lambda) {
+GeometricDistribution::GeometricDistribution(double lambda,
+                                             GeometricSamplingMethod method)
+    : lambda_(lambda), method_(method) {
   DCHECK_GE(lambda, 0);
+  if (method_ == GeometricSamplingMethod::kBitwise) {
+    for (int i = 0; i < kNumBitwiseDigits; ++i) {
+      double p = DigitProbability(std::ldexp(lambda_, i));
+      // The probabilities are decreasing, so all higher digits are 0 as well.
+      if (p == 0) break;
+      bit_probabilities_.push_back(p);
+    }
+    overflow_probability_ = OverflowProbability(lambda_);
+  }
 }
 
 double GaussianDistribution::SampleGeometric() {
-  int geom_sample = 0;
-  while (absl::Bernoulli(SecureURBG::GetSingleton(), 0.5)) ++geom_sample;
-  return geom_sample;
+  // Geometric() counts the Bernoulli trials up to and including the first
+  // success and consumes them 64 at a time.
+  return Geometric() - 1;
 }
 
 // Returns a random sample m where {@code m + n / 2} is drawn from a binomial
@@ -110,16 +218,27 @@ double GaussianDistribution::SampleGeometric() {
 double GaussianDistribution::SampleBinomial(double sqrt_n) {
   long long step_size = static_cast<long long>(round(sqrt(2.0) * sqrt_n + 1));
 
-  SecureURBG& random = SecureURBG::GetSingleton();
+  // Every rejection round takes its uniform offset from one random word, its
+  // sign from one bit of a shared word, and a uniform double to decide on the
+  // rejection. They are drawn for kBinomialRoundChunkSize rounds at once.
+  uint64_t words[kBinomialRoundChunkSize + 1];
+  double uniforms[kBinomialRoundChunkSize];
+  int next_round = kBinomialRoundChunkSize;
   while (true) {
+    if (next_round == kBinomialRoundChunkSize) {
+      SecureURBG::GetSingleton().Fill(absl::MakeSpan(words));
+      UniformDoubles(absl::MakeSpan(uniforms));
+      next_round = 0;
+    }
     int geom_sample = SampleGeometric();
-    int two_sided_geom =
-        absl::Bernoulli(random, 0.5) ? geom_sample : (-geom_sample - 1);
-    int64_t uniform_sample = absl::Uniform(random, 0u, step_size);
+    int two_sided_geom = (words[kBinomialRoundChunkSize] >> next_round) & 1
+                             ? geom_sample
+                             : (-geom_sample - 1);
+    int64_t uniform_sample = UniformBelow(step_size, words[next_round]);
     int64_t result = step_size * two_sided_geom + uniform_sample;
 
     double result_prob = ApproximateBinomialProbability(sqrt_n, result);
-    double reject_prob = UniformDouble();
+    double reject_prob = uniforms[next_round++];
 
     if (result_prob > 0 && reject_prob > 0 &&
         reject_prob < result_prob * step_size * pow(2.0, geom_sample - 2)) {
@@ -130,15 +249,45 @@ double GaussianDistribution::SampleBinomial(double sqrt_n) {
 
 double GeometricDistribution::GetUniformDouble() { return UniformDouble(); }
 
+void GeometricDistribution::GetUniformDoubles(absl::Span<double> out) {
+  UniformDoubles(out);
+}
+
 int64_t GeometricDistribution::Sample() { return Sample(1.0); }
 
 int64_t GeometricDistribution::Sample(double scale) {
   if (lambda_ == std::numeric_limits<double>::infinity()) {
     return 0;
   }
+  switch (method_) {
+    case GeometricSamplingMethod::kBitwise:
+      return SampleBitwise(scale);
+    case GeometricSamplingMethod::kBinarySearch:
+    default:
+      return SampleBinarySearch(scale);
+  }
+}
+
+int64_t GeometricDistribution::SampleBinarySearch(double scale) {
   double lambda = lambda_ / scale;
 
-  if (GetUniformDouble() >
+  // The uniform samples are drawn in chunks. The first chunk usually covers
+  // the overflow check and the whole binary search below, and further samples
+  // are drawn in smaller chunks.
+  double uniforms[kMaxUniformChunkSize];
+  int num_uniforms = FirstUniformChunkSize(lambda);
+  GetUniformDoubles(absl::MakeSpan(uniforms, num_uniforms));
+  int next_uniform = 0;
+  auto next_uniform_double = [&]() {
+    if (next_uniform == num_uniforms) {
+      num_uniforms = kUniformChunkSize;
+      GetUniformDoubles(absl::MakeSpan(uniforms, num_uniforms));
+      next_uniform = 0;
+    }
+    return uniforms[next_uniform++];
+  };
+
+  if (next_uniform_double() >
       -1.0 * expm1(-1.0 * lambda * std::numeric_limits<int64_t>::max())) {
     return std::numeric_limits<int64_t>::max();
   }
@@ -157,7 +306,7 @@ int64_t GeometricDistribution::Sample(double scale) {
     mid = std::min(std::max(mid, lo + 1), hi - 1);
 
     double q = std::expm1(lambda * (lo - mid)) / expm1(lambda * (lo - hi));
-    if (GetUniformDouble() <= q) {
+    if (next_uniform_double() <= q) {
       hi = mid;
     } else {
       lo = mid;
@@ -166,8 +315,49 @@ int64_t GeometricDistribution::Sample(double scale) {
   return hi - 1;
 }
 
+// The binary digits of a geometric sample X are independent: digit i is set
+// with probability 1 / (1 + e^(lambda * 2^i)). Conditioned on X < 2^63 this
+// still holds for digits 0 to 62, so we first decide whether the sample
+// exceeds the int64_t range, as the binary search does, and then draw each
+// digit with an exact Bernoulli sample. The probabilities of scale 1 are
+// precomputed on construction; other scales compute theirs while sampling, so
+// that a shared distribution is never written to.
+int64_t GeometricDistribution::SampleBitwise(double scale) {
+  RandomByteStream bytes;
+  int64_t result = 0;
+  if (scale == 1) {
+    if (SampleBernoulli(overflow_probability_, bytes)) {
+      return std::numeric_limits<int64_t>::max();
+    }
+    for (int i = 0; i < bit_probabilities_.size(); ++i) {
+      if (SampleBernoulli(bit_probabilities_[i], bytes)) {
+        result |= int64_t{1} << i;
+      }
+    }
+    return result;
+  }
+
+  double lambda = lambda_ / scale;
+  if (SampleBernoulli(OverflowProbability(lambda), bytes)) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  for (int i = 0; i < kNumBitwiseDigits; ++i) {
+    double p = DigitProbability(std::ldexp(lambda, i));
+    if (p == 0) break;
+    if (SampleBernoulli(p, bytes)) {
+      result |= int64_t{1} << i;
+    }
+  }
+  return result;
+}
+
 double GeometricDistribution::Lambda() { return lambda_; }
 
+int64_t GeometricDistribution::MemoryUsed() const {
+  return sizeof(GeometricDistribution) +
+         sizeof(double) * bit_probabilities_.capacity();
+}
+
 // This is 2^K, with K hardcoded as 40. To generate laplace noise, we sample an
 // integer from a geometric distribution, randomly flip the sign, then multiply
 // it by a small power of two. That small power of 2 is the smallest power of 2
@@ -190,7 +380,8 @@ base::StatusOr<double> CalculateGranularity(double epsilon,
   return gran;
 }
 
-LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
+LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity,
+                                         GeometricSamplingMethod method) {
   epsilon_ = epsilon;
   sensitivity_ = sensitivity;
 
@@ -205,7 +396,7 @@ LaplaceDistribution::LaplaceDistribution(double epsilon, double sensitivity) {
   } else {
     lambda = granularity_ * epsilon_ / (sensitivity_ + granularity_);
   }
-  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda);
+  geometric_distro_ = absl::make_unique<GeometricDistribution>(lambda, method);
 }
 
 double LaplaceDistribution::GetUniformDouble() { return UniformDouble(); }
@@ -228,6 +419,27 @@ double LaplaceDistribution::Sample(double scale) {
   return sample * granularity_;
 }
 
+// Sample(scale) is granularity_ times a two-sided geometric sample s with
+// P(s) = (1 - q) q^|s| / (1 + q) and q = e^-lambda for lambda scaled by scale.
+double LaplaceDistribution::ProbabilityOfSampleAtLeast(double scale, double x) {
+  double lambda = geometric_distro_->Lambda() / scale;
+  double q = std::exp(-lambda);
+  double m = std::ceil(x / granularity_);
+  if (m >= 1) {
+    return std::exp(-lambda * m) / (1 + q);
+  }
+  return 1 - std::exp(-lambda * (1 - m)) / (1 + q);
+}
+
+double LaplaceDistribution::SampleAtLeast(double scale, double x) {
+  DCHECK_GT(x, 0);
+  // The tail of the geometric distribution is memoryless, so the part of the
+  // sample beyond the first multiple of the granularity that is at least x is
+  // itself geometric.
+  double m = std::max(std::ceil(x / granularity_), 1.0);
+  return (m + geometric_distro_->Sample(scale)) * granularity_;
+}
+
 double LaplaceDistribution::GetGranularity() { return granularity_; }
 
 double LaplaceDistribution::GetDiversity() { return sensitivity_ / epsilon_; }
@@ -242,7 +454,7 @@ double LaplaceDistribution::cdf(double b, double x) {
 int64_t LaplaceDistribution::MemoryUsed() {
   int64_t memory = sizeof(LaplaceDistribution);
   if (geometric_distro_ != nullptr) {
-    memory += sizeof(*geometric_distro_);
+    memory += geometric_distro_->MemoryUsed();
   }
   return memory;
 }
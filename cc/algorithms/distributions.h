@@ -18,12 +18,30 @@
 #define DIFFERENTIAL_PRIVACY_ALGORITHMS_DISTRIBUTIONS_H_
 
 #include <memory>
+#include <vector>
 
 #include <cstdint>
 #include "base/status.h"
 #include "base/statusor.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
+
+// Selects the algorithm GeometricDistribution uses to draw its samples. Both
+// methods sample the same distribution exactly up to the floating point
+// precision of the involved probabilities.
+enum class GeometricSamplingMethod {
+  // Binary search over [0, 2^63) as described in the secure noise generation
+  // paper. Draws ~64 uniform doubles and evaluates several transcendental
+  // functions per step.
+  kBinarySearch,
+  // Samples the binary digits of the result independently of each other. The
+  // per-digit probabilities are precomputed for scale 1 and computed on every
+  // call for other scales. Each digit consumes a single random byte in all but
+  // a 2^-8 fraction of cases.
+  kBitwise,
+};
+
 namespace internal {
 
 // Allows samples to be drawn from a Gaussian distribution over a given stddev
@@ -60,6 +78,7 @@ class GaussianDistribution {
  private:
   // Sample from geometric distribution with probability 0.5. It is much faster
   // then using GeometricDistribution which is suitable for any probability.
+  // Draws a single random word in all but a 2^-64 fraction of cases.
   double SampleGeometric();
   double SampleBinomial(double sqrt_n);
 
@@ -74,20 +93,42 @@ class GaussianDistribution {
 // of their distribution.
 class GeometricDistribution {
  public:
-  explicit GeometricDistribution(double lambda);
+  explicit GeometricDistribution(
+      double lambda,
+      GeometricSamplingMethod method = GeometricSamplingMethod::kBinarySearch);
 
   virtual ~GeometricDistribution() {}
 
   virtual double GetUniformDouble();
 
+  // Fills out with uniform doubles. Sample() draws its uniforms in blocks
+  // through this method, so subclasses overriding GetUniformDouble() should
+  // override it as well.
+  virtual void GetUniformDoubles(absl::Span<double> out);
+
   virtual int64_t Sample();
 
   virtual int64_t Sample(double scale);
 
   double Lambda();
 
+  GeometricSamplingMethod Method() const { return method_; }
+
+  int64_t MemoryUsed() const;
+
  private:
+  int64_t SampleBinarySearch(double scale);
+  int64_t SampleBitwise(double scale);
+
   double lambda_;
+  GeometricSamplingMethod method_;
+
+  // For kBitwise: bit_probabilities_[i] is the probability that binary digit i
+  // of a sample at scale 1 is set, and overflow_probability_ is the
+  // probability of the sample exceeding the int64_t range. Trailing digits
+  // with probability 0 are dropped. Both are only written on construction.
+  std::vector<double> bit_probabilities_;
+  double overflow_probability_ = 0;
 };
 
 // Calculates 'r' from the secure noise paper (see
@@ -105,7 +146,9 @@ base::StatusOr<double> CalculateGranularity(double epsilon, double sensitivity);
 // http://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.366.5957&rep=rep1&type=pdf
 class LaplaceDistribution {
  public:
-  explicit LaplaceDistribution(double epsilon, double sensitivity);
+  explicit LaplaceDistribution(
+      double epsilon, double sensitivity,
+      GeometricSamplingMethod method = GeometricSamplingMethod::kBinarySearch);
 
   virtual ~LaplaceDistribution() = default;
 
@@ -116,6 +159,13 @@ class LaplaceDistribution {
   // Samples the Laplace distribution with Lap(scale*b)
   virtual double Sample(double scale);
 
+  // Returns the probability that Sample(scale) returns a value of at least x.
+  virtual double ProbabilityOfSampleAtLeast(double scale, double x);
+
+  // Samples the Laplace distribution with Lap(scale*b) conditioned on the
+  // sample being at least x. x must be positive.
+  virtual double SampleAtLeast(double scale, double x);
+
   virtual int64_t MemoryUsed();
 
   virtual bool GetBoolean();
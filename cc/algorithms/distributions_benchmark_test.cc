@@ -14,6 +14,8 @@
 // limitations under the License.
 //
 
+#include <cmath>
+
 #include "absl/strings/str_format.h"
 #include "benchmark/benchmark.h"
 #include "algorithms/distributions.h"
@@ -87,6 +89,32 @@ void BM_laplace_chi_squared(benchmark::State& state) {
 }
 BENCHMARK(BM_laplace_chi_squared);
 
+void BM_GeometricSample(benchmark::State& state,
+                        GeometricSamplingMethod method) {
+  GeometricDistribution dist(std::pow(10.0, -state.range(0)), method);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dist.Sample());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_GeometricSample, BinarySearch,
+                  GeometricSamplingMethod::kBinarySearch)
+    ->DenseRange(0, 12, 3);
+BENCHMARK_CAPTURE(BM_GeometricSample, Bitwise,
+                  GeometricSamplingMethod::kBitwise)
+    ->DenseRange(0, 12, 3);
+
+void BM_LaplaceSample(benchmark::State& state, GeometricSamplingMethod method) {
+  LaplaceDistribution dist(1.0, 1.0, method);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dist.Sample());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_LaplaceSample, BinarySearch,
+                  GeometricSamplingMethod::kBinarySearch);
+BENCHMARK_CAPTURE(BM_LaplaceSample, Bitwise, GeometricSamplingMethod::kBitwise);
+
 }  // namespace
 }  // namespace internal
 }  // namespace differential_privacy
@@ -16,6 +16,7 @@
 
 #include "algorithms/distributions.h"
 
+#include <tuple>
 #include <unordered_map>
 
 #include "gmock/gmock.h"
@@ -169,6 +170,44 @@ TEST(GeometricDistributionTest, LargeProbabilityStats) {
   EXPECT_NEAR(std::sqrt(2), std::sqrt(Variance(samples)), 0.05);
 }
 
+TEST(GeometricDistributionTest, BitwiseSmallProbabilityStats) {
+  GeometricDistribution dist(-1.0 * std::log(1.0 - 1e-6),
+                             GeometricSamplingMethod::kBitwise);
+  std::vector<int64_t> samples(kNumGeometricSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist]() { return dist.Sample() + 1; });
+  EXPECT_NEAR(1000000, Mean(samples), 10000);
+  EXPECT_NEAR(999999.5, std::sqrt(Variance(samples)), 10000);
+}
+
+TEST(GeometricDistributionTest, BitwiseLargeProbabilityStats) {
+  GeometricDistribution dist(-1.0 * std::log(1.0 - 0.5),
+                             GeometricSamplingMethod::kBitwise);
+  std::vector<int64_t> samples(kNumGeometricSamples);
+  std::generate(samples.begin(), samples.end(),
+                [&dist]() { return dist.Sample() + 1; });
+  EXPECT_NEAR(2, Mean(samples), 0.01);
+  EXPECT_NEAR(std::sqrt(2), std::sqrt(Variance(samples)), 0.05);
+}
+
+TEST(GeometricDistributionTest, BitwiseRespectsScale) {
+  GeometricDistribution dist(-1.0 * std::log(1.0 - 0.5),
+                             GeometricSamplingMethod::kBitwise);
+  std::vector<int64_t> samples(kNumGeometricSamples);
+  // Alternate between the precomputed scale and one computed per sample.
+  for (int i = 0; i < kNumGeometricSamples; ++i) {
+    samples[i] = i % 2 ? dist.Sample(2.0) : dist.Sample(1.0);
+  }
+  std::vector<int64_t> unscaled;
+  std::vector<int64_t> scaled;
+  for (int i = 0; i < kNumGeometricSamples; ++i) {
+    (i % 2 ? scaled : unscaled).push_back(samples[i] + 1);
+  }
+  EXPECT_NEAR(2, Mean(unscaled), 0.02);
+  // p = 1 - e^(-ln(2) / 2) = 1 - 1 / sqrt(2).
+  EXPECT_NEAR(1 / (1 - 1 / std::sqrt(2)), Mean(scaled), 0.02);
+}
+
 TEST(GeometricDistributionTest, Ratios) {
   double p = 1e-2;
   GeometricDistribution dist(-1.0 * std::log(1.0 - p));
@@ -187,6 +226,32 @@ TEST(GeometricDistributionTest, Ratios) {
   EXPECT_NEAR(p, Mean(ratios), p / 1e-2);
 }
 
+TEST(LaplaceDistributionTest, MemoryUsedCountsBitProbabilities) {
+  LaplaceDistribution binary_search(1.0, 1.0,
+                                    GeometricSamplingMethod::kBinarySearch);
+  LaplaceDistribution bitwise(1.0, 1.0, GeometricSamplingMethod::kBitwise);
+  EXPECT_GT(bitwise.MemoryUsed(), binary_search.MemoryUsed());
+}
+
+TEST(LaplaceDistributionTest, BitwiseMatchesBinarySearchStatistics) {
+  LaplaceDistribution binary_search(1.0, 1.0,
+                                    GeometricSamplingMethod::kBinarySearch);
+  LaplaceDistribution bitwise(1.0, 1.0, GeometricSamplingMethod::kBitwise);
+  std::vector<double> expected(kNumGeometricSamples);
+  std::vector<double> actual(kNumGeometricSamples);
+  std::generate(expected.begin(), expected.end(),
+                [&binary_search]() { return binary_search.Sample(1.0); });
+  std::generate(actual.begin(), actual.end(),
+                [&bitwise]() { return bitwise.Sample(1.0); });
+  EXPECT_EQ(binary_search.GetGranularity(), bitwise.GetGranularity());
+  EXPECT_NEAR(Mean(expected), Mean(actual), 0.02);
+  EXPECT_NEAR(Variance(expected), Variance(actual), 0.1);
+  double mean = Mean(actual);
+  double var = Variance(actual);
+  EXPECT_NEAR(0.0, Skew(actual, mean, std::sqrt(var)), 0.1);
+  EXPECT_NEAR(3.0, Kurtosis(actual, mean, var), 0.1);
+}
+
 // For Binomial/Poisson RVs this is mult standard deviations since var= mean.
 // Probability of failure with mult = 7 ~1e-23 if Gaussian approx holds, but it
 // does not for low values of x, so we have to  add another fudge factor.
@@ -232,12 +297,14 @@ std::vector<double> ExpectedCounts(const double p, const double one_minus_p,
   return result;
 }
 
-class GeometricDistributionTest : public ::testing::TestWithParam<double> {};
+class GeometricDistributionTest
+    : public ::testing::TestWithParam<
+          std::tuple<double, GeometricSamplingMethod>> {};
 
 TEST_P(GeometricDistributionTest, Distribution) {
-  auto lambda = GetParam();
+  double lambda = std::get<0>(GetParam());
 
-  GeometricDistribution distribution(lambda);
+  GeometricDistribution distribution(lambda, std::get<1>(GetParam()));
   // Choose bucket sizes so that the expected count in the first bucket is
   // 150.
   const int64_t kBucketSize =
@@ -309,14 +376,24 @@ std::vector<double> GenParams() {
   });
 }
 
-std::string ParamName(const ::testing::TestParamInfo<double>& info) {
-  const auto& p = info.param;
-  std::string name = absl::StrCat("L_", p);
+std::string ParamName(
+    const ::testing::TestParamInfo<std::tuple<double, GeometricSamplingMethod>>&
+        info) {
+  const double p = std::get<0>(info.param);
+  std::string name = absl::StrCat(
+      std::get<1>(info.param) == GeometricSamplingMethod::kBitwise
+          ? "Bitwise_"
+          : "BinarySearch_",
+      "L_", p);
   return absl::StrReplaceAll(name, {{"-", "_"}, {".", "_"}});
 }
 
-INSTANTIATE_TEST_SUITE_P(All, GeometricDistributionTest,
-                         ::testing::ValuesIn(GenParams()), ParamName);
+INSTANTIATE_TEST_SUITE_P(
+    All, GeometricDistributionTest,
+    ::testing::Combine(::testing::ValuesIn(GenParams()),
+                       ::testing::Values(GeometricSamplingMethod::kBinarySearch,
+                                         GeometricSamplingMethod::kBitwise)),
+    ParamName);
 
 TEST(GeometricDistribution, ImpossibleDoubles) {
   // Using std::geometric_distribution<int64_t> would fail this test, since it
@@ -56,6 +56,20 @@ class ZeroNoiseMechanism : public LaplaceMechanism {
     return result;
   }
 
+  void AddNoiseInPlace(absl::Span<double> results,
+                       double privacy_budget) override {}
+
+  base::StatusOr<double> ProbabilityOfNoisedValueAtLeast(
+      double result, double threshold, double privacy_budget) override {
+    return result >= threshold ? 1 : 0;
+  }
+
+  base::StatusOr<double> AddNoiseAtLeast(double result, double threshold,
+                                         double privacy_budget) override {
+    return base::InvalidArgumentError(
+        "Threshold has to be larger than the result.");
+  }
+
   base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
       double confidence_level, double privacy_budget) override {
     ConfidenceInterval confidence;
@@ -77,6 +91,12 @@ class SeededGeometricDistribution : public internal::GeometricDistribution {
     return absl::Uniform(*rand_gen_, 0, 1.0);
   }
 
+  void GetUniformDoubles(absl::Span<double> out) override {
+    for (double& uniform : out) {
+      uniform = GetUniformDouble();
+    }
+  }
+
  private:
   std::mt19937* rand_gen_;
 };
@@ -196,6 +216,17 @@ class MockLaplaceMechanism : public LaplaceMechanism {
   MockLaplaceMechanism(double epsilon, double sensitivity)
       : LaplaceMechanism(epsilon, sensitivity) {}
   MOCK_METHOD2_T(AddNoise, double(double result, double privacy_budget));
+
+  // Routes batches through the mocked AddNoise() so that expectations on it
+  // also cover batch callers.
+  void AddNoiseInPlace(absl::Span<double> results,
+                       double privacy_budget) override {
+    NumericalMechanism::AddNoiseInPlace(results, privacy_budget);
+  }
+
+  // The noise of AddNoise() is mocked, so callers have to draw all noise
+  // through it.
+  bool SupportsNoiseAtLeast() const override { return false; }
   MOCK_METHOD2_T(NoiseConfidenceInterval,
                  base::StatusOr<ConfidenceInterval>(double confidence_level,
                                                     double privacy_budget));
@@ -33,6 +33,7 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "algorithms/distributions.h"
 #include "algorithms/rand.h"
 #include "algorithms/util.h"
@@ -69,6 +70,17 @@ class NumericalMechanism {
 
   double AddNoise(double result) { return AddNoise(result, 1.0); }
 
+  // Adds noise to each of the results in place, spending privacy_budget on
+  // every one of them. Equivalent to calling AddNoise(result, privacy_budget)
+  // for each result, but allows mechanisms to derive the noise parameters once
+  // per batch instead of once per value.
+  virtual void AddNoiseInPlace(absl::Span<double> results,
+                               double privacy_budget) {
+    for (double& result : results) {
+      result = AddNoise(result, privacy_budget);
+    }
+  }
+
   // Quickly determines if result with added noise is greater than threshold.
   // This method allows for quicker thresholding decisions by using a uniform
   // random number instead of the slower (i.e., more complex to compute) noise
@@ -80,6 +92,32 @@ class NumericalMechanism {
   // http://citeseerx.ist.psu.edu/viewdoc/download?doi=10.1.1.366.5957&rep=rep1&type=pdf).
   virtual bool NoisedValueAboveThreshold(double result, double threshold) = 0;
 
+  // Returns whether ProbabilityOfNoisedValueAtLeast() and AddNoiseAtLeast()
+  // are implemented and describe the noise of AddNoise(). Only then may callers
+  // use them in place of AddNoise(). Subclasses that change AddNoise() without
+  // changing both of them accordingly have to return false.
+  virtual bool SupportsNoiseAtLeast() const { return false; }
+
+  // Returns the probability that AddNoise(result, privacy_budget) returns a
+  // value of at least threshold. Together with AddNoiseAtLeast(), this lets
+  // callers find which of many noised values reach a threshold without drawing
+  // the noise of each of them.
+  virtual base::StatusOr<double> ProbabilityOfNoisedValueAtLeast(
+      double result, double threshold, double privacy_budget) {
+    return base::UnimplementedError(
+        "ProbabilityOfNoisedValueAtLeast() unsupported for this numerical "
+        "mechanism.");
+  }
+
+  // Returns AddNoise(result, privacy_budget) conditioned on the noised value
+  // being at least threshold, which must be larger than result.
+  virtual base::StatusOr<double> AddNoiseAtLeast(double result,
+                                                 double threshold,
+                                                 double privacy_budget) {
+    return base::UnimplementedError(
+        "AddNoiseAtLeast() unsupported for this numerical mechanism.");
+  }
+
   virtual int64_t MemoryUsed() = 0;
 
   virtual base::StatusOr<ConfidenceInterval> NoiseConfidenceInterval(
@@ -164,6 +202,10 @@ class NumericalMechanismBuilder {
 
   virtual std::unique_ptr<NumericalMechanismBuilder> Clone() const = 0;
 
+  // Returns whether the built mechanisms spend delta, so that callers that
+  // split a delta between several releases only give it to those that do.
+  virtual bool UsesDelta() const { return false; }
+
  protected:
   // Checks if delta is set and valid to be used in the Gaussian mechanism.
   base::Status DeltaIsSetAndValid() const {
@@ -207,6 +249,17 @@ class LaplaceMechanism : public NumericalMechanism {
       return *this;
     }
 
+    // Selects the algorithm used to sample the underlying geometric
+    // distribution. Defaults to GeometricSamplingMethod::kBinarySearch. With
+    // kBitwise, AddNoise() with the full privacy budget uses per-digit
+    // probabilities precomputed on Build(), while every call with a smaller
+    // budget computes about 63 exponentials. Neither writes to the sampler, so
+    // both are safe to call on a shared mechanism.
+    Builder& SetGeometricSamplingMethod(GeometricSamplingMethod method) {
+      geometric_sampling_method_ = method;
+      return *this;
+    }
+
     base::StatusOr<std::unique_ptr<NumericalMechanism>> Build() override {
       ASSIGN_OR_RETURN(double epsilon,
                        GetValueIfSetAndPositive(GetEpsilon(), "Epsilon"));
@@ -226,7 +279,10 @@ class LaplaceMechanism : public NumericalMechanism {
       if (!gran_or_status.ok()) return gran_or_status.status();
 
       std::unique_ptr<NumericalMechanism> result =
-          absl::make_unique<LaplaceMechanism>(epsilon, L1);
+          absl::make_unique<LaplaceMechanism>(
+              epsilon, L1,
+              absl::make_unique<internal::LaplaceDistribution>(
+                  epsilon, L1, geometric_sampling_method_));
       return result;
     }
 
@@ -239,6 +295,8 @@ class LaplaceMechanism : public NumericalMechanism {
 
    private:
     absl::optional<double> l1_sensitivity_;
+    GeometricSamplingMethod geometric_sampling_method_ =
+        GeometricSamplingMethod::kBinarySearch;
 
     // Returns the l1 sensitivity when it has been set or returns an upper bound
     // on the l1 sensitivity calculated from l0 and linf sensitivities.
@@ -296,12 +354,44 @@ class LaplaceMechanism : public NumericalMechanism {
     return RoundToNearestMultiple(result, distro_->GetGranularity()) + sample;
   }
 
+  void AddNoiseInPlace(absl::Span<double> results,
+                       double privacy_budget) override {
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    RoundToNearestMultiples(results, distro_->GetGranularity());
+    double scale = 1.0 / privacy_budget;
+    for (double& result : results) {
+      result += distro_->Sample(scale);
+    }
+  }
+
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
     return UniformDouble() >
            internal::LaplaceDistribution::cdf(diversity_, threshold - result);
   }
 
+  bool SupportsNoiseAtLeast() const override { return true; }
+
+  base::StatusOr<double> ProbabilityOfNoisedValueAtLeast(
+      double result, double threshold, double privacy_budget) override {
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    double rounded = RoundToNearestMultiple(result, distro_->GetGranularity());
+    return distro_->ProbabilityOfSampleAtLeast(1.0 / privacy_budget,
+                                               threshold - rounded);
+  }
+
+  base::StatusOr<double> AddNoiseAtLeast(double result, double threshold,
+                                         double privacy_budget) override {
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    double rounded = RoundToNearestMultiple(result, distro_->GetGranularity());
+    if (!(threshold > rounded)) {
+      return base::InvalidArgumentError(
+          "Threshold has to be larger than the result.");
+    }
+    return rounded + distro_->SampleAtLeast(1.0 / privacy_budget,
+                                            threshold - rounded);
+  }
+
   virtual double GetUniformDouble() { return distro_->GetUniformDouble(); }
 
   // Returns the confidence interval of the specified confidence level of the
@@ -371,6 +461,8 @@ class GaussianMechanism : public NumericalMechanism {
       return absl::make_unique<Builder>(*this);
     }
 
+    bool UsesDelta() const override { return true; }
+
    protected:
     absl::optional<double> l2_sensitivity_;
 
@@ -410,7 +502,8 @@ class GaussianMechanism : public NumericalMechanism {
       : NumericalMechanism(epsilon),
         delta_(delta),
         l2_sensitivity_(l2_sensitivity),
-        distro_(absl::make_unique<internal::GaussianDistribution>(1)) {}
+        distro_(absl::make_unique<internal::GaussianDistribution>(1)),
+        stddev_(CalculateStddev(epsilon, delta)) {}
 
   virtual ~GaussianMechanism() = default;
 
@@ -425,15 +518,23 @@ class GaussianMechanism : public NumericalMechanism {
   double AddNoise(double result, double privacy_budget) override {
     privacy_budget = CheckAndClampBudget(privacy_budget);
 
-    double local_epsilon = privacy_budget * GetEpsilon();
-    double local_delta = privacy_budget * delta_;
-    double stddev = CalculateStddev(local_epsilon, local_delta);
+    double stddev = GetStddev(privacy_budget);
     double sample = distro_->Sample(stddev);
 
     return RoundToNearestMultiple(result, distro_->GetGranularity(stddev)) +
            sample;
   }
 
+  void AddNoiseInPlace(absl::Span<double> results,
+                       double privacy_budget) override {
+    privacy_budget = CheckAndClampBudget(privacy_budget);
+    double stddev = GetStddev(privacy_budget);
+    RoundToNearestMultiples(results, distro_->GetGranularity(stddev));
+    for (double& result : results) {
+      result += distro_->Sample(stddev);
+    }
+  }
+
   // Quickly determines if result is greater than threshold.
   bool NoisedValueAboveThreshold(double result, double threshold) override {
     return UniformDouble() > internal::GaussianDistribution::cdf(
@@ -464,9 +565,7 @@ class GaussianMechanism : public NumericalMechanism {
     RETURN_IF_ERROR(CheckConfidenceLevel(confidence_level));
     RETURN_IF_ERROR(CheckPrivacyBudget(privacy_budget));
 
-    double local_epsilon = privacy_budget * GetEpsilon();
-    double local_delta = privacy_budget * delta_;
-    double stddev = CalculateStddev(local_epsilon, local_delta);
+    double stddev = GetStddev(privacy_budget);
 
     ConfidenceInterval confidence;
     // calculated using the symmetric properties of the Gaussian distribution
@@ -526,6 +625,22 @@ class GaussianMechanism : public NumericalMechanism {
   double l2_sensitivity_;
   std::unique_ptr<internal::GaussianDistribution> distro_;
 
+  // The standard deviation for the full privacy budget, which most callers
+  // spend on every value. It is calibrated once on construction, so that
+  // adding noise does not re-run the search in CalculateStddev() and does not
+  // write to the mechanism.
+  const double stddev_;
+
+  // Returns CalculateStddev() for the epsilon and delta scaled by
+  // privacy_budget.
+  double GetStddev(double privacy_budget) {
+    if (privacy_budget == 1) {
+      return stddev_;
+    }
+    return CalculateStddev(privacy_budget * GetEpsilon(),
+                           privacy_budget * delta_);
+  }
+
   double StandardNormalDistributionCDF(double x) {
     return internal::GaussianDistribution::cdf(1, x);
   }
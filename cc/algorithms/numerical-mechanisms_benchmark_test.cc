@@ -0,0 +1,97 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "absl/types/span.h"
+#include "algorithms/numerical-mechanisms.h"
+
+namespace differential_privacy {
+namespace {
+
+// Noises state.range(0) values either one AddNoise() call at a time or with a
+// single AddNoiseInPlace() call.
+template <bool kInPlace>
+void NoiseValues(benchmark::State& state, NumericalMechanism& mechanism) {
+  std::vector<double> values(state.range(0), 1.0);
+  for (auto _ : state) {
+    if (kInPlace) {
+      mechanism.AddNoiseInPlace(absl::MakeSpan(values), 0.5);
+    } else {
+      for (double& value : values) {
+        value = mechanism.AddNoise(value, 0.5);
+      }
+    }
+    benchmark::DoNotOptimize(values.data());
+  }
+  state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+template <bool kInPlace>
+void BM_LaplaceAddNoise(benchmark::State& state) {
+  std::unique_ptr<NumericalMechanism> mechanism =
+      LaplaceMechanism::Builder()
+          .SetGeometricSamplingMethod(GeometricSamplingMethod::kBitwise)
+          .SetL1Sensitivity(1.0)
+          .SetEpsilon(1.0)
+          .Build()
+          .ValueOrDie();
+  NoiseValues<kInPlace>(state, *mechanism);
+}
+BENCHMARK_TEMPLATE(BM_LaplaceAddNoise, false)->Range(1, 1 << 16);
+BENCHMARK_TEMPLATE(BM_LaplaceAddNoise, true)->Range(1, 1 << 16);
+
+template <bool kInPlace>
+void BM_GaussianAddNoise(benchmark::State& state) {
+  std::unique_ptr<NumericalMechanism> mechanism =
+      GaussianMechanism::Builder()
+          .SetL2Sensitivity(1.0)
+          .SetEpsilon(1.0)
+          .SetDelta(1e-5)
+          .Build()
+          .ValueOrDie();
+  NoiseValues<kInPlace>(state, *mechanism);
+}
+BENCHMARK_TEMPLATE(BM_GaussianAddNoise, false)->Range(1, 1 << 16);
+BENCHMARK_TEMPLATE(BM_GaussianAddNoise, true)->Range(1, 1 << 16);
+
+// The cost of calibrating the Gaussian noise, which AddNoise() only pays for
+// privacy budgets other than the full budget.
+void BM_GaussianCalculateStddev(benchmark::State& state) {
+  GaussianMechanism mechanism(1.0, 1e-5, 1.0);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism.CalculateStddev(0.5, 0.5e-5));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GaussianCalculateStddev);
+
+// Alternates between two partial budgets, which are calibrated on every call.
+void BM_GaussianAddNoiseAlternatingBudgets(benchmark::State& state) {
+  GaussianMechanism mechanism(1.0, 1e-5, 1.0);
+  double budget = 0.5;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(mechanism.AddNoise(1.0, budget));
+    budget = budget == 0.5 ? 0.25 : 0.5;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GaussianAddNoiseAlternatingBudgets);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -23,6 +23,7 @@
 #include "gtest/gtest.h"
 #include "base/statusor.h"
 #include "algorithms/distributions.h"
+#include "algorithms/util.h"
 
 namespace differential_privacy {
 namespace {
@@ -207,6 +208,44 @@ TEST(NumericalMechanismsTest, LaplaceAddsNoise) {
   EXPECT_THAT(mechanism.AddNoise(0.0), DoubleNear(10.0, 5.0));
 }
 
+TEST(NumericalMechanismsTest, LaplaceBuilderBitwiseSamplingAddsNoise) {
+  auto mechanism =
+      LaplaceMechanism::Builder()
+          .SetGeometricSamplingMethod(GeometricSamplingMethod::kBitwise)
+          .SetL1Sensitivity(1.0)
+          .SetEpsilon(1.0)
+          .Build();
+  ASSERT_OK(mechanism);
+
+  std::vector<double> samples(100000);
+  for (double& sample : samples) {
+    sample = (*mechanism)->AddNoise(0.0);
+  }
+  EXPECT_NEAR(Mean(samples), 0.0, 0.05);
+  EXPECT_NEAR(Variance(samples), 2.0, 0.1);
+}
+
+TEST(NumericalMechanismsTest, LaplaceAddsNoiseInPlace) {
+  auto distro = absl::make_unique<MockLaplaceDistribution>();
+  ON_CALL(*distro, Sample(_)).WillByDefault(Return(10.0));
+  LaplaceMechanism mechanism(1.0, 1.0, std::move(distro));
+
+  std::vector<double> results = {0.0, 1.0, -2.5};
+  mechanism.AddNoiseInPlace(absl::MakeSpan(results), 1.0);
+  EXPECT_THAT(results[0], DoubleNear(10.0, 1e-6));
+  EXPECT_THAT(results[1], DoubleNear(11.0, 1e-6));
+  EXPECT_THAT(results[2], DoubleNear(7.5, 1e-6));
+}
+
+TEST(NumericalMechanismsTest, LaplaceAddsNoiseInPlaceWithBudget) {
+  LaplaceMechanism mechanism(1.0, 1.0);
+  std::vector<double> results(100000, 5.0);
+  mechanism.AddNoiseInPlace(absl::MakeSpan(results), 0.5);
+  // Halving the budget doubles the diversity to 2, so the variance is 8.
+  EXPECT_NEAR(Mean(results), 5.0, 0.1);
+  EXPECT_NEAR(Variance(results), 8.0, 0.4);
+}
+
 TEST(NumericalMechanismsTest, LaplaceAddsNoNoiseWhenSensitivityIsZero) {
   LaplaceMechanism mechanism(1.0, 0.0);
 
@@ -245,6 +284,80 @@ TEST(NumericalMechanismsTest, LaplaceNoisedValueAboveThreshold) {
   }
 }
 
+TEST(NumericalMechanismsTest, SupportsNoiseAtLeast) {
+  std::unique_ptr<NumericalMechanism> laplace =
+      LaplaceMechanism::Builder().SetEpsilon(1).Build().ValueOrDie();
+  EXPECT_TRUE(laplace->SupportsNoiseAtLeast());
+  std::unique_ptr<NumericalMechanism> gaussian = GaussianMechanism::Builder()
+                                                     .SetL2Sensitivity(1)
+                                                     .SetEpsilon(1)
+                                                     .SetDelta(1e-5)
+                                                     .Build()
+                                                     .ValueOrDie();
+  EXPECT_FALSE(gaussian->SupportsNoiseAtLeast());
+}
+
+TEST(NumericalMechanismsTest, UsesDelta) {
+  EXPECT_FALSE(LaplaceMechanism::Builder().UsesDelta());
+  EXPECT_TRUE(GaussianMechanism::Builder().UsesDelta());
+}
+
+TEST(NumericalMechanismsTest, LaplaceProbabilityOfNoisedValueAtLeast) {
+  LaplaceMechanism::Builder builder;
+  std::unique_ptr<NumericalMechanism> mechanism =
+      builder.SetL1Sensitivity(1).SetEpsilon(1).Build().ValueOrDie();
+
+  struct TestScenario {
+    double input;
+    double threshold;
+    double privacy_budget;
+  };
+  std::vector<TestScenario> test_scenarios = {
+      {0.0, 2.0, 1.0}, {0.0, 2.0, 0.5}, {1.0, -0.5, 1.0}, {3.0, 3.0, 1.0}};
+
+  const int num_samples = 100000;
+  for (TestScenario ts : test_scenarios) {
+    double num_at_least = 0;
+    for (int i = 0; i < num_samples; ++i) {
+      if (mechanism->AddNoise(ts.input, ts.privacy_budget) >= ts.threshold) {
+        ++num_at_least;
+      }
+    }
+    base::StatusOr<double> probability =
+        mechanism->ProbabilityOfNoisedValueAtLeast(ts.input, ts.threshold,
+                                                   ts.privacy_budget);
+    ASSERT_OK(probability);
+    EXPECT_NEAR(num_at_least / num_samples, probability.value(), 0.01);
+  }
+}
+
+TEST(NumericalMechanismsTest, LaplaceAddNoiseAtLeast) {
+  LaplaceMechanism::Builder builder;
+  std::unique_ptr<NumericalMechanism> mechanism =
+      builder.SetL1Sensitivity(1).SetEpsilon(1).Build().ValueOrDie();
+
+  // Compares the conditioned noise to rejection sampling of AddNoise().
+  const int num_samples = 20000;
+  double sum_conditioned = 0;
+  double sum_rejection_sampled = 0;
+  for (int i = 0; i < num_samples; ++i) {
+    base::StatusOr<double> conditioned = mechanism->AddNoiseAtLeast(0, 1.5, 1);
+    ASSERT_OK(conditioned);
+    EXPECT_GE(conditioned.value(), 1.5);
+    sum_conditioned += conditioned.value();
+    double noised;
+    do {
+      noised = mechanism->AddNoise(0, 1);
+    } while (noised < 1.5);
+    sum_rejection_sampled += noised;
+  }
+  EXPECT_NEAR(sum_conditioned / num_samples,
+              sum_rejection_sampled / num_samples, 0.05);
+
+  EXPECT_THAT(mechanism->AddNoiseAtLeast(1, 0, 1),
+              StatusIs(base::StatusCode::kInvalidArgument));
+}
+
 TEST(NumericalMechanismsTest, LaplaceDiversityCorrect) {
   LaplaceMechanism mechanism(1.0, 1.0);
   EXPECT_EQ(mechanism.GetDiversity(), 1.0);
@@ -401,6 +514,23 @@ TEST_P(NoiseIntervalMultipleParametersTests, GaussNoiseConfidenceInterval) {
   EXPECT_EQ(confidence_interval->confidence_level(), conf_level);
 }
 
+TEST(NumericalMechanismsTest, GaussianConfidenceIntervalTracksBudgetChanges) {
+  // The stddev of the full budget is calibrated on construction, so other
+  // budgets must still yield the intervals of a freshly constructed mechanism.
+  GaussianMechanism mechanism(1.0, 1e-5, 1.0);
+  for (double budget : {1.0, 0.5, 0.5, 1.0, 0.25}) {
+    GaussianMechanism fresh_mechanism(1.0, 1e-5, 1.0);
+    base::StatusOr<ConfidenceInterval> expected =
+        fresh_mechanism.NoiseConfidenceInterval(0.95, budget);
+    base::StatusOr<ConfidenceInterval> actual =
+        mechanism.NoiseConfidenceInterval(0.95, budget);
+    ASSERT_OK(expected);
+    ASSERT_OK(actual);
+    EXPECT_EQ(actual->lower_bound(), expected->lower_bound()) << budget;
+    EXPECT_EQ(actual->upper_bound(), expected->upper_bound()) << budget;
+  }
+}
+
 TEST(NumericalMechanismsTest, LaplaceEstimatesL1WithL0AndLInf) {
   LaplaceMechanism::Builder builder;
   auto mechanism =
@@ -564,6 +694,16 @@ TEST(NumericalMechanismsTest, GaussianMechanismAddsNoise) {
   EXPECT_FALSE(std::isnan(mechanism.AddNoise(1.1, 2.0)));
 }
 
+TEST(NumericalMechanismsTest, GaussianMechanismAddsNoiseInPlace) {
+  GaussianMechanism mechanism(1.0, 1e-5, 1.0);
+  double stddev = mechanism.CalculateStddev(0.5, 0.5e-5);
+
+  std::vector<double> results(100000, -3.0);
+  mechanism.AddNoiseInPlace(absl::MakeSpan(results), 0.5);
+  EXPECT_NEAR(Mean(results), -3.0, 0.1);
+  EXPECT_NEAR(std::sqrt(Variance(results)), stddev, 0.05 * stddev);
+}
+
 TEST(NumericalMechanismsTest,
      GaussianMechanismAddsNoiseForHighEpsilonAndLowDelta) {
   auto test_mechanism = GaussianMechanism::Builder()
@@ -22,12 +22,14 @@
 #include "absl/random/distributions.h"
 #include "algorithms/numerical-mechanisms-testing.h"
 #include "algorithms/util.h"
+#include "base/radix_sort.h"
 
 namespace differential_privacy {
 namespace continuous {
 namespace {
 
 using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
 using ::testing::HasSubstr;
 using ::differential_privacy::base::testing::StatusIs;
 
@@ -89,6 +91,55 @@ TEST(OrderStatisticsTest, Median) {
   EXPECT_EQ(GetValue<int64_t>(*result), 100);
 }
 
+TEST(OrderStatisticsTest, MedianBinarySerializeMerge) {
+  Median<int64_t>::Builder builder;
+  builder.SetLower(0).SetUpper(2048).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search1 = builder.Build();
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search2 = builder.Build();
+  ASSERT_OK(search1);
+  ASSERT_OK(search2);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (i < kDataSize / 2 ? *search1 : *search2)
+        ->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  // Median has no binary layout of its own, so its summary proto is embedded.
+  std::string summary;
+  (*search2)->SerializeToBinary(&summary);
+  EXPECT_OK((*search1)->MergeFromBinary(summary));
+  base::StatusOr<Output> result = (*search1)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 100);
+}
+
+TEST(OrderStatisticsTest, MedianMergeFrom) {
+  Median<int64_t>::Builder builder;
+  builder.SetLower(0).SetUpper(2048).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search1 = builder.Build();
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search2 = builder.Build();
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search3 = builder.Build();
+  ASSERT_OK(search1);
+  ASSERT_OK(search2);
+  ASSERT_OK(search3);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (i % 3 == 0 ? *search1 : i % 3 == 1 ? *search2 : *search3)
+        ->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  EXPECT_OK((*search1)->MergeFrom(**search2));
+  EXPECT_OK((*search1)->MergeFrom(std::move(**search3)));
+  base::StatusOr<Output> result = (*search1)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 100);
+
+  base::StatusOr<std::unique_ptr<Max<int64_t>>> max =
+      Max<int64_t>::Builder().SetLower(0).SetUpper(2048).Build();
+  ASSERT_OK(max);
+  EXPECT_THAT((*search1)->MergeFrom(**max),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("different type")));
+}
+
 TEST(OrderStatisticsTest, MedianLinfIncreasesVariance) {
   // Median is 0
   const std::vector<double> input = {1, 0, 0, -1};
@@ -153,6 +204,25 @@ TEST(OrderStatisticsTest, PercentileGetter) {
   EXPECT_EQ((*percentile)->GetPercentile(), expectedPercentile);
 }
 
+TEST(OrderStatisticsTest, MedianSortsOnSeveralThreads) {
+  base::StatusOr<std::unique_ptr<Median<int64_t>>> search =
+      Median<int64_t>::Builder()
+          .SetEpsilon(std::log(3))
+          .SetLower(0)
+          .SetUpper(2048)
+          .SetSortThreads(4)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(search);
+  // Enough inputs for the radix sort to split them over the threads.
+  for (int64_t i = 0; i < 4 * base::kMinValuesPerSortThread; ++i) {
+    (*search)->AddEntry((i * 7919) % 201);
+  }
+  base::StatusOr<Output> result = (*search)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 100);
+}
+
 TEST(OrderStatisticsTest, InvalidParameters) {
   Percentile<int64_t>::Builder builder;
   EXPECT_OK(builder.SetPercentile(.9).SetLower(1).SetUpper(2).Build());
@@ -166,6 +236,41 @@ TEST(OrderStatisticsTest, InvalidParameters) {
   EXPECT_THAT(builder.SetPercentile(2).Build(),
               StatusIs(base::StatusCode::kInvalidArgument,
                        HasSubstr("Percentile must be between 0 and 1")));
+  EXPECT_THAT(builder.SetPercentile(.9).SetSortThreads(0).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("number of sort threads")));
+}
+
+TEST(OrderStatisticsTest, Quantiles) {
+  base::StatusOr<std::unique_ptr<Quantiles<int64_t>>> search =
+      Quantiles<int64_t>::Builder()
+          .SetQuantiles({.1, .45, .9})
+          .SetEpsilon(std::log(3))
+          .SetLower(0)
+          .SetUpper(2048)
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  ASSERT_OK(search);
+  EXPECT_THAT((*search)->GetQuantiles(), ElementsAre(.1, .45, .9));
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*search)->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  base::StatusOr<Output> result = (*search)->PartialResult(1.0);
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 3);
+  EXPECT_EQ(result->elements(0).value().int_value(), 20);
+  EXPECT_EQ(result->elements(1).value().int_value(), 90);
+  EXPECT_EQ(result->elements(2).value().int_value(), 180);
+}
+
+TEST(OrderStatisticsTest, InvalidQuantiles) {
+  Quantiles<int64_t>::Builder builder;
+  EXPECT_THAT(builder.SetQuantiles({}).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one quantile")));
+  EXPECT_THAT(builder.SetQuantiles({.5, 1.5}).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Quantiles must be between 0 and 1")));
 }
 
 TEST(OrderStatisticsTest, Median_DefaultBounds) {
@@ -0,0 +1,156 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PARALLEL_MERGE_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PARALLEL_MERGE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "base/status.h"
+#include "absl/types/span.h"
+#include "base/run_on_threads.h"
+#include "proto/summary.pb.h"
+#include "base/canonical_errors.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Each thread of a parallel merge merges at least this many inputs.
+const int64_t kMinInputsPerMergeThread = 256;
+
+// Merges num_inputs inputs into a new algorithm and returns it ready for
+// PartialResult(). make_algorithm() returns a base::StatusOr of a new
+// std::unique_ptr to an algorithm, and merge_input(i, algorithm) merges input i
+// into algorithm and returns its status. Up to num_threads algorithms are made,
+// each of which merges a contiguous chunk of the inputs on its own thread. The
+// algorithms are then merged pairwise in a tree with Algorithm::MergeFrom(),
+// all merges of a level of the tree in parallel. Returns the first error of a
+// chunk if merging fails.
+//
+// make_algorithm is called on the calling thread only, but up to num_threads
+// times, and every call has to return a fresh algorithm with the same
+// parameters, so that they can be merged into each other. Calling Build() of an
+// algorithm builder does that as long as the builder hands out copies of its
+// settings, as the builders of this library do; a builder that moves a setting
+// into the first algorithm it builds has to be recreated in make_algorithm.
+template <typename MakeAlgorithm, typename MergeInput>
+auto ParallelMerge(const MakeAlgorithm& make_algorithm, int64_t num_inputs,
+                   const MergeInput& merge_input, int num_threads)
+    -> decltype(make_algorithm()) {
+  using AlgorithmPtr = typename decltype(make_algorithm())::element_type;
+  num_threads = static_cast<int>(std::max<int64_t>(
+      1, std::min<int64_t>(num_threads,
+                           num_inputs / kMinInputsPerMergeThread)));
+
+  // make_algorithm need not be thread safe, so all algorithms are made up
+  // front.
+  std::vector<AlgorithmPtr> algorithms;
+  for (int i = 0; i < num_threads; ++i) {
+    ASSIGN_OR_RETURN(AlgorithmPtr algorithm, make_algorithm());
+    algorithms.push_back(std::move(algorithm));
+  }
+
+  std::vector<base::Status> statuses(num_threads);
+  base::RunOnThreads(num_threads, [&](int chunk) {
+    const int64_t end = num_inputs * (chunk + 1) / num_threads;
+    for (int64_t i = num_inputs * chunk / num_threads;
+         i < end && statuses[chunk].ok(); ++i) {
+      statuses[chunk] = merge_input(i, algorithms[chunk].get());
+    }
+  });
+
+  // Each level merges algorithm i + stride into algorithm i, for i a multiple
+  // of twice the stride.
+  for (int stride = 1; stride < num_threads; stride *= 2) {
+    const int num_merges = (num_threads + stride - 1) / (2 * stride);
+    base::RunOnThreads(num_merges, [&](int merge) {
+      const int i = 2 * stride * merge;
+      if (!statuses[i].ok()) {
+        return;
+      }
+      if (!statuses[i + stride].ok()) {
+        statuses[i] = statuses[i + stride];
+        return;
+      }
+      statuses[i] =
+          algorithms[i]->MergeFrom(std::move(*algorithms[i + stride]));
+    });
+  }
+  RETURN_IF_ERROR(statuses[0]);
+  return std::move(algorithms[0]);
+}
+
+// Merges summaries into a new algorithm made by make_algorithm with
+// ParallelMerge(), e.g.
+//
+//   MergeSummaries([&builder] { return builder.Build(); }, summaries);
+template <typename MakeAlgorithm>
+auto MergeSummaries(const MakeAlgorithm& make_algorithm,
+                    absl::Span<const Summary> summaries,
+                    int num_threads = std::thread::hardware_concurrency())
+    -> decltype(make_algorithm()) {
+  return ParallelMerge(
+      make_algorithm, summaries.size(),
+      [summaries](int64_t i, auto* algorithm) {
+        return algorithm->Merge(summaries[i]);
+      },
+      num_threads);
+}
+
+// Same as above, but for serialized Summary protos, which are parsed on the
+// merging threads as well.
+template <typename MakeAlgorithm>
+auto MergeSerializedSummaries(
+    const MakeAlgorithm& make_algorithm,
+    absl::Span<const std::string> summaries,
+    int num_threads = std::thread::hardware_concurrency())
+    -> decltype(make_algorithm()) {
+  return ParallelMerge(
+      make_algorithm, summaries.size(),
+      [summaries](int64_t i, auto* algorithm) {
+        Summary summary;
+        if (!summary.ParseFromString(summaries[i])) {
+          return base::InternalError("Summary unable to be parsed.");
+        }
+        return algorithm->Merge(summary);
+      },
+      num_threads);
+}
+
+// Same as above, but for summaries written by Algorithm::SerializeToBinary().
+template <typename MakeAlgorithm>
+auto MergeBinarySummaries(
+    const MakeAlgorithm& make_algorithm,
+    absl::Span<const std::string> summaries,
+    int num_threads = std::thread::hardware_concurrency())
+    -> decltype(make_algorithm()) {
+  return ParallelMerge(
+      make_algorithm, summaries.size(),
+      [summaries](int64_t i, auto* algorithm) {
+        return algorithm->MergeFromBinary(summaries[i]);
+      },
+      num_threads);
+}
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PARALLEL_MERGE_H_
@@ -0,0 +1,94 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/bounded-mean.h"
+#include "algorithms/order-statistics.h"
+#include "algorithms/parallel-merge.h"
+#include "proto/summary.pb.h"
+
+namespace differential_privacy {
+namespace {
+
+// Summaries of BoundedMeans with automatic bounds, each holding partial sums
+// and bin counts of a few bins.
+std::vector<Summary> BoundedMeanSummaries(int num_summaries) {
+  BoundedMean<int64_t>::Builder builder;
+  builder.SetEpsilon(1);
+  std::vector<Summary> summaries;
+  for (int i = 0; i < num_summaries; ++i) {
+    std::unique_ptr<BoundedMean<int64_t>> mean = builder.Build().ValueOrDie();
+    for (int j = 0; j < 4; ++j) {
+      mean->AddEntry((int64_t{i} * 4 + j) * 7919 % 100000 - 50000);
+    }
+    summaries.push_back(mean->Serialize());
+  }
+  return summaries;
+}
+
+// Summaries of exact percentiles, each holding 16 inputs.
+std::vector<Summary> BinarySearchSummaries(int num_summaries) {
+  continuous::Median<int64_t>::Builder builder;
+  builder.SetEpsilon(1).SetLower(0).SetUpper(100000);
+  std::vector<Summary> summaries;
+  for (int i = 0; i < num_summaries; ++i) {
+    std::unique_ptr<continuous::Median<int64_t>> median =
+        builder.Build().ValueOrDie();
+    for (int j = 0; j < 16; ++j) {
+      median->AddEntry((int64_t{i} * 16 + j) * 7919 % 100000);
+    }
+    summaries.push_back(median->Serialize());
+  }
+  return summaries;
+}
+
+// Merges state.range(0) summaries on state.range(1) threads.
+void BM_MergeBoundedMeanSummaries(benchmark::State& state) {
+  std::vector<Summary> summaries = BoundedMeanSummaries(state.range(0));
+  BoundedMean<int64_t>::Builder builder;
+  builder.SetEpsilon(1);
+  for (auto _ : state) {
+    auto merged = MergeSummaries([&builder] { return builder.Build(); },
+                                 summaries, state.range(1));
+    benchmark::DoNotOptimize(merged);
+  }
+  state.SetItemsProcessed(state.iterations() * summaries.size());
+}
+BENCHMARK(BM_MergeBoundedMeanSummaries)
+    ->ArgsProduct({{1 << 10, 1 << 14}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+void BM_MergeBinarySearchSummaries(benchmark::State& state) {
+  std::vector<Summary> summaries = BinarySearchSummaries(state.range(0));
+  continuous::Median<int64_t>::Builder builder;
+  builder.SetEpsilon(1).SetLower(0).SetUpper(100000);
+  for (auto _ : state) {
+    auto merged = MergeSummaries([&builder] { return builder.Build(); },
+                                 summaries, state.range(1));
+    benchmark::DoNotOptimize(merged);
+  }
+  state.SetItemsProcessed(state.iterations() * summaries.size());
+}
+BENCHMARK(BM_MergeBinarySearchSummaries)
+    ->ArgsProduct({{1 << 10, 1 << 14}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,178 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/parallel-merge.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/order-statistics.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::HasSubstr;
+using ::differential_privacy::base::testing::StatusIs;
+
+constexpr int kNumSummaries = 3000;
+
+TEST(ParallelMergeTest, MergeSummaries) {
+  BoundedSum<int64_t>::Builder builder;
+  builder.SetLower(0).SetUpper(100).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto make_algorithm = [&builder] { return builder.Build(); };
+  std::vector<Summary> summaries;
+  int64_t expected = 0;
+  for (int i = 0; i < kNumSummaries; ++i) {
+    std::unique_ptr<BoundedSum<int64_t>> sum = builder.Build().ValueOrDie();
+    sum->AddEntry(i % 200);
+    expected += std::min(i % 200, 100);
+    summaries.push_back(sum->Serialize());
+  }
+  for (int num_threads : {1, 2, 3, 8}) {
+    base::StatusOr<std::unique_ptr<BoundedSum<int64_t>>> merged =
+        MergeSummaries(make_algorithm, summaries, num_threads);
+    ASSERT_OK(merged);
+    base::StatusOr<Output> result = (*merged)->PartialResult();
+    ASSERT_OK(result);
+    EXPECT_EQ(GetValue<int64_t>(*result), expected) << num_threads;
+  }
+}
+
+TEST(ParallelMergeTest, MergeSerializedAndBinarySummaries) {
+  Count<int64_t>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto make_algorithm = [&builder] { return builder.Build(); };
+  std::vector<std::string> serialized;
+  std::vector<std::string> binary;
+  for (int i = 0; i < kNumSummaries; ++i) {
+    std::unique_ptr<Count<int64_t>> count = builder.Build().ValueOrDie();
+    for (int j = 0; j < i % 3; ++j) {
+      count->AddEntry(j);
+    }
+    serialized.push_back(count->Serialize().SerializeAsString());
+    binary.emplace_back();
+    count->SerializeToBinary(&binary.back());
+  }
+  base::StatusOr<std::unique_ptr<Count<int64_t>>> merged =
+      MergeSerializedSummaries(make_algorithm, serialized, 4);
+  ASSERT_OK(merged);
+  base::StatusOr<Output> result = (*merged)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), kNumSummaries);
+
+  merged = MergeBinarySummaries(make_algorithm, binary, 4);
+  ASSERT_OK(merged);
+  result = (*merged)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), kNumSummaries);
+}
+
+TEST(ParallelMergeTest, MergeBinarySearchSummaries) {
+  continuous::Median<int64_t>::Builder builder;
+  builder.SetLower(0).SetUpper(2048).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto make_algorithm = [&builder] { return builder.Build(); };
+  std::vector<Summary> summaries;
+  for (int i = 0; i < kNumSummaries; ++i) {
+    std::unique_ptr<continuous::Median<int64_t>> median =
+        builder.Build().ValueOrDie();
+    median->AddEntry((i * 7) % 201);
+    median->AddEntry((i * 13) % 201);
+    summaries.push_back(median->Serialize());
+  }
+  base::StatusOr<std::unique_ptr<continuous::Median<int64_t>>> merged =
+      MergeSummaries(make_algorithm, summaries, 4);
+  ASSERT_OK(merged);
+  base::StatusOr<Output> result = (*merged)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 100);
+}
+
+TEST(ParallelMergeTest, NoSummaries) {
+  Count<int64_t>::Builder builder;
+  builder.SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>());
+  auto make_algorithm = [&builder] { return builder.Build(); };
+  base::StatusOr<std::unique_ptr<Count<int64_t>>> merged =
+      MergeSummaries(make_algorithm, {}, 4);
+  ASSERT_OK(merged);
+  base::StatusOr<Output> result = (*merged)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 0);
+}
+
+TEST(ParallelMergeTest, ReturnsFirstError) {
+  Count<int64_t>::Builder builder;
+  auto make_algorithm = [&builder] { return builder.Build(); };
+  std::vector<std::string> serialized(kNumSummaries);
+  std::unique_ptr<Count<int64_t>> count = builder.Build().ValueOrDie();
+  for (std::string& summary : serialized) {
+    summary = count->Serialize().SerializeAsString();
+  }
+  serialized[kNumSummaries / 2] = "not a summary";
+  EXPECT_THAT(MergeSerializedSummaries(make_algorithm, serialized, 4),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("unable to be parsed")));
+  serialized[kNumSummaries / 2] = Summary().SerializeAsString();
+  EXPECT_THAT(MergeSerializedSummaries(make_algorithm, serialized, 4),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("no count")));
+}
+
+TEST(ParallelMergeTest, MakesOneAlgorithmPerThread) {
+  std::vector<Summary> summaries;
+  for (int i = 0; i < kNumSummaries; ++i) {
+    std::unique_ptr<Count<int64_t>> count =
+        Count<int64_t>::Builder().Build().ValueOrDie();
+    count->AddEntry(i);
+    summaries.push_back(count->Serialize());
+  }
+  int num_made = 0;
+  auto make_algorithm = [&num_made] {
+    ++num_made;
+    return Count<int64_t>::Builder()
+        .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+        .Build();
+  };
+  base::StatusOr<std::unique_ptr<Count<int64_t>>> merged =
+      MergeSummaries(make_algorithm, summaries, 4);
+  ASSERT_OK(merged);
+  EXPECT_EQ(num_made, 4);
+  base::StatusOr<Output> result = (*merged)->PartialResult();
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), kNumSummaries);
+
+  auto fail_after_first = [&num_made]() -> decltype(make_algorithm()) {
+    if (num_made++ > 0) {
+      return base::InvalidArgumentError("Builder already used.");
+    }
+    return Count<int64_t>::Builder().Build();
+  };
+  num_made = 0;
+  EXPECT_THAT(MergeSummaries(fail_after_first, summaries, 4),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("already used")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
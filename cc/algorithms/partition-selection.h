@@ -19,18 +19,42 @@
 
 #include <math.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/statusor.h"
+#include "absl/types/span.h"
 #include "algorithms/numerical-mechanisms.h"
 #include "algorithms/rand.h"
 #include "base/canonical_errors.h"
 #include "base/status_macros.h"
 
 namespace differential_privacy {
+namespace internal {
+
+// Hands out uniform doubles in [0, 1) that are drawn from the secure random
+// source kBlockSize at a time, for the batch partition selection methods.
+class UniformDoubleBlock {
+ public:
+  double Next() {
+    if (next_ == kBlockSize) {
+      UniformDoubles(absl::MakeSpan(uniforms_));
+      next_ = 0;
+    }
+    return uniforms_[next_++];
+  }
+
+ private:
+  static constexpr int kBlockSize = 256;
+  double uniforms_[kBlockSize];
+  int next_ = kBlockSize;
+};
+
+}  // namespace internal
 
 // Provides a common abstraction for PartitionSelectionStrategy. Each partition
 // selection strategy class has a builder with which it can be instantiated, and
@@ -104,6 +128,19 @@ class PartitionSelectionStrategy {
   // should be kept and false otherwise.
   virtual bool ShouldKeep(int num_users) = 0;
 
+  // Appends the index i of every partition that should be kept to
+  // kept_partitions, where num_users[i] is the number of users of partition i.
+  // Equivalent to calling ShouldKeep() on each partition in order, but allows
+  // strategies to share their setup and random bits across partitions.
+  virtual void SelectPartitions(absl::Span<const int> num_users,
+                                std::vector<int64_t>* kept_partitions) {
+    for (int64_t i = 0; i < num_users.size(); ++i) {
+      if (ShouldKeep(num_users[i])) {
+        kept_partitions->push_back(i);
+      }
+    }
+  }
+
  protected:
   PartitionSelectionStrategy(double epsilon, double delta,
                              int64_t max_partitions_contributed,
@@ -164,6 +201,11 @@ class PartitionSelectionStrategy {
 
   double GetAdjustedDelta() const { return adjusted_delta_; }
 
+  // ShouldKeep() only ever sees integer user counts, so strategies precompute
+  // their keep decision for the most common counts, [0,
+  // kMaxPrecomputedUserCount), and fall back to computing it for other counts.
+  static constexpr int kMaxPrecomputedUserCount = 1 << 12;
+
   // We must derive an adjusted delta, to be used as the probability of keeping
   // a single partition with one user, from delta, the probability we keep any
   // of the partitions contributed to by a single user.  Since the probability
@@ -248,10 +290,26 @@ class PreaggPartitionSelection : public PartitionSelectionStrategy {
   double GetSecondCrossover() const { return crossover_2_; }
 
   bool ShouldKeep(int num_users) override {
+    // Partitions beyond the second crossover are kept with probability 1.
+    if (num_users > crossover_2_) {
+      return true;
+    }
     // generate a random number between 0 and 1
     double rand_num = UniformDouble();
     // only keep partition if random number < expected probability of keep
-    return (rand_num <= ProbabilityOfKeep(num_users));
+    return (rand_num <= PrecomputedProbabilityOfKeep(num_users));
+  }
+
+  void SelectPartitions(absl::Span<const int> num_users,
+                        std::vector<int64_t>* kept_partitions) override {
+    internal::UniformDoubleBlock uniforms;
+    for (int64_t i = 0; i < num_users.size(); ++i) {
+      const int n = num_users[i];
+      if (n > crossover_2_ ||
+          uniforms.Next() <= PrecomputedProbabilityOfKeep(n)) {
+        kept_partitions->push_back(i);
+      }
+    }
   }
 
  protected:
@@ -268,6 +326,14 @@ class PreaggPartitionSelection : public PartitionSelectionStrategy {
         crossover_1_ + floor((1.0 / adjusted_epsilon_) *
                              log1p((expm1(adjusted_epsilon_) / adjusted_delta) *
                                    (1 - ProbabilityOfKeep(crossover_1_))));
+
+    // Counts above crossover_2_ are always kept and need no table entry.
+    int num_precomputed = static_cast<int>(std::max(
+        0.0, std::min<double>(kMaxPrecomputedUserCount, crossover_2_ + 1)));
+    keep_probabilities_.resize(num_precomputed);
+    for (int n = 0; n < num_precomputed; ++n) {
+      keep_probabilities_[n] = ProbabilityOfKeep(n);
+    }
   }
 
  private:
@@ -275,6 +341,16 @@ class PreaggPartitionSelection : public PartitionSelectionStrategy {
   double crossover_1_;
   double crossover_2_;
 
+  // ProbabilityOfKeep(n) for the smallest user counts n.
+  std::vector<double> keep_probabilities_;
+
+  // Returns ProbabilityOfKeep(n), looking it up in keep_probabilities_ if
+  // possible.
+  double PrecomputedProbabilityOfKeep(int n) const {
+    return n >= 0 && n < keep_probabilities_.size() ? keep_probabilities_[n]
+                                                    : ProbabilityOfKeep(n);
+  }
+
   // ProbabilityOfKeep returns the probability with which a partition with n
   // users should be kept, Thm. 1 of https://arxiv.org/pdf/2006.03684.pdf
   double ProbabilityOfKeep(double n) const {
@@ -316,6 +392,10 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
       RETURN_IF_ERROR(EpsilonIsSetAndValid());
       RETURN_IF_ERROR(DeltaIsSetAndValid());
       RETURN_IF_ERROR(MaxPartitionsContributedIsSetAndValid());
+      // Keep decisions can only be precomputed for the default mechanism, as
+      // custom mechanisms may implement NoisedValueAboveThreshold()
+      // differently.
+      bool precompute_keep_decisions = laplace_builder_ == nullptr;
       if (laplace_builder_ == nullptr) {
         laplace_builder_ = absl::make_unique<LaplaceMechanism::Builder>();
       }
@@ -341,7 +421,7 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
       std::unique_ptr<PartitionSelectionStrategy> laplace =
           absl::WrapUnique(new LaplacePartitionSelection(
               epsilon, delta, max_partitions_contributed, adjusted_delta,
-              threshold, std::move(mechanism_)));
+              threshold, std::move(mechanism_), precompute_keep_decisions));
 
       return laplace;
     }
@@ -353,9 +433,28 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
   virtual ~LaplacePartitionSelection() = default;
 
   bool ShouldKeep(int num_users) override {
+    if (num_users >= 0 && num_users < drop_probabilities_.size()) {
+      // Same decision as LaplaceMechanism::NoisedValueAboveThreshold().
+      return UniformDouble() > drop_probabilities_[num_users];
+    }
     return mechanism_->NoisedValueAboveThreshold(num_users, threshold_);
   }
 
+  void SelectPartitions(absl::Span<const int> num_users,
+                        std::vector<int64_t>* kept_partitions) override {
+    internal::UniformDoubleBlock uniforms;
+    for (int64_t i = 0; i < num_users.size(); ++i) {
+      const int n = num_users[i];
+      bool keep =
+          n >= 0 && n < drop_probabilities_.size()
+              ? uniforms.Next() > drop_probabilities_[n]
+              : mechanism_->NoisedValueAboveThreshold(n, threshold_);
+      if (keep) {
+        kept_partitions->push_back(i);
+      }
+    }
+  }
+
   static base::StatusOr<double> CalculateDelta(
       double epsilon, double threshold, int64_t max_partitions_contributed) {
     RETURN_IF_ERROR(PartitionSelectionStrategy::EpsilonIsSetAndValid(epsilon));
@@ -408,13 +507,24 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
   LaplacePartitionSelection(double epsilon, double delta,
                             int64_t max_partitions_contributed,
                             double adjusted_delta, double threshold,
-                            std::unique_ptr<NumericalMechanism> laplace)
+                            std::unique_ptr<NumericalMechanism> laplace,
+                            bool precompute_keep_decisions = false)
       : PartitionSelectionStrategy(epsilon, delta, max_partitions_contributed,
                                    adjusted_delta),
         l1_sensitivity_(max_partitions_contributed),
         diversity_(CalculateDiversity(epsilon, l1_sensitivity_)),
         threshold_(threshold),
-        mechanism_(std::move(laplace)) {}
+        mechanism_(std::move(laplace)) {
+    if (precompute_keep_decisions) {
+      // Stops after the first count that is dropped with probability 0, since
+      // the drop probability only decreases from there.
+      for (int n = 0; n < kMaxPrecomputedUserCount; ++n) {
+        drop_probabilities_.push_back(
+            internal::LaplaceDistribution::cdf(diversity_, threshold_ - n));
+        if (drop_probabilities_.back() == 0) break;
+      }
+    }
+  }
 
   static double CalculateDiversity(double epsilon, int64_t l1_sensitivity) {
     return l1_sensitivity / epsilon;
@@ -425,6 +535,10 @@ class LaplacePartitionSelection : public PartitionSelectionStrategy {
   double diversity_;
   double threshold_;
   std::unique_ptr<NumericalMechanism> mechanism_;
+
+  // The probability that a partition with n users is dropped, for the smallest
+  // user counts n. Empty if the mechanism was provided by the caller.
+  std::vector<double> drop_probabilities_;
 };
 
 }  // namespace differential_privacy
@@ -0,0 +1,88 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <memory>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/partition-selection.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr int kNumPartitions = 1 << 16;
+
+// Returns user counts for kNumPartitions partitions, most of them small.
+std::vector<int> UserCounts() {
+  std::vector<int> num_users(kNumPartitions);
+  for (int i = 0; i < kNumPartitions; ++i) {
+    num_users[i] = (i * 7919) % 32;
+  }
+  return num_users;
+}
+
+// Decides on kNumPartitions partitions with either one ShouldKeep() call per
+// partition or a single SelectPartitions() call.
+template <bool kBatch>
+void SelectPartitions(benchmark::State& state,
+                      PartitionSelectionStrategy& strategy) {
+  std::vector<int> num_users = UserCounts();
+  std::vector<int64_t> kept;
+  kept.reserve(num_users.size());
+  for (auto _ : state) {
+    kept.clear();
+    if (kBatch) {
+      strategy.SelectPartitions(num_users, &kept);
+    } else {
+      for (int64_t i = 0; i < num_users.size(); ++i) {
+        if (strategy.ShouldKeep(num_users[i])) kept.push_back(i);
+      }
+    }
+    benchmark::DoNotOptimize(kept.data());
+  }
+  state.SetItemsProcessed(state.iterations() * num_users.size());
+}
+
+template <bool kBatch>
+void BM_PreaggPartitionSelection(benchmark::State& state) {
+  std::unique_ptr<PartitionSelectionStrategy> strategy =
+      PreaggPartitionSelection::Builder()
+          .SetEpsilon(1.0)
+          .SetDelta(1e-5)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  SelectPartitions<kBatch>(state, *strategy);
+}
+BENCHMARK_TEMPLATE(BM_PreaggPartitionSelection, false);
+BENCHMARK_TEMPLATE(BM_PreaggPartitionSelection, true);
+
+template <bool kBatch>
+void BM_LaplacePartitionSelection(benchmark::State& state) {
+  std::unique_ptr<PartitionSelectionStrategy> strategy =
+      LaplacePartitionSelection::Builder()
+          .SetEpsilon(1.0)
+          .SetDelta(1e-5)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  SelectPartitions<kBatch>(state, *strategy);
+}
+BENCHMARK_TEMPLATE(BM_LaplacePartitionSelection, false);
+BENCHMARK_TEMPLATE(BM_LaplacePartitionSelection, true);
+
+}  // namespace
+}  // namespace differential_privacy
@@ -16,6 +16,9 @@
 
 #include "algorithms/partition-selection.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "base/statusor.h"
@@ -293,6 +296,54 @@ TEST(PartitionSelectionTest,
   }
   EXPECT_THAT(num_kept / kNumSamples, DoubleNear(0.8, 0.001));
 }
+
+// 5000 users lie beyond the precomputed keep probabilities but below the first
+// crossover at 1 / (2 * delta) = 10000, so the probability is about n * delta.
+TEST(PartitionSelectionTest,
+     PreaggPartitionSelectionTinyEpsilonBeyondPrecomputedCounts) {
+  PreaggPartitionSelection::Builder test_builder;
+  std::unique_ptr<PartitionSelectionStrategy> build =
+      test_builder.SetEpsilon(1e-20)
+          .SetDelta(5e-5)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  double num_kept = 0.0;
+  for (int i = 0; i < kSmallNumSamples; i++) {
+    if (build->ShouldKeep(5000)) num_kept++;
+  }
+  EXPECT_THAT(num_kept / kSmallNumSamples, DoubleNear(0.25, 0.002));
+}
+
+TEST(PartitionSelectionTest, PreaggPartitionSelectionSelectPartitions) {
+  PreaggPartitionSelection::Builder test_builder;
+  std::unique_ptr<PartitionSelectionStrategy> build =
+      test_builder.SetEpsilon(0.5)
+          .SetDelta(0.02)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  // Partitions without users are never kept, partitions with 15 users always
+  // are and partitions with 8 users are kept with probability 0.868.
+  std::vector<int> num_users;
+  for (int i = 0; i < kSmallNumSamples; ++i) {
+    num_users.push_back(i % 3 == 0 ? 0 : (i % 3 == 1 ? 15 : 8));
+  }
+  std::vector<int64_t> kept;
+  build->SelectPartitions(num_users, &kept);
+
+  EXPECT_TRUE(std::is_sorted(kept.begin(), kept.end()));
+  std::vector<int> kept_per_count(3, 0);
+  for (int64_t index : kept) {
+    ++kept_per_count[index % 3];
+  }
+  const int partitions_per_count = kSmallNumSamples / 3;
+  EXPECT_EQ(kept_per_count[0], 0);
+  EXPECT_EQ(kept_per_count[1], partitions_per_count);
+  EXPECT_THAT(static_cast<double>(kept_per_count[2]) / partitions_per_count,
+              DoubleNear(0.86807080625, 0.003));
+}
+
 // LaplacePartitionSelection Tests
 // Due to the inheritance, SetLaplaceMechanism must be
 // called before SetDelta, SetEpsilon, etc.
@@ -428,6 +479,48 @@ TEST(PartitionSelectionTest, LaplacePartitionSelectionAtThreshold) {
   EXPECT_THAT(num_kept / kSmallNumSamples, DoubleNear(0.5, 0.0025));
 }
 
+// Without a custom mechanism, keep decisions come from precomputed drop
+// probabilities and must match the mechanism's behaviour above.
+TEST(PartitionSelectionTest,
+     LaplacePartitionSelectionAtThresholdDefaultMechanism) {
+  LaplacePartitionSelection::Builder test_builder;
+  std::unique_ptr<PartitionSelectionStrategy> build =
+      test_builder.SetEpsilon(0.5)
+          .SetDelta(0.06766764161)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  double num_kept = 0.0;
+  for (int i = 0; i < kSmallNumSamples; i++) {
+    if (build->ShouldKeep(5)) num_kept++;
+  }
+  EXPECT_THAT(num_kept / kSmallNumSamples, DoubleNear(0.5, 0.0025));
+}
+
+TEST(PartitionSelectionTest, LaplacePartitionSelectionSelectPartitions) {
+  for (bool custom_mechanism : {false, true}) {
+    LaplacePartitionSelection::Builder test_builder;
+    if (custom_mechanism) {
+      test_builder.SetLaplaceMechanism(
+          absl::make_unique<LaplaceMechanism::Builder>());
+    }
+    std::unique_ptr<PartitionSelectionStrategy> build =
+        test_builder.SetEpsilon(0.5)
+            .SetDelta(0.06766764161)
+            .SetMaxPartitionsContributed(1)
+            .Build()
+            .ValueOrDie();
+    // The threshold is approximately 5, so half of the partitions are kept.
+    std::vector<int> num_users(kSmallNumSamples, 5);
+    std::vector<int64_t> kept;
+    build->SelectPartitions(num_users, &kept);
+    EXPECT_TRUE(std::is_sorted(kept.begin(), kept.end()));
+    EXPECT_THAT(static_cast<double>(kept.size()) / kSmallNumSamples,
+                DoubleNear(0.5, 0.0025))
+        << custom_mechanism;
+  }
+}
+
 TEST(PartitionSelectionTest, LaplacePartitionSelectionThreshold) {
   LaplacePartitionSelection::Builder test_builder;
   std::unique_ptr<PartitionSelectionStrategy> build =
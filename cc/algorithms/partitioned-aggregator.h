@@ -0,0 +1,435 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/status.h"
+#include "base/statusor.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/partition-selection.h"
+#include "algorithms/util.h"
+#include "base/canonical_errors.h"
+#include "base/logging.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// Computes a differentially private count and sum of the entries of each of
+// many partitions at once, as an alternative to one Count and BoundedSum per
+// partition. Partitions are identified by int64 keys, e.g., fingerprints of
+// the partition names.
+//
+// Each partition is a row of a flat open addressing table: the table itself
+// only holds row indices, and the keys, counts and clamped sums of all rows are
+// kept in separate contiguous arrays. Adding an entry costs one probe of the
+// table, and PartialResult() noises the counts and sums of all partitions in
+// two batches.
+//
+// Entries must already be bounded per privacy unit: a privacy unit contributes
+// to at most MaxPartitionsContributed partitions and adds at most
+// MaxContributionsPerPartition entries to each of them, of which exactly one
+// has the new_privacy_unit flag set, e.g., by ContributionBounder. Unless
+// public partitions are set, the partitions to release are chosen by a
+// PartitionSelectionStrategy from their numbers of new_privacy_unit flags, and
+// the epsilon is split evenly between the selection, the counts and the sums.
+// Otherwise, only the public partitions are aggregated and released, even if
+// empty, and the epsilon is split evenly between the counts and the sums. The
+// delta is split evenly between the releases that spend it: the selection, and
+// the counts and sums if their mechanism builder UsesDelta().
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value>* = nullptr>
+class PartitionedAggregator {
+ public:
+  // Maximum number of partitions with entries, or of public partitions.
+  static constexpr int64_t kMaxPartitions =
+      std::numeric_limits<uint32_t>::max();
+
+  // The noisy count and sum of the entries of a partition.
+  struct PartitionResult {
+    int64_t partition;
+    int64_t count;
+    T sum;
+  };
+
+  class Builder {
+   public:
+    Builder& SetEpsilon(double epsilon) {
+      epsilon_ = epsilon;
+      return *this;
+    }
+
+    // Delta of the partition selection and of the noise, if its mechanism uses
+    // delta.
+    Builder& SetDelta(double delta) {
+      delta_ = delta;
+      return *this;
+    }
+
+    Builder& SetLower(T lower) {
+      lower_ = lower;
+      return *this;
+    }
+
+    Builder& SetUpper(T upper) {
+      upper_ = upper;
+      return *this;
+    }
+
+    Builder& SetMaxPartitionsContributed(int max_partitions) {
+      max_partitions_contributed_ = max_partitions;
+      return *this;
+    }
+
+    Builder& SetMaxContributionsPerPartition(int max_contributions) {
+      max_contributions_per_partition_ = max_contributions;
+      return *this;
+    }
+
+    // Mechanism builder of the count and sum noise.
+    Builder& SetLaplaceMechanism(
+        std::unique_ptr<NumericalMechanismBuilder> mechanism_builder) {
+      mechanism_builder_ = std::move(mechanism_builder);
+      return *this;
+    }
+
+    // Strategy to select the partitions to release. Its epsilon, delta and
+    // max partitions contributed are set by Build(). Defaults to
+    // PreaggPartitionSelection.
+    Builder& SetPartitionSelectionStrategy(
+        std::unique_ptr<PartitionSelectionStrategy::Builder>
+            strategy_builder) {
+      strategy_builder_ = std::move(strategy_builder);
+      return *this;
+    }
+
+    // Aggregates and releases exactly these partitions instead of selecting
+    // them. Entries of other partitions are dropped.
+    Builder& SetPublicPartitions(std::vector<int64_t> partitions) {
+      public_partitions_ = std::move(partitions);
+      return *this;
+    }
+
+    base::StatusOr<std::unique_ptr<PartitionedAggregator<T>>> Build() {
+      if (!epsilon_.has_value()) {
+        return base::InvalidArgumentError("Epsilon has to be set.");
+      }
+      if (!std::isfinite(epsilon_.value()) || epsilon_.value() <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Epsilon has to be positive and finite, but is ",
+            epsilon_.value()));
+      }
+      if (!lower_.has_value() || !upper_.has_value()) {
+        return base::InvalidArgumentError(
+            "Lower and upper bounds have to be set for a partitioned "
+            "aggregator.");
+      }
+      if (!std::isfinite(static_cast<double>(lower_.value())) ||
+          !std::isfinite(static_cast<double>(upper_.value()))) {
+        return base::InvalidArgumentError("Bounds have to be finite.");
+      }
+      if (lower_.value() > upper_.value()) {
+        return base::InvalidArgumentError(
+            "Lower bound cannot be greater than upper bound.");
+      }
+      if (max_partitions_contributed_ <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Max number of partitions a user can contribute to has to be"
+            " positive, but is ",
+            max_partitions_contributed_));
+      }
+      if (max_contributions_per_partition_ <= 0) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Max contributions per partition has to be positive, but is ",
+            max_contributions_per_partition_));
+      }
+      if (public_partitions_.has_value() &&
+          static_cast<int64_t>(public_partitions_->size()) > kMaxPartitions) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Number of public partitions can be at most ", kMaxPartitions,
+            ", but is ", public_partitions_->size()));
+      }
+
+      const bool select_partitions = !public_partitions_.has_value();
+      const double epsilon =
+          epsilon_.value() / (select_partitions ? 3.0 : 2.0);
+      const bool noise_uses_delta = mechanism_builder_->UsesDelta();
+      const int num_delta_releases =
+          (select_partitions ? 1 : 0) + (noise_uses_delta ? 2 : 0);
+      absl::optional<double> delta;
+      if (delta_.has_value() && num_delta_releases > 0) {
+        delta = delta_.value() / num_delta_releases;
+      }
+      std::unique_ptr<PartitionSelectionStrategy> strategy;
+      if (select_partitions) {
+        strategy_builder_->SetEpsilon(epsilon).SetMaxPartitionsContributed(
+            max_partitions_contributed_);
+        if (delta.has_value()) {
+          strategy_builder_->SetDelta(delta.value());
+        }
+        ASSIGN_OR_RETURN(strategy, strategy_builder_->Build());
+      }
+      if (!noise_uses_delta) {
+        delta.reset();
+      }
+      ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> count_mechanism,
+                       BuildMechanism(epsilon, delta, 1));
+      // The magnitude is computed in double, since the absolute value of the
+      // lowest integer overflows.
+      const double max_magnitude =
+          std::max(std::abs(static_cast<double>(lower_.value())),
+                   std::abs(static_cast<double>(upper_.value())));
+      ASSIGN_OR_RETURN(std::unique_ptr<NumericalMechanism> sum_mechanism,
+                       BuildMechanism(epsilon, delta, max_magnitude));
+
+      auto aggregator = absl::WrapUnique(new PartitionedAggregator<T>(
+          lower_.value(), upper_.value(), std::move(strategy),
+          std::move(count_mechanism), std::move(sum_mechanism)));
+      if (!select_partitions) {
+        aggregator->Reserve(public_partitions_->size());
+        for (int64_t partition : public_partitions_.value()) {
+          aggregator->FindRow(partition, /*insert=*/true);
+        }
+      }
+      return aggregator;
+    }
+
+   private:
+    // Builds a mechanism for values of which a privacy unit adds at most
+    // max_contributions_per_partition_ of magnitude at most max_value to each
+    // partition.
+    base::StatusOr<std::unique_ptr<NumericalMechanism>> BuildMechanism(
+        double epsilon, absl::optional<double> delta, double max_value) {
+      std::unique_ptr<NumericalMechanismBuilder> builder =
+          mechanism_builder_->Clone();
+      builder->SetEpsilon(epsilon)
+          .SetL0Sensitivity(max_partitions_contributed_)
+          .SetLInfSensitivity(max_contributions_per_partition_ * max_value);
+      if (delta.has_value()) {
+        builder->SetDelta(delta.value());
+      }
+      return builder->Build();
+    }
+
+    absl::optional<double> epsilon_;
+    absl::optional<double> delta_;
+    absl::optional<T> lower_;
+    absl::optional<T> upper_;
+    int max_partitions_contributed_ = 1;
+    int max_contributions_per_partition_ = 1;
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder_ =
+        absl::make_unique<LaplaceMechanism::Builder>();
+    std::unique_ptr<PartitionSelectionStrategy::Builder> strategy_builder_ =
+        absl::make_unique<PreaggPartitionSelection::Builder>();
+    absl::optional<std::vector<int64_t>> public_partitions_;
+  };
+
+  // Adds an entry to a partition, clamped to the bounds. new_privacy_unit has
+  // to be set on the first entry each privacy unit adds to the partition, and
+  // only on that one. Entries of partitions other than the public partitions,
+  // if set, are dropped. Crashes on the entry of a new partition once there
+  // are kMaxPartitions.
+  void AddEntry(int64_t partition, T entry, bool new_privacy_unit) {
+    const int64_t row = FindRow(partition, /*insert=*/strategy_ != nullptr);
+    if (row < 0) {
+      return;
+    }
+    num_units_[row] += new_privacy_unit;
+    ++counts_[row];
+    SafeAdd(sums_[row], Clamp<T>(lower_, upper_, entry), &sums_[row]);
+  }
+
+  // Makes room for num_partitions partitions without growing the table.
+  void Reserve(int64_t num_partitions) {
+    num_partitions = std::min(num_partitions, kMaxPartitions);
+    partitions_.reserve(num_partitions);
+    num_units_.reserve(num_partitions);
+    counts_.reserve(num_partitions);
+    sums_.reserve(num_partitions);
+    if (2 * num_partitions > static_cast<int64_t>(slots_.size())) {
+      int64_t num_slots = slots_.size();
+      while (2 * num_partitions > num_slots) {
+        num_slots *= 2;
+      }
+      Rehash(num_slots);
+    }
+  }
+
+  // Returns the selected partitions, or all public partitions, with their
+  // noisy counts and sums, in the order their first entries were added. Can
+  // only be called once, as it spends the whole privacy budget.
+  base::StatusOr<std::vector<PartitionResult>> PartialResult() {
+    if (released_) {
+      return base::InvalidArgumentError(
+          "The results of a partitioned aggregator can only be released "
+          "once.");
+    }
+    released_ = true;
+
+    std::vector<int64_t> rows;
+    if (strategy_ != nullptr) {
+      std::vector<int> num_units(partitions_.size());
+      for (int64_t row = 0; row < num_units.size(); ++row) {
+        num_units[row] = static_cast<int>(std::min<int64_t>(
+            num_units_[row], std::numeric_limits<int>::max()));
+      }
+      strategy_->SelectPartitions(num_units, &rows);
+    } else {
+      rows.resize(partitions_.size());
+      for (int64_t row = 0; row < rows.size(); ++row) {
+        rows[row] = row;
+      }
+    }
+
+    std::vector<double> noisy_counts(rows.size());
+    std::vector<double> noisy_sums(rows.size());
+    for (int64_t i = 0; i < rows.size(); ++i) {
+      noisy_counts[i] = counts_[rows[i]];
+      noisy_sums[i] = sums_[rows[i]];
+    }
+    count_mechanism_->AddNoiseInPlace(absl::MakeSpan(noisy_counts), 1.0);
+    sum_mechanism_->AddNoiseInPlace(absl::MakeSpan(noisy_sums), 1.0);
+
+    std::vector<PartitionResult> results(rows.size());
+    for (int64_t i = 0; i < rows.size(); ++i) {
+      results[i].partition = partitions_[rows[i]];
+      SafeCastFromDouble(std::round(noisy_counts[i]), results[i].count);
+      SafeCastFromDouble(std::is_integral<T>::value ? std::round(noisy_sums[i])
+                                                    : noisy_sums[i],
+                         results[i].sum);
+    }
+    return results;
+  }
+
+  // Number of partitions with entries, or of public partitions.
+  int64_t NumPartitions() const { return partitions_.size(); }
+
+  int64_t MemoryUsed() const {
+    return sizeof(PartitionedAggregator<T>) +
+           sizeof(uint32_t) * slots_.capacity() +
+           sizeof(int64_t) * partitions_.capacity() +
+           sizeof(int64_t) * num_units_.capacity() +
+           sizeof(int64_t) * counts_.capacity() + sizeof(T) * sums_.capacity();
+  }
+
+ private:
+  // Marks a slot of the table without a row.
+  static constexpr uint32_t kEmptySlot = 0;
+  static constexpr int64_t kInitialSlots = 16;
+
+  PartitionedAggregator(T lower, T upper,
+                        std::unique_ptr<PartitionSelectionStrategy> strategy,
+                        std::unique_ptr<NumericalMechanism> count_mechanism,
+                        std::unique_ptr<NumericalMechanism> sum_mechanism)
+      : lower_(lower),
+        upper_(upper),
+        strategy_(std::move(strategy)),
+        count_mechanism_(std::move(count_mechanism)),
+        sum_mechanism_(std::move(sum_mechanism)) {
+    Rehash(kInitialSlots);
+  }
+
+  // Returns the first slot to probe for partition, from the top bits of its
+  // Fibonacci hash.
+  uint64_t HomeSlot(int64_t partition) const {
+    return (static_cast<uint64_t>(partition) * 0x9E3779B97F4A7C15) >>
+           slot_shift_;
+  }
+
+  // Returns the row of partition, or -1 if it has none. If insert is set, a
+  // missing partition is given a new empty row instead.
+  int64_t FindRow(int64_t partition, bool insert) {
+    const uint64_t mask = slots_.size() - 1;
+    uint64_t slot = HomeSlot(partition);
+    for (; slots_[slot] != kEmptySlot; slot = (slot + 1) & mask) {
+      const int64_t row = slots_[slot] - 1;
+      if (partitions_[row] == partition) {
+        return row;
+      }
+    }
+    if (!insert) {
+      return -1;
+    }
+    // Rows are stored plus one in the 32 bit slots.
+    CHECK(static_cast<int64_t>(partitions_.size()) < kMaxPartitions)
+        << "A partitioned aggregator holds at most " << kMaxPartitions
+        << " partitions.";
+    const int64_t row = partitions_.size();
+    partitions_.push_back(partition);
+    num_units_.push_back(0);
+    counts_.push_back(0);
+    sums_.push_back(0);
+    slots_[slot] = row + 1;
+    // Linear probing slows down quickly beyond half full.
+    if (2 * partitions_.size() > slots_.size()) {
+      Rehash(2 * slots_.size());
+    }
+    return row;
+  }
+
+  // Rebuilds the table with num_slots slots, a power of two.
+  void Rehash(int64_t num_slots) {
+    slots_.assign(num_slots, kEmptySlot);
+    slot_shift_ = 64;
+    for (int64_t n = num_slots; n > 1; n /= 2) {
+      --slot_shift_;
+    }
+    const uint64_t mask = num_slots - 1;
+    for (int64_t row = 0; row < partitions_.size(); ++row) {
+      uint64_t slot = HomeSlot(partitions_[row]);
+      while (slots_[slot] != kEmptySlot) {
+        slot = (slot + 1) & mask;
+      }
+      slots_[slot] = row + 1;
+    }
+  }
+
+  const T lower_;
+  const T upper_;
+  // Null if public partitions are set.
+  std::unique_ptr<PartitionSelectionStrategy> strategy_;
+  std::unique_ptr<NumericalMechanism> count_mechanism_;
+  std::unique_ptr<NumericalMechanism> sum_mechanism_;
+  bool released_ = false;
+
+  // Open addressing table of one plus the row of each partition, probed
+  // linearly and at most half full. Holds up to kMaxPartitions rows.
+  std::vector<uint32_t> slots_;
+  int slot_shift_;
+
+  // Columns of the rows.
+  std::vector<int64_t> partitions_;
+  // Number of distinct privacy units.
+  std::vector<int64_t> num_units_;
+  std::vector<int64_t> counts_;
+  std::vector<T> sums_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_PARTITIONED_AGGREGATOR_H_
@@ -0,0 +1,109 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "algorithms/bounded-sum.h"
+#include "algorithms/count.h"
+#include "algorithms/partition-selection.h"
+#include "algorithms/partitioned-aggregator.h"
+
+namespace differential_privacy {
+namespace {
+
+constexpr int kNumEntries = 1 << 20;
+
+// Returns the partitions of kNumEntries entries, spread over num_partitions
+// partitions with sparse keys.
+std::vector<int64_t> EntryPartitions(int64_t num_partitions) {
+  std::vector<int64_t> partitions(kNumEntries);
+  for (int64_t i = 0; i < kNumEntries; ++i) {
+    partitions[i] = (i * 7919 % num_partitions) * 0x5DEECE66D;
+  }
+  return partitions;
+}
+
+// Aggregates kNumEntries entries into state.range(0) partitions and releases
+// the selected partitions.
+void BM_PartitionedAggregator(benchmark::State& state) {
+  std::vector<int64_t> partitions = EntryPartitions(state.range(0));
+  PartitionedAggregator<int64_t>::Builder builder;
+  builder.SetEpsilon(1).SetDelta(1e-5).SetLower(0).SetUpper(100);
+  for (auto _ : state) {
+    std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+        builder.Build().ValueOrDie();
+    for (int64_t i = 0; i < kNumEntries; ++i) {
+      aggregator->AddEntry(partitions[i], i % 128, true);
+    }
+    auto results = aggregator->PartialResult();
+    benchmark::DoNotOptimize(results);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEntries);
+}
+BENCHMARK(BM_PartitionedAggregator)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+// Same as above, with a Count and BoundedSum per partition in a hash map, and
+// partitions selected one at a time.
+void BM_AlgorithmsPerPartition(benchmark::State& state) {
+  std::vector<int64_t> partitions = EntryPartitions(state.range(0));
+  Count<int64_t>::Builder count_builder;
+  count_builder.SetEpsilon(1.0 / 3);
+  BoundedSum<int64_t>::Builder sum_builder;
+  sum_builder.SetEpsilon(1.0 / 3).SetLower(0).SetUpper(100);
+  std::unique_ptr<PartitionSelectionStrategy> strategy =
+      PreaggPartitionSelection::Builder()
+          .SetEpsilon(1.0 / 3)
+          .SetDelta(1e-5)
+          .SetMaxPartitionsContributed(1)
+          .Build()
+          .ValueOrDie();
+  struct Partition {
+    int num_entries = 0;
+    std::unique_ptr<Count<int64_t>> count;
+    std::unique_ptr<BoundedSum<int64_t>> sum;
+  };
+  for (auto _ : state) {
+    std::unordered_map<int64_t, Partition> algorithms;
+    for (int64_t i = 0; i < kNumEntries; ++i) {
+      Partition& partition = algorithms[partitions[i]];
+      if (partition.num_entries++ == 0) {
+        partition.count = count_builder.Build().ValueOrDie();
+        partition.sum = sum_builder.Build().ValueOrDie();
+      }
+      partition.count->AddEntry(i);
+      partition.sum->AddEntry(i % 128);
+    }
+    std::vector<std::pair<Output, Output>> results;
+    for (auto& partition : algorithms) {
+      if (strategy->ShouldKeep(partition.second.num_entries)) {
+        results.emplace_back(
+            partition.second.count->PartialResult().ValueOrDie(),
+            partition.second.sum->PartialResult().ValueOrDie());
+      }
+    }
+    benchmark::DoNotOptimize(results);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumEntries);
+}
+BENCHMARK(BM_AlgorithmsPerPartition)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+}  // namespace
+}  // namespace differential_privacy
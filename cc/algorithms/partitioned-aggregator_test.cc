@@ -0,0 +1,229 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/partitioned-aggregator.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::DoubleEq;
+using ::testing::ElementsAre;
+using ::testing::FieldsAre;
+using ::testing::HasSubstr;
+using ::testing::SizeIs;
+using ::differential_privacy::base::testing::StatusIs;
+
+template <typename T>
+typename PartitionedAggregator<T>::Builder ZeroNoiseBuilder() {
+  typename PartitionedAggregator<T>::Builder builder;
+  builder.SetEpsilon(1).SetLower(0).SetUpper(10).SetLaplaceMechanism(
+      absl::make_unique<ZeroNoiseMechanism::Builder>());
+  return builder;
+}
+
+TEST(PartitionedAggregatorTest, PublicPartitions) {
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      ZeroNoiseBuilder<int64_t>()
+          .SetPublicPartitions({7, -3, 12})
+          .Build()
+          .ValueOrDie();
+  aggregator->AddEntry(-3, 4, true);
+  aggregator->AddEntry(7, 20, true);  // Clamped to 10.
+  aggregator->AddEntry(-3, -1, true);  // Clamped to 0.
+  aggregator->AddEntry(5, 1, true);  // Not a public partition.
+  EXPECT_EQ(aggregator->NumPartitions(), 3);
+
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  EXPECT_THAT(*results, ElementsAre(FieldsAre(7, 1, 10), FieldsAre(-3, 2, 4),
+                                    FieldsAre(12, 0, 0)));
+}
+
+TEST(PartitionedAggregatorTest, DoubleSums) {
+  std::unique_ptr<PartitionedAggregator<double>> aggregator =
+      ZeroNoiseBuilder<double>()
+          .SetPublicPartitions({1})
+          .Build()
+          .ValueOrDie();
+  aggregator->AddEntry(1, 2.25, true);
+  aggregator->AddEntry(1, 0.5, false);
+  base::StatusOr<std::vector<PartitionedAggregator<double>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  EXPECT_THAT(*results, ElementsAre(FieldsAre(1, 2, DoubleEq(2.75))));
+}
+
+TEST(PartitionedAggregatorTest, LowestBound) {
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      ZeroNoiseBuilder<int64_t>()
+          .SetLower(std::numeric_limits<int64_t>::lowest())
+          .SetPublicPartitions({1})
+          .Build()
+          .ValueOrDie();
+  aggregator->AddEntry(1, -5, true);
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  EXPECT_THAT(*results, ElementsAre(FieldsAre(1, 1, -5)));
+}
+
+TEST(PartitionedAggregatorTest, SelectsPartitionsWithManyPrivacyUnits) {
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      ZeroNoiseBuilder<int64_t>()
+          .SetEpsilon(30)
+          .SetDelta(1e-10)
+          .SetMaxContributionsPerPartition(2)
+          .Build()
+          .ValueOrDie();
+  // Partitions 0 to 9999 have 100 entries of 50 privacy units each, and
+  // partition 10000 has a single entry, which has to be dropped.
+  for (int i = 0; i < 100; ++i) {
+    for (int64_t partition = 0; partition < 10000; ++partition) {
+      aggregator->AddEntry(partition * 1000003, partition % 7, i % 2 == 0);
+    }
+  }
+  aggregator->AddEntry(-1, 1, true);
+  EXPECT_EQ(aggregator->NumPartitions(), 10001);
+
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  ASSERT_EQ(results->size(), 10000);
+  for (int64_t partition = 0; partition < 10000; ++partition) {
+    EXPECT_THAT((*results)[partition],
+                FieldsAre(partition * 1000003, 100, 100 * (partition % 7)));
+  }
+}
+
+TEST(PartitionedAggregatorTest, SelectsPartitionsByDistinctPrivacyUnits) {
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      ZeroNoiseBuilder<int64_t>()
+          .SetEpsilon(30)
+          .SetDelta(1e-10)
+          .SetMaxContributionsPerPartition(100)
+          .Build()
+          .ValueOrDie();
+  // Partition 1 has an entry of each of 100 privacy units, and partition 2 has
+  // 100 entries of a single privacy unit, so only partition 1 is kept.
+  for (int i = 0; i < 100; ++i) {
+    aggregator->AddEntry(1, 1, true);
+    aggregator->AddEntry(2, 1, i == 0);
+  }
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  EXPECT_THAT(*results, ElementsAre(FieldsAre(1, 100, 100)));
+}
+
+TEST(PartitionedAggregatorTest, GaussianNoise) {
+  PartitionedAggregator<int64_t>::Builder builder;
+  builder.SetEpsilon(1).SetLower(0).SetUpper(10).SetPublicPartitions({1});
+  builder.SetLaplaceMechanism(absl::make_unique<GaussianMechanism::Builder>());
+  EXPECT_THAT(builder.Build(), StatusIs(base::StatusCode::kInvalidArgument,
+                                        HasSubstr("Delta")));
+
+  // The Gaussian mechanisms get shares of the delta.
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      builder.SetDelta(1e-5).Build().ValueOrDie();
+  aggregator->AddEntry(1, 3, true);
+  base::StatusOr<std::vector<PartitionedAggregator<int64_t>::PartitionResult>>
+      results = aggregator->PartialResult();
+  ASSERT_OK(results);
+  ASSERT_THAT(*results, SizeIs(1));
+  EXPECT_EQ((*results)[0].partition, 1);
+}
+
+// Records the delta of the strategies it builds.
+class DeltaRecordingSelection : public PreaggPartitionSelection::Builder {
+ public:
+  explicit DeltaRecordingSelection(double* delta) : delta_(delta) {}
+
+  base::StatusOr<std::unique_ptr<PartitionSelectionStrategy>> Build()
+      override {
+    *delta_ = GetDelta().value_or(0);
+    return PreaggPartitionSelection::Builder::Build();
+  }
+
+ private:
+  double* delta_;
+};
+
+TEST(PartitionedAggregatorTest, SplitsDeltaBetweenReleasesThatUseIt) {
+  // Laplace noise does not use delta, so the selection gets all of it.
+  double selection_delta;
+  ASSERT_OK(ZeroNoiseBuilder<int64_t>()
+                .SetDelta(1e-6)
+                .SetPartitionSelectionStrategy(
+                    absl::make_unique<DeltaRecordingSelection>(
+                        &selection_delta))
+                .Build());
+  EXPECT_DOUBLE_EQ(selection_delta, 1e-6);
+
+  // Gaussian noise of the counts and sums does.
+  ASSERT_OK(ZeroNoiseBuilder<int64_t>()
+                .SetDelta(1e-6)
+                .SetLaplaceMechanism(
+                    absl::make_unique<GaussianMechanism::Builder>())
+                .SetPartitionSelectionStrategy(
+                    absl::make_unique<DeltaRecordingSelection>(
+                        &selection_delta))
+                .Build());
+  EXPECT_DOUBLE_EQ(selection_delta, 1e-6 / 3);
+}
+
+TEST(PartitionedAggregatorTest, ReleasesOnce) {
+  std::unique_ptr<PartitionedAggregator<int64_t>> aggregator =
+      ZeroNoiseBuilder<int64_t>().SetPublicPartitions({}).Build().ValueOrDie();
+  EXPECT_OK(aggregator->PartialResult());
+  EXPECT_THAT(aggregator->PartialResult(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("only be released once")));
+}
+
+TEST(PartitionedAggregatorTest, BuilderErrors) {
+  EXPECT_THAT(PartitionedAggregator<int64_t>::Builder().Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Epsilon has to be set")));
+  EXPECT_THAT(PartitionedAggregator<int64_t>::Builder().SetEpsilon(1).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("bounds have to be set")));
+  EXPECT_THAT(
+      ZeroNoiseBuilder<int64_t>().SetLower(11).Build(),
+      StatusIs(base::StatusCode::kInvalidArgument, HasSubstr("Lower bound")));
+  EXPECT_THAT(
+      ZeroNoiseBuilder<int64_t>().SetMaxPartitionsContributed(0).Build(),
+      StatusIs(base::StatusCode::kInvalidArgument,
+               HasSubstr("has to be positive")));
+  // Selecting partitions needs a delta.
+  EXPECT_THAT(
+      ZeroNoiseBuilder<int64_t>().Build(),
+      StatusIs(base::StatusCode::kInvalidArgument, HasSubstr("Delta")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
@@ -0,0 +1,406 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
+#define DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "google/protobuf/any.pb.h"
+#include "base/status.h"
+#include "base/statusor.h"
+#include "absl/container/btree_map.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "algorithms/algorithm.h"
+#include "algorithms/numerical-mechanisms.h"
+#include "algorithms/util.h"
+#include "proto/util.h"
+#include "proto/summary.pb.h"
+#include "base/canonical_errors.h"
+#include "base/status_macros.h"
+
+namespace differential_privacy {
+
+// The default number of levels of a QuantileTree below its root.
+const int kDefaultQuantileTreeHeight = 4;
+
+// The default number of children of each inner node of a QuantileTree.
+const int kDefaultQuantileTreeBranchingFactor = 16;
+
+// The maximum number of leaves of a QuantileTree, which bounds its memory.
+const int64_t kMaxQuantileTreeLeaves = int64_t{1} << 20;
+
+// Computes quantiles of the inputs from a hierarchical histogram. The range
+// [lower, upper] is split into branching_factor equally wide subranges, each of
+// which is split the same way again, down to tree_height levels. An input adds
+// one to the count of the subrange containing it on every level. Only the
+// counts of nodes that hold inputs are stored, so memory grows with the number
+// of distinct nodes the inputs fall into, never beyond the size of the tree,
+// and summaries merge by adding the counts.
+//
+// To compute the result, the counts are noised and each quantile is found by
+// descending from the root into the child whose noisy counts cover the rank of
+// the quantile, then interpolating within the leaf. Every node is noised at
+// most once, and only when a descent reaches its parent, so all quantiles are
+// read from the same noisy counts and do not have to share the privacy budget.
+// Since an input contributes to one node per level, the noise is scaled to an
+// L0 sensitivity of tree_height per partition contributed.
+template <typename T>
+class QuantileTree : public Algorithm<T> {
+ public:
+  class Builder;
+
+  void AddEntry(const T& t) override {
+    if (std::isnan(static_cast<double>(t))) {
+      return;
+    }
+    int64_t node = LeafOf(t);
+    for (int level = tree_height_; level > 0; --level) {
+      ++counts_[level_offsets_[level] + node];
+      node /= branching_factor_;
+    }
+  }
+
+  Summary Serialize() override {
+    QuantileTreeSummary qt_summary;
+    qt_summary.set_tree_height(tree_height_);
+    qt_summary.set_branching_factor(branching_factor_);
+    if (!counts_.empty()) {
+      SetSparsePackedValues<int64_t>(level_offsets_.back(), counts_,
+                                     qt_summary.mutable_count());
+    }
+    Summary summary;
+    summary.mutable_data()->PackFrom(qt_summary);
+    return summary;
+  }
+
+  base::Status Merge(const Summary& summary) override {
+    if (!summary.has_data()) {
+      return base::InternalError(
+          "Cannot merge summary with no quantile tree data.");
+    }
+    QuantileTreeSummary qt_summary;
+    if (!summary.data().UnpackTo(&qt_summary)) {
+      return base::InternalError(
+          "Quantile tree summary unable to be unpacked.");
+    }
+    if (qt_summary.tree_height() != tree_height_ ||
+        qt_summary.branching_factor() != branching_factor_) {
+      return base::InternalError(
+          "Merged quantile trees must have the same tree height and branching "
+          "factor.");
+    }
+    int64_t num_counts = PackedValuesSize<int64_t>(qt_summary.count());
+    if (num_counts == 0) {
+      return base::OkStatus();
+    }
+    if (num_counts != level_offsets_.back()) {
+      return base::InternalError(absl::StrCat(
+          "Quantile tree summary has ", num_counts, " counts but the tree has ",
+          level_offsets_.back(), " nodes."));
+    }
+    ForEachNonzeroPackedValue<int64_t>(
+        qt_summary.count(),
+        [this](int64_t node, int64_t count) { counts_[node] += count; });
+    return base::OkStatus();
+  }
+
+  int64_t MemoryUsed() override {
+    // The stored counts are estimated by their entries, without the overhead
+    // of the map nodes.
+    int64_t memory =
+        sizeof(QuantileTree<T>) + sizeof(int64_t) * level_offsets_.capacity() +
+        sizeof(std::pair<const int64_t, int64_t>) * counts_.size();
+    for (const auto& entry : noised_children_) {
+      memory += sizeof(entry) + sizeof(double) * entry.second.capacity();
+    }
+    if (mechanism_) {
+      memory += mechanism_->MemoryUsed();
+    }
+    return memory;
+  }
+
+  const std::vector<double>& GetQuantiles() const { return quantiles_; }
+
+ protected:
+  base::StatusOr<Output> GenerateResult(double privacy_budget,
+                                        double noise_interval_level) override {
+    DCHECK_GT(privacy_budget, 0.0)
+        << "Privacy budget should be greater than zero.";
+    if (privacy_budget == 0.0) return Output();
+    Output output;
+    for (double quantile : quantiles_) {
+      double result = NoisyQuantile(quantile, privacy_budget);
+      // Round the result for integral types, and ensure it is within the
+      // bounds.
+      if (std::is_integral<T>::value) {
+        result = std::round(result);
+      }
+      AddToOutput<T>(&output, Clamp<T>(lower_, upper_, result));
+    }
+    // The noisy counts must not be reused for a later result.
+    noised_children_.clear();
+    return output;
+  }
+
+  void ResetState() override { counts_.clear(); }
+
+ private:
+  QuantileTree(double epsilon, T lower, T upper, int tree_height,
+               int branching_factor, std::vector<double> quantiles,
+               std::unique_ptr<NumericalMechanism> mechanism)
+      : Algorithm<T>(epsilon),
+        lower_(lower),
+        upper_(upper),
+        tree_height_(tree_height),
+        branching_factor_(branching_factor),
+        quantiles_(std::move(quantiles)),
+        mechanism_(std::move(mechanism)) {
+    // level_offsets_[l] is the index of the first node on level l,
+    // where level 1 holds the children of the root. The last entry is the
+    // number of nodes.
+    level_offsets_.assign(tree_height_ + 2, 0);
+    int64_t level_size = 1;
+    for (int level = 1; level <= tree_height_; ++level) {
+      level_size *= branching_factor_;
+      level_offsets_[level + 1] = level_offsets_[level] + level_size;
+    }
+    num_leaves_ = level_size;
+  }
+
+  int64_t LeafOf(T t) const {
+    if (upper_ == lower_) {
+      return 0;
+    }
+    double position = (static_cast<double>(Clamp<T>(lower_, upper_, t)) -
+                       static_cast<double>(lower_)) /
+                      (static_cast<double>(upper_) - lower_);
+    return std::min(static_cast<int64_t>(position * num_leaves_),
+                    num_leaves_ - 1);
+  }
+
+  // Returns the noisy count of the children of the given node on level, which
+  // is 0 for the root. The counts are noised on first access.
+  absl::Span<const double> NoisyChildCounts(int level, int64_t node,
+                                            double privacy_budget) {
+    int64_t first_child = level_offsets_[level + 1] + node * branching_factor_;
+    std::vector<double>& children = noised_children_[first_child];
+    if (children.empty()) {
+      children.assign(branching_factor_, 0);
+      for (auto it = counts_.lower_bound(first_child);
+           it != counts_.end() && it->first < first_child + branching_factor_;
+           ++it) {
+        children[it->first - first_child] = it->second;
+      }
+      mechanism_->AddNoiseInPlace(absl::MakeSpan(children), privacy_budget);
+      // Negative noisy counts carry no information about the location of
+      // the quantile.
+      for (double& count : children) {
+        count = std::max(0.0, count);
+      }
+    }
+    return children;
+  }
+
+  double NoisyQuantile(double quantile, double privacy_budget) {
+    int64_t node = 0;
+    // The fraction of the inputs in node that are below the quantile.
+    double rank = quantile;
+    for (int level = 0; level < tree_height_; ++level) {
+      absl::Span<const double> children =
+          NoisyChildCounts(level, node, privacy_budget);
+      double total = 0;
+      for (double count : children) {
+        total += count;
+      }
+      // Without any signal, the quantile is assumed to be uniformly
+      // distributed within the node.
+      if (total <= 0) {
+        return NodeLower(level, node) + rank * NodeWidth(level);
+      }
+      double target = rank * total;
+      double below = 0;
+      int child = 0;
+      for (; child + 1 < branching_factor_; ++child) {
+        if (children[child] > 0 && below + children[child] >= target) {
+          break;
+        }
+        below += children[child];
+      }
+      // The last child may have no inputs if rounding pushed target past the
+      // positive counts. Back off to the last child with inputs.
+      while (children[child] <= 0) {
+        --child;
+        below -= children[child];
+      }
+      rank = Clamp<double>(0, 1, (target - below) / children[child]);
+      node = node * branching_factor_ + child;
+    }
+    return NodeLower(tree_height_, node) + rank * NodeWidth(tree_height_);
+  }
+
+  double NodeWidth(int level) const {
+    return (static_cast<double>(upper_) - lower_) /
+           std::pow(branching_factor_, level);
+  }
+
+  double NodeLower(int level, int64_t node) const {
+    return static_cast<double>(lower_) + node * NodeWidth(level);
+  }
+
+  const T lower_;
+  const T upper_;
+  const int tree_height_;
+  const int branching_factor_;
+  const std::vector<double> quantiles_;
+  std::unique_ptr<NumericalMechanism> mechanism_;
+
+  std::vector<int64_t> level_offsets_;
+  int64_t num_leaves_;
+  // The nonzero counts, keyed by the index of their node.
+  absl::btree_map<int64_t, int64_t> counts_;
+  // Noisy counts of the children of the nodes the current result has
+  // descended from, keyed by the index of the first child.
+  absl::flat_hash_map<int64_t, std::vector<double>> noised_children_;
+};
+
+template <typename T>
+class QuantileTree<T>::Builder
+    : public AlgorithmBuilder<T, QuantileTree<T>, QuantileTree<T>::Builder> {
+  using AlgorithmBuilder =
+      differential_privacy::AlgorithmBuilder<T, QuantileTree<T>,
+                                             QuantileTree<T>::Builder>;
+
+ public:
+  Builder& SetLower(T lower) {
+    lower_ = lower;
+    return *this;
+  }
+
+  Builder& SetUpper(T upper) {
+    upper_ = upper;
+    return *this;
+  }
+
+  Builder& SetTreeHeight(int tree_height) {
+    tree_height_ = tree_height;
+    return *this;
+  }
+
+  Builder& SetBranchingFactor(int branching_factor) {
+    branching_factor_ = branching_factor;
+    return *this;
+  }
+
+  // The quantiles, each between 0 and 1, returned by the result in this
+  // order.
+  Builder& SetQuantiles(std::vector<double> quantiles) {
+    quantiles_ = std::move(quantiles);
+    return *this;
+  }
+
+ private:
+  base::StatusOr<std::unique_ptr<QuantileTree<T>>> BuildAlgorithm() override {
+    if (!lower_.has_value() || !upper_.has_value()) {
+      return base::InvalidArgumentError(
+          "Lower and upper bounds have to be set for a quantile tree.");
+    }
+    if (std::is_floating_point<T>::value) {
+      if (!std::isfinite(static_cast<double>(lower_.value()))) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Lower bound has to be finite but is ", lower_.value()));
+      }
+      if (!std::isfinite(static_cast<double>(upper_.value()))) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Upper bound has to be finite but is ", upper_.value()));
+      }
+    }
+    if (lower_.value() > upper_.value()) {
+      return base::InvalidArgumentError(
+          "Lower bound cannot be greater than upper bound.");
+    }
+    // Inputs are mapped to leaves by their position in the range, so its width
+    // has to be finite as well.
+    if (!std::isfinite(static_cast<double>(upper_.value()) -
+                       static_cast<double>(lower_.value()))) {
+      return base::InvalidArgumentError(
+          "The range between the lower and the upper bound has to be finite.");
+    }
+    if (tree_height_ < 1) {
+      return base::InvalidArgumentError(absl::StrCat(
+          "Tree height has to be at least 1 but is ", tree_height_));
+    }
+    if (branching_factor_ < 2) {
+      return base::InvalidArgumentError(absl::StrCat(
+          "Branching factor has to be at least 2 but is ", branching_factor_));
+    }
+    int64_t num_leaves = 1;
+    for (int level = 0; level < tree_height_; ++level) {
+      num_leaves *= branching_factor_;
+      if (num_leaves > kMaxQuantileTreeLeaves) {
+        return base::InvalidArgumentError(absl::StrCat(
+            "Quantile tree cannot have more than ", kMaxQuantileTreeLeaves,
+            " leaves."));
+      }
+    }
+    if (quantiles_.empty()) {
+      return base::InvalidArgumentError("At least one quantile has to be set.");
+    }
+    for (double quantile : quantiles_) {
+      if (quantile < 0 || quantile > 1) {
+        return base::InvalidArgumentError(
+            "Quantiles must be between 0 and 1.");
+      }
+    }
+
+    // Each input is counted once on every level of the tree.
+    std::unique_ptr<NumericalMechanism> mechanism;
+    std::unique_ptr<NumericalMechanismBuilder> mechanism_builder =
+        AlgorithmBuilder::GetMechanismBuilderClone();
+    mechanism_builder->SetEpsilon(AlgorithmBuilder::GetEpsilon().value());
+    if (AlgorithmBuilder::GetDelta().has_value()) {
+      mechanism_builder->SetDelta(AlgorithmBuilder::GetDelta().value());
+    }
+    ASSIGN_OR_RETURN(
+        mechanism,
+        mechanism_builder
+            ->SetL0Sensitivity(
+                tree_height_ *
+                AlgorithmBuilder::GetMaxPartitionsContributed().value_or(1))
+            .SetLInfSensitivity(
+                AlgorithmBuilder::GetMaxContributionsPerPartition().value_or(1))
+            .Build());
+
+    return absl::WrapUnique(new QuantileTree<T>(
+        AlgorithmBuilder::GetEpsilon().value(), lower_.value(), upper_.value(),
+        tree_height_, branching_factor_, quantiles_, std::move(mechanism)));
+  }
+
+  absl::optional<T> lower_;
+  absl::optional<T> upper_;
+  int tree_height_ = kDefaultQuantileTreeHeight;
+  int branching_factor_ = kDefaultQuantileTreeBranchingFactor;
+  std::vector<double> quantiles_;
+};
+
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_ALGORITHMS_QUANTILE_TREE_H_
@@ -0,0 +1,235 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "algorithms/quantile-tree.h"
+
+#include <limits>
+
+#include "base/testing/status_matchers.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "algorithms/numerical-mechanisms-testing.h"
+#include "algorithms/util.h"
+
+namespace differential_privacy {
+namespace {
+
+using ::differential_privacy::test_utils::ZeroNoiseMechanism;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::differential_privacy::base::testing::StatusIs;
+
+static constexpr int64_t kDataSize = 10000;
+
+template <typename T>
+std::unique_ptr<QuantileTree<T>> ZeroNoiseTree(T lower, T upper,
+                                               std::vector<double> quantiles) {
+  base::StatusOr<std::unique_ptr<QuantileTree<T>>> tree =
+      typename QuantileTree<T>::Builder()
+          .SetEpsilon(1)
+          .SetLower(lower)
+          .SetUpper(upper)
+          .SetQuantiles(std::move(quantiles))
+          .SetLaplaceMechanism(absl::make_unique<ZeroNoiseMechanism::Builder>())
+          .Build();
+  CHECK(tree.ok()) << tree.status();
+  return std::move(tree).ValueOrDie();
+}
+
+TEST(QuantileTreeTest, Quantiles) {
+  std::unique_ptr<QuantileTree<int64_t>> tree =
+      ZeroNoiseTree<int64_t>(0, 2048, {.1, .45, .9});
+  EXPECT_THAT(tree->GetQuantiles(), ElementsAre(.1, .45, .9));
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    tree->AddEntry(std::round(static_cast<double>(200) * i / kDataSize));
+  }
+  base::StatusOr<Output> result = tree->PartialResult(1.0);
+  ASSERT_OK(result);
+  ASSERT_EQ(result->elements_size(), 3);
+  EXPECT_NEAR(result->elements(0).value().int_value(), 20, 1);
+  EXPECT_NEAR(result->elements(1).value().int_value(), 90, 1);
+  EXPECT_NEAR(result->elements(2).value().int_value(), 180, 1);
+}
+
+TEST(QuantileTreeTest, ExtremeQuantilesStayInBounds) {
+  std::unique_ptr<QuantileTree<double>> tree =
+      ZeroNoiseTree<double>(-10, 10, {0, 1});
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    tree->AddEntry(i % 2 == 0 ? -100 : 100);
+  }
+  base::StatusOr<Output> result = tree->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(result->elements(0).value().float_value(), -10);
+  EXPECT_EQ(result->elements(1).value().float_value(), 10);
+}
+
+TEST(QuantileTreeTest, MedianWithNoise) {
+  base::StatusOr<std::unique_ptr<QuantileTree<double>>> tree =
+      QuantileTree<double>::Builder()
+          .SetEpsilon(1)
+          .SetLower(0)
+          .SetUpper(1000)
+          .SetQuantiles({.5})
+          .Build();
+  ASSERT_OK(tree);
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    (*tree)->AddEntry(i % 1000);
+  }
+  base::StatusOr<Output> result = (*tree)->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_NEAR(GetValue<double>(*result), 500, 50);
+}
+
+TEST(QuantileTreeTest, MemoryGrowsWithNodesHoldingInputs) {
+  std::unique_ptr<QuantileTree<int64_t>> tree =
+      ZeroNoiseTree<int64_t>(0, 1000, {.5});
+  int64_t empty_memory = tree->MemoryUsed();
+  // An input is counted in one node per level.
+  tree->AddEntry(1);
+  int64_t memory = tree->MemoryUsed();
+  EXPECT_LE(memory - empty_memory,
+            kDefaultQuantileTreeHeight * 2 * sizeof(int64_t));
+  // Further inputs in the same leaf do not store more counts.
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    tree->AddEntry(1);
+  }
+  EXPECT_EQ(tree->MemoryUsed(), memory);
+}
+
+TEST(QuantileTreeTest, SummaryElidesEmptyNodes) {
+  std::unique_ptr<QuantileTree<int64_t>> tree =
+      ZeroNoiseTree<int64_t>(0, 1000, {.5});
+  tree->AddEntry(1);
+  tree->AddEntry(999);
+  QuantileTreeSummary qt_summary;
+  ASSERT_TRUE(tree->Serialize().data().UnpackTo(&qt_summary));
+  EXPECT_EQ(PackedValuesSize<int64_t>(qt_summary.count()),
+            16 + 256 + 4096 + 65536);
+  EXPECT_EQ(qt_summary.count().int_value_size(),
+            2 * kDefaultQuantileTreeHeight);
+}
+
+TEST(QuantileTreeTest, SerializeMerge) {
+  std::unique_ptr<QuantileTree<int64_t>> tree1 =
+      ZeroNoiseTree<int64_t>(0, 2048, {.25, .75});
+  std::unique_ptr<QuantileTree<int64_t>> tree2 =
+      ZeroNoiseTree<int64_t>(0, 2048, {.25, .75});
+  std::unique_ptr<QuantileTree<int64_t>> all =
+      ZeroNoiseTree<int64_t>(0, 2048, {.25, .75});
+  for (int64_t i = 0; i < kDataSize; ++i) {
+    int64_t value = i % 1000;
+    (i % 2 == 0 ? tree1 : tree2)->AddEntry(value);
+    all->AddEntry(value);
+  }
+  EXPECT_OK(tree1->Merge(tree2->Serialize()));
+  base::StatusOr<Output> merged = tree1->PartialResult(1.0);
+  base::StatusOr<Output> expected = all->PartialResult(1.0);
+  ASSERT_OK(merged);
+  ASSERT_OK(expected);
+  EXPECT_EQ(merged->elements(0).value().int_value(),
+            expected->elements(0).value().int_value());
+  EXPECT_EQ(merged->elements(1).value().int_value(),
+            expected->elements(1).value().int_value());
+}
+
+TEST(QuantileTreeTest, MergeEmptySummary) {
+  std::unique_ptr<QuantileTree<int64_t>> tree =
+      ZeroNoiseTree<int64_t>(0, 2048, {.5});
+  std::unique_ptr<QuantileTree<int64_t>> empty =
+      ZeroNoiseTree<int64_t>(0, 2048, {.5});
+  tree->AddEntry(5);
+  EXPECT_OK(tree->Merge(empty->Serialize()));
+  EXPECT_OK(empty->Merge(tree->Serialize()));
+  base::StatusOr<Output> result = empty->PartialResult(1.0);
+  ASSERT_OK(result);
+  EXPECT_EQ(GetValue<int64_t>(*result), 5);
+}
+
+TEST(QuantileTreeTest, MergeRejectsDifferentTree) {
+  std::unique_ptr<QuantileTree<int64_t>> tree =
+      ZeroNoiseTree<int64_t>(0, 2048, {.5});
+  base::StatusOr<std::unique_ptr<QuantileTree<int64_t>>> other =
+      QuantileTree<int64_t>::Builder()
+          .SetLower(0)
+          .SetUpper(2048)
+          .SetQuantiles({.5})
+          .SetTreeHeight(3)
+          .Build();
+  ASSERT_OK(other);
+  (*other)->AddEntry(1);
+  EXPECT_THAT(tree->Merge((*other)->Serialize()),
+              StatusIs(base::StatusCode::kInternal,
+                       HasSubstr("same tree height and branching factor")));
+  EXPECT_THAT(tree->Merge(Summary()),
+              StatusIs(base::StatusCode::kInternal, HasSubstr("no quantile")));
+}
+
+TEST(QuantileTreeTest, BoundsHaveToBeFinite) {
+  QuantileTree<double>::Builder builder;
+  builder.SetQuantiles({.5}).SetUpper(1);
+  EXPECT_THAT(
+      builder.SetLower(-std::numeric_limits<double>::infinity()).Build(),
+      StatusIs(base::StatusCode::kInvalidArgument,
+               HasSubstr("Lower bound has to be finite")));
+  EXPECT_THAT(builder.SetLower(0)
+                  .SetUpper(std::numeric_limits<double>::quiet_NaN())
+                  .Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Upper bound has to be finite")));
+  EXPECT_THAT(builder.SetLower(std::numeric_limits<double>::lowest())
+                  .SetUpper(std::numeric_limits<double>::max())
+                  .Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("range between the lower and the upper bound "
+                                 "has to be finite")));
+  EXPECT_OK(builder.SetLower(std::numeric_limits<double>::lowest() / 2)
+                .SetUpper(std::numeric_limits<double>::max() / 2)
+                .Build());
+}
+
+TEST(QuantileTreeTest, InvalidParameters) {
+  QuantileTree<int64_t>::Builder builder;
+  builder.SetQuantiles({.5});
+  EXPECT_THAT(builder.Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Lower and upper bounds have to be set")));
+  builder.SetLower(0).SetUpper(10);
+  EXPECT_OK(builder.Build());
+  EXPECT_THAT(builder.SetLower(11).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Lower bound cannot be greater")));
+  builder.SetLower(0);
+  EXPECT_THAT(builder.SetTreeHeight(0).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Tree height has to be at least 1")));
+  builder.SetTreeHeight(kDefaultQuantileTreeHeight);
+  EXPECT_THAT(builder.SetBranchingFactor(1).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Branching factor has to be at least 2")));
+  EXPECT_THAT(builder.SetBranchingFactor(1024).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("cannot have more than")));
+  builder.SetBranchingFactor(kDefaultQuantileTreeBranchingFactor);
+  EXPECT_THAT(builder.SetQuantiles({}).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("At least one quantile")));
+  EXPECT_THAT(builder.SetQuantiles({-.1}).Build(),
+              StatusIs(base::StatusCode::kInvalidArgument,
+                       HasSubstr("Quantiles must be between 0 and 1")));
+}
+
+}  // namespace
+}  // namespace differential_privacy
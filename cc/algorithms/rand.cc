@@ -16,6 +16,7 @@
 
 #include "algorithms/rand.h"
 
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <cstdint>
@@ -23,7 +24,7 @@
 #include <limits>
 
 #include "base/logging.h"
-#include "absl/synchronization/mutex.h"
+#include "absl/base/optimization.h"
 #include "openssl/rand.h"
 
 namespace differential_privacy {
@@ -47,10 +48,9 @@ static_assert(sizeof(double) == sizeof(uint64_t) &&
               "double representation is not IEEE 754 binary64.");
 const constexpr int kMantDigits = DBL_MANT_DIG - 1;
 const constexpr uint64_t kMantissaMask = (uint64_t{1} << kMantDigits) - 1ULL;
-}  // namespace
 
-double UniformDouble() {
-  uint64_t uint_64_number = SecureURBG::GetSingleton()();
+// Converts 64 random bits into a sample of UniformDouble().
+double UniformDoubleFromBits(uint64_t uint_64_number) {
   // A random integer of Uniform[0, 2^kMantDigits).
   uint64_t i = uint_64_number & kMantissaMask;
 
@@ -79,6 +79,28 @@ double UniformDouble() {
   return r == 0 ? 1.0 : r;
 }
 
+// Number of random words fetched at once by UniformDoubles().
+constexpr int kUniformDoublesChunkSize = 256;
+}  // namespace
+
+double UniformDouble() {
+  return UniformDoubleFromBits(SecureURBG::GetSingleton()());
+}
+
+void UniformDoubles(absl::Span<double> out) {
+  SecureURBG& random = SecureURBG::GetSingleton();
+  uint64_t words[kUniformDoublesChunkSize];
+  while (!out.empty()) {
+    absl::Span<uint64_t> chunk = absl::MakeSpan(words).first(
+        std::min<size_t>(out.size(), kUniformDoublesChunkSize));
+    random.Fill(chunk);
+    for (size_t i = 0; i < chunk.size(); ++i) {
+      out[i] = UniformDoubleFromBits(chunk[i]);
+    }
+    out.remove_prefix(chunk.size());
+  }
+}
+
 uint64_t Geometric() {
   uint64_t result = 1;
   uint64_t r = 0;
@@ -90,19 +112,44 @@ uint64_t Geometric() {
 }
 
 SecureURBG::result_type SecureURBG::operator()() {
-  absl::WriterMutexLock lock(&mutex_);
-  if (current_index_ + sizeof(result_type) > kBufferSize) {
-    RefreshBuffer();
+  Buffer& buffer = GetThreadBuffer();
+  if (buffer.current_index + sizeof(result_type) > kBufferSize) {
+    RefreshBuffer(buffer);
   }
-  int old_index = current_index_;
-  current_index_ += sizeof(result_type);
+  int old_index = buffer.current_index;
+  buffer.current_index += sizeof(result_type);
   result_type result;
-  std::memcpy(&result, buffer_ + old_index, sizeof(result_type));
+  std::memcpy(&result, buffer.bytes.get() + old_index, sizeof(result_type));
   return result;
 }
 
-void SecureURBG::RefreshBuffer() {
-  RAND_bytes(buffer_, kBufferSize);
-  current_index_ = 0;
+void SecureURBG::Fill(absl::Span<result_type> out) {
+  Buffer& buffer = GetThreadBuffer();
+  uint8_t* dest = reinterpret_cast<uint8_t*>(out.data());
+  size_t remaining = out.size() * sizeof(result_type);
+  while (remaining > 0) {
+    if (buffer.current_index >= kBufferSize) {
+      RefreshBuffer(buffer);
+    }
+    size_t length =
+        std::min<size_t>(remaining, kBufferSize - buffer.current_index);
+    std::memcpy(dest, buffer.bytes.get() + buffer.current_index, length);
+    buffer.current_index += length;
+    dest += length;
+    remaining -= length;
+  }
+}
+
+SecureURBG::Buffer& SecureURBG::GetThreadBuffer() {
+  // The cache is heap allocated on first use so that threads which never draw
+  // random numbers do not pay for it, and so that the static TLS block stays
+  // small when the library is loaded dynamically.
+  thread_local Buffer buffer;
+  return buffer;
+}
+
+void SecureURBG::RefreshBuffer(Buffer& buffer) {
+  RAND_bytes(buffer.bytes.get(), kBufferSize);
+  buffer.current_index = 0;
 }
 }  // namespace differential_privacy
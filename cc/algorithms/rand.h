@@ -22,7 +22,7 @@
 #include <memory>
 
 #include <cstdint>
-#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 
 namespace differential_privacy {
 
@@ -31,11 +31,21 @@ namespace differential_privacy {
 // largest double value less than or equal to r.
 double UniformDouble();
 
+// Fills out with independent samples of UniformDouble(). The random bits for
+// the whole span are fetched at once, which is cheaper than calling
+// UniformDouble() once per sample.
+void UniformDoubles(absl::Span<double> out);
+
 // geometric returns a number randomly picked from a geometric distribution of
 // parameter 0.5. Will not exceed 1025.
 uint64_t Geometric();
 
 // Exposed for testing
+//
+// Random bytes are drawn from the OpenSSL/BoringSSL CSPRNG in large chunks and
+// cached. Every thread owns its own cache, so concurrent callers never share
+// random bytes and never contend on a lock. Each cached byte is handed out at
+// most once.
 class SecureURBG {
  public:
   static SecureURBG& GetSingleton() {
@@ -49,19 +59,29 @@ class SecureURBG {
   static constexpr result_type(max)() {
     return (std::numeric_limits<result_type>::max)();
   }
-  result_type operator()() ABSL_LOCKS_EXCLUDED(mutex_);
+  result_type operator()();
+
+  // Fills out with random words. Equivalent to calling operator() once per
+  // element, but copies the random bytes in bulk.
+  void Fill(absl::Span<result_type> out);
 
  private:
-  SecureURBG() { buffer_ = new uint8_t[kBufferSize]; }
-  ~SecureURBG() { delete[] buffer_; }
+  // Cache of random bytes owned by a single thread.
+  struct Buffer {
+    Buffer() : bytes(new uint8_t[kBufferSize]) {}
+    std::unique_ptr<uint8_t[]> bytes;
+    // The current index in the cache.
+    int current_index = kBufferSize;
+  };
+
+  SecureURBG() = default;
+
+  // Returns the cache of the calling thread.
+  static Buffer& GetThreadBuffer();
   // Refesh the cache with new random bytes.
-  void RefreshBuffer() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  static void RefreshBuffer(Buffer& buffer);
 
   static constexpr int kBufferSize = 65536;
-  // The corrent index in the cache.
-  int current_index_ ABSL_GUARDED_BY(mutex_) = kBufferSize;
-  uint8_t* buffer_ ABSL_GUARDED_BY(mutex_);
-  absl::Mutex mutex_;
 };
 }  // namespace differential_privacy
 
@@ -0,0 +1,54 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "benchmark/benchmark.h"
+#include "algorithms/rand.h"
+
+namespace differential_privacy {
+namespace {
+
+// Each benchmark runs on 1 to 64 threads. Since every thread draws from its own
+// random byte cache, the items per second should grow linearly with the number
+// of threads up to the number of available cores.
+constexpr int kMaxThreads = 64;
+
+void BM_SecureURBG(benchmark::State& state) {
+  SecureURBG& random = SecureURBG::GetSingleton();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(random());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SecureURBG)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+void BM_UniformDouble(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UniformDouble());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UniformDouble)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+void BM_Geometric(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Geometric());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Geometric)->ThreadRange(1, kMaxThreads)->UseRealTime();
+
+}  // namespace
+}  // namespace differential_privacy
@@ -17,6 +17,10 @@
 #include "algorithms/rand.h"
 
 #include <numeric>
+#include <thread>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -62,5 +66,56 @@ TEST_F(RandTest, Geometric) {
   RunTest(Geometric, /*expected_mean=*/2, /*expected_var=*/2);
 }
 
+// Draws from a single static buffer so that RunTest can consume the samples one
+// at a time.
+double BulkUniformDouble() {
+  static std::vector<double>* samples = new std::vector<double>(sample_size);
+  static int next = sample_size;
+  if (next == sample_size) {
+    UniformDoubles(absl::MakeSpan(*samples));
+    next = 0;
+  }
+  return (*samples)[next++];
+}
+
+TEST_F(RandTest, UniformDoubles) {
+  RunTest(BulkUniformDouble, /*expected_mean=*/0.5,
+          /*expected_var=*/1.0 / 12.0);
+}
+
+TEST(SecureURBGTest, FillCrossesBufferBoundaries) {
+  // Larger than the internal buffer, so Fill has to refresh it at least once.
+  std::vector<uint64_t> words(100000, 0);
+  SecureURBG::GetSingleton().Fill(absl::MakeSpan(words));
+  absl::flat_hash_set<uint64_t> unique_words(words.begin(), words.end());
+  EXPECT_EQ(unique_words.size(), words.size());
+}
+
+// Threads draw from separate caches of random bytes. Verify that no words are
+// handed out twice, which would happen if caches were shared or reused.
+TEST(SecureURBGTest, ConcurrentDrawsAreDistinct) {
+  const int num_threads = 8;
+  const int draws_per_thread = 100000;
+  std::vector<std::vector<uint64_t>> draws(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&draws, t]() {
+      SecureURBG& random = SecureURBG::GetSingleton();
+      for (int i = 0; i < draws_per_thread; ++i) {
+        draws[t].push_back(random());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  absl::flat_hash_set<uint64_t> unique_draws;
+  for (const std::vector<uint64_t>& thread_draws : draws) {
+    unique_draws.insert(thread_draws.begin(), thread_draws.end());
+  }
+  EXPECT_EQ(unique_draws.size(), num_threads * draws_per_thread);
+}
+
 }  // namespace
 }  // namespace differential_privacy
@@ -109,6 +109,18 @@ double RoundToNearestMultiple(double n, double base) {
   return n - remainder;
 }
 
+void RoundToNearestMultiples(absl::Span<double> values, double base) {
+  if (base == 0.0) return;
+  for (double& n : values) {
+    double quotient = n / base;
+    double lower = std::floor(quotient);
+    double rounded = (lower + (quotient - lower >= 0.5 ? 1.0 : 0.0)) * base;
+    // An infinite quotient means that n is much larger than base, so it is
+    // already a multiple of base.
+    n = std::isinf(quotient) ? n : rounded;
+  }
+}
+
 double sign(double n) {
   if (n > 0.0) return 1.0;
   if (n < 0.0) return -1.0;
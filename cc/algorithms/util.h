@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <limits>
 #include <numeric>
 #include <string>
@@ -31,6 +32,7 @@
 #include "base/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
 #include "base/status_macros.h"
 
 namespace differential_privacy {
@@ -52,10 +54,32 @@ double DefaultEpsilon();
 // Includes negative powers.
 double GetNextPowerOfTwo(double n);
 
+// Returns the number of bits needed to represent n, i.e., floor(log2(n)) + 1
+// for positive n and 0 for n == 0.
+inline int BitWidth(uint64_t n) {
+#if defined(__GNUC__) || defined(__clang__)
+  return n == 0 ? 0 : 64 - __builtin_clzll(n);
+#else
+  int width = 0;
+  for (int shift = 32; shift > 0; shift >>= 1) {
+    if (n >> shift) {
+      n >>= shift;
+      width += shift;
+    }
+  }
+  return width + static_cast<int>(n);
+#endif
+}
+
 // Rounds n to the nearest multiple of base. Ties are broken towards +inf.
 // If base is 0, returns n.
 double RoundToNearestMultiple(double n, double base);
 
+// Rounds each element of values in place like RoundToNearestMultiple. base must
+// be 0 or a power of 2, which makes the division exact and lets the loop be
+// vectorized.
+void RoundToNearestMultiples(absl::Span<double> values, double base);
+
 // Return 1.0 if n > 0, -1.0 if n < 0, and 0 if n == 0.
 double sign(double n);
 
@@ -333,6 +357,16 @@ std::string VectorToString(const std::vector<T>& v) {
   return absl::StrCat("[", absl::StrJoin(v, ", "), "]");
 }
 
+// Returns member, a member of an object of type Owner, the way std::forward
+// returns the object: as an rvalue that can be moved from if Owner is not an
+// lvalue reference, and as a const lvalue otherwise.
+template <typename Owner, typename V>
+std::conditional_t<std::is_lvalue_reference<Owner>::value, const V&, V&&>
+ForwardMember(V& member) {
+  return static_cast<std::conditional_t<std::is_lvalue_reference<Owner>::value,
+                                        const V&, V&&>>(member);
+}
+
 // Returns the value of optional `opt` if it is set and finite.  Will return
 // an InvalidArgumentError otherwise that includes `name` in the error
 // message.
@@ -151,6 +151,32 @@ TEST(RoundTest, NegativePowerOf2) {
             322122547.0 / (1 << 30));
 }
 
+TEST(RoundTest, MultiplesMatchesSingleValueRounding) {
+  std::vector<double> values = {4.9,  5.1,  -4.9, -5.1, 5.0,   -5.0,  0.0,
+                                0.3,  -0.3, 1e20, -1e20, 1e308, 0.125, -0.375,
+                                1.0 / 3};
+  for (double base :
+       {0.0, 2.0, 0.25, 1.0 / (1 << 30), std::ldexp(1.0, -1000)}) {
+    std::vector<double> rounded = values;
+    RoundToNearestMultiples(absl::MakeSpan(rounded), base);
+    for (int i = 0; i < values.size(); ++i) {
+      EXPECT_EQ(rounded[i], RoundToNearestMultiple(values[i], base))
+          << values[i] << " " << base;
+    }
+  }
+}
+
+TEST(BitWidthTest, PowersOfTwo) {
+  EXPECT_EQ(BitWidth(0), 0);
+  EXPECT_EQ(BitWidth(1), 1);
+  for (int i = 1; i < 64; ++i) {
+    uint64_t power = uint64_t{1} << i;
+    EXPECT_EQ(BitWidth(power - 1), i);
+    EXPECT_EQ(BitWidth(power), i + 1);
+  }
+  EXPECT_EQ(BitWidth(std::numeric_limits<uint64_t>::max()), 64);
+}
+
 TEST(QnormTest, InvalidProbability) {
   EXPECT_EQ(Qnorm(-0.1).status().code(), base::StatusCode::kInvalidArgument);
   EXPECT_EQ(Qnorm(0).status().code(), base::StatusCode::kInvalidArgument);
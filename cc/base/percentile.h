@@ -17,9 +17,13 @@
 #ifndef DIFFERENTIAL_PRIVACY_BASE_PERCENTILE_H_
 #define DIFFERENTIAL_PRIVACY_BASE_PERCENTILE_H_
 
+#include <algorithm>
 #include <cmath>
+#include <utility>
+#include <vector>
 
 #include "google/protobuf/repeated_field.h"
+#include "base/radix_sort.h"
 #include "proto/util.h"
 
 namespace differential_privacy {
@@ -42,44 +46,102 @@ namespace base {
 // this value. This is useful to ascertain when an input list has many
 // instances of the same value, for example.
 //
-// Adding inputs is an O(1) operation. Retrieving a percentile sorts the
-// underlying vector only if there has been an addition since the previous sort.
-// Thus, retrieving a percentile is O(nlog n) worst case and O(log n) if no
-// additional inputs have been added.
+// Adding inputs is an O(1) operation. Retrieving a percentile sorts the inputs
+// added since the previous sort. Inputs are kept as runs: the sorted prefix,
+// runs of merged inputs that were serialized in sorted order, and runs of
+// unsorted inputs. The unsorted runs are radix sorted, on up to num_threads
+// threads for large runs, and then all runs are merged. Thus, retrieving a
+// percentile is O(n) worst case plus O(n log r) to merge r runs, and O(log n)
+// if no additional inputs have been added.
 template <typename T>
 class Percentile {
  public:
-  Percentile() {}
+  explicit Percentile(int num_threads = 1) : num_threads_(num_threads) {}
 
   void Add(const T& t) {
     // REF:
     // https://stackoverflow.com/questions/61646166/how-to-resolve-fpclassify-ambiguous-call-to-overloaded-function
     if (!std::isnan(static_cast<double>(t))) {
+      if (runs_.empty() || runs_.back().sorted) {
+        runs_.push_back({inputs_.size(), /*sorted=*/false});
+      }
       inputs_.push_back(t);
-      sorted_ = false;
     }
   }
 
   void Reset() {
     inputs_.clear();
-    sorted_ = true;
+    sorted_size_ = 0;
+    runs_.clear();
   }
 
   void SerializeToProto(google::protobuf::RepeatedPtrField<ValueType>* values) {
+    values->Reserve(values->size() + inputs_.size());
     for (const T& t : inputs_) {
       values->Add(MakeValueType(t));
     }
   }
 
-  void MergeFromProto(google::protobuf::RepeatedPtrField<ValueType> values) {
-    for (const ValueType v : values) {
-      inputs_.push_back(GetValue<T>(v));
-      sorted_ = false;
+  void MergeFromProto(
+      const google::protobuf::RepeatedPtrField<ValueType>& values) {
+    if (values.empty()) {
+      return;
     }
+    size_t begin = inputs_.size();
+    ReserveInputs(values.size());
+    bool sorted = true;
+    for (const ValueType& v : values) {
+      sorted &= AppendMerged(begin, GetValue<T>(v));
+    }
+    AddMergedRun(begin, sorted);
+  }
+
+  void SerializeToProto(PackedValues* values) const {
+    SetPackedValues(inputs_, values);
+  }
+
+  void MergeFromProto(const PackedValues& values) {
+    int64_t size = PackedValuesSize<T>(values);
+    if (size == 0) {
+      return;
+    }
+    size_t begin = inputs_.size();
+    ReserveInputs(size);
+    bool sorted = true;
+    ForEachPackedValue<T>(values, [this, begin, &sorted](int64_t i, T t) {
+      sorted &= AppendMerged(begin, t);
+    });
+    AddMergedRun(begin, sorted);
+  }
+
+  // Adds the inputs of other without serializing them. The sorted prefix and
+  // the runs of other are kept as runs, so they are not sorted again.
+  void MergeFrom(const Percentile<T>& other) {
+    size_t begin = inputs_.size();
+    inputs_.insert(inputs_.end(), other.inputs_.begin(), other.inputs_.end());
+    if (other.sorted_size_ > 0) {
+      AddMergedRun(begin, /*sorted=*/true);
+    }
+    for (const Run& run : other.runs_) {
+      AddMergedRun(begin + run.begin, run.sorted);
+    }
+  }
+
+  // Same as above, but takes the buffers of other if there are no inputs yet.
+  // other has to be reset before it is used again.
+  void MergeFrom(Percentile<T>&& other) {
+    if (!inputs_.empty()) {
+      MergeFrom(static_cast<const Percentile<T>&>(other));
+      return;
+    }
+    inputs_.swap(other.inputs_);
+    runs_.swap(other.runs_);
+    sorted_size_ = other.sorted_size_;
   }
 
   int64_t Memory() {
-    return sizeof(Percentile<T>) + sizeof(T) * inputs_.capacity();
+    return sizeof(Percentile<T>) + sizeof(T) * inputs_.capacity() +
+           sizeof(Run) * runs_.capacity();
   }
 
   int64_t num_values() { return inputs_.size(); }
@@ -91,9 +153,8 @@ class Percentile {
     }
 
     // If something has been added since the last sort, sort again.
-    if (!sorted_) {
-      std::sort(inputs_.begin(), inputs_.end());
-      sorted_ = true;
+    if (!runs_.empty()) {
+      Sort();
     }
     auto lb = std::lower_bound(inputs_.begin(), inputs_.end(), t);
     auto ub = std::upper_bound(lb, inputs_.end(), t);
@@ -103,8 +164,79 @@ class Percentile {
   }
 
  private:
+  // A range of inputs, from begin up to the beginning of the next run or the
+  // end of the inputs.
+  struct Run {
+    size_t begin;
+    bool sorted;
+  };
+
+  // Reserves room for additional inputs. The capacity grows geometrically, so
+  // that merging many small summaries does not reallocate the inputs each time.
+  void ReserveInputs(size_t additional) {
+    size_t size = inputs_.size() + additional;
+    if (size > inputs_.capacity()) {
+      inputs_.reserve(std::max(size, 2 * inputs_.capacity()));
+    }
+  }
+
+  // Appends a merged input of the block starting at begin, and returns whether
+  // the block is still sorted.
+  bool AppendMerged(size_t begin, T t) {
+    bool sorted = inputs_.size() == begin || !(t < inputs_.back());
+    inputs_.push_back(t);
+    return sorted;
+  }
+
+  // Records the merged block starting at begin as a run. Unsorted blocks
+  // extend a preceding unsorted run.
+  void AddMergedRun(size_t begin, bool sorted) {
+    if (sorted || runs_.empty() || runs_.back().sorted) {
+      runs_.push_back({begin, sorted});
+    }
+  }
+
+  // Sorts the unsorted runs and merges all runs into the sorted prefix. Pairs
+  // of adjacent runs are merged in rounds, so every input is moved in
+  // O(log runs) merges.
+  void Sort() {
+    std::vector<size_t> boundaries;
+    if (sorted_size_ > 0) {
+      boundaries.push_back(0);
+    }
+    for (int i = 0; i < runs_.size(); ++i) {
+      size_t end = i + 1 < runs_.size() ? runs_[i + 1].begin : inputs_.size();
+      if (!runs_[i].sorted) {
+        RadixSort(inputs_.data() + runs_[i].begin, inputs_.data() + end,
+                  num_threads_);
+      }
+      boundaries.push_back(runs_[i].begin);
+    }
+    boundaries.push_back(inputs_.size());
+
+    while (boundaries.size() > 2) {
+      std::vector<size_t> merged = {0};
+      for (int i = 2; i < boundaries.size(); i += 2) {
+        std::inplace_merge(inputs_.begin() + boundaries[i - 2],
+                           inputs_.begin() + boundaries[i - 1],
+                           inputs_.begin() + boundaries[i]);
+        merged.push_back(boundaries[i]);
+      }
+      if (merged.back() != inputs_.size()) {
+        merged.push_back(inputs_.size());
+      }
+      boundaries = std::move(merged);
+    }
+    sorted_size_ = inputs_.size();
+    runs_.clear();
+  }
+
+  // The number of threads that sort the inputs.
+  int num_threads_;
   std::vector<T> inputs_;
-  bool sorted_ = true;
+  // The inputs before sorted_size_ are sorted, and runs_ covers the rest.
+  size_t sorted_size_ = 0;
+  std::vector<Run> runs_;
 };
 
 }  // namespace base
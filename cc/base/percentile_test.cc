@@ -108,6 +108,77 @@ TYPED_TEST(PercentileTest, SerializeMerge) {
   EXPECT_EQ(std::make_pair(.25, .5), percentile2.GetRelativeRank(2));
 }
 
+TYPED_TEST(PercentileTest, MergesSortedAndUnsortedRuns) {
+  // Values 0 to 9999, split into a sorted prefix, sorted and unsorted merged
+  // runs, and added inputs.
+  Percentile<TypeParam> sorted_run;
+  Percentile<TypeParam> unsorted_run;
+  Percentile<TypeParam> percentile;
+  for (int i = 0; i < 10000; i += 4) {
+    sorted_run.Add(i);
+    unsorted_run.Add(9999 - i - 2);
+    percentile.Add(9999 - i);
+    percentile.Add(i + 2);
+  }
+  EXPECT_EQ(std::make_pair(0.0, 0.0), sorted_run.GetRelativeRank(-1));
+  EXPECT_EQ(std::make_pair(0.0, 0.0), percentile.GetRelativeRank(-1));
+
+  BinarySearchSummary summary;
+  sorted_run.SerializeToProto(summary.mutable_input());
+  unsorted_run.SerializeToProto(summary.mutable_input());
+  percentile.MergeFromProto(summary.input());
+  percentile.Add(10000);
+  EXPECT_EQ(percentile.num_values(), 10001);
+  for (int i = 0; i <= 10000; i += 125) {
+    EXPECT_EQ(std::make_pair(i / 10001.0, (i + 1) / 10001.0),
+              percentile.GetRelativeRank(i));
+  }
+}
+
+TYPED_TEST(PercentileTest, SortsOnSeveralThreads) {
+  // Large enough for the radix sort to use both threads.
+  const int size = 1 << 21;
+  Percentile<TypeParam> percentile(/*num_threads=*/2);
+  for (int i = size - 1; i >= 0; --i) {
+    percentile.Add(i);
+  }
+  for (int i = 0; i < size; i += size / 64) {
+    EXPECT_EQ(std::make_pair(static_cast<double>(i) / size,
+                             static_cast<double>(i + 1) / size),
+              percentile.GetRelativeRank(i));
+  }
+}
+
+TYPED_TEST(PercentileTest, MergeFromKeepsRuns) {
+  // Values 0 to 9999, split over percentiles with a sorted prefix and with
+  // sorted and unsorted runs.
+  Percentile<TypeParam> sorted;
+  Percentile<TypeParam> unsorted;
+  Percentile<TypeParam> percentile;
+  for (int i = 0; i < 10000; i += 4) {
+    sorted.Add(i);
+    unsorted.Add(9999 - i - 2);
+    percentile.Add(9999 - i);
+    percentile.Add(i + 2);
+  }
+  EXPECT_EQ(std::make_pair(0.0, 0.0), sorted.GetRelativeRank(-1));
+
+  percentile.MergeFrom(sorted);
+  percentile.MergeFrom(std::move(unsorted));
+  EXPECT_EQ(sorted.num_values(), 2500);
+  EXPECT_EQ(percentile.num_values(), 10000);
+  for (int i = 0; i < 10000; i += 125) {
+    EXPECT_EQ(std::make_pair(i / 10000.0, (i + 1) / 10000.0),
+              percentile.GetRelativeRank(i));
+  }
+
+  // Moving into empty percentiles takes the inputs.
+  Percentile<TypeParam> empty;
+  empty.MergeFrom(std::move(percentile));
+  EXPECT_EQ(empty.num_values(), 10000);
+  EXPECT_EQ(std::make_pair(.5, .5001), empty.GetRelativeRank(5000));
+}
+
 }  // namespace
 }  // namespace base
 }  // namespace differential_privacy
@@ -0,0 +1,141 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_BASE_RADIX_SORT_H_
+#define DIFFERENTIAL_PRIVACY_BASE_RADIX_SORT_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "base/run_on_threads.h"
+
+namespace differential_privacy {
+namespace base {
+
+// Ranges smaller than this are sorted with std::sort.
+const size_t kMinRadixSortSize = 1 << 12;
+
+// Each thread of a parallel radix sort handles at least this many values.
+const size_t kMinValuesPerSortThread = 1 << 20;
+
+namespace internal {
+
+// Maps values to unsigned keys of the same width that are ordered like the
+// values.
+template <typename T, typename Enable = void>
+struct RadixKey;
+
+template <typename T>
+struct RadixKey<T, std::enable_if_t<std::is_integral<T>::value>> {
+  using Key = std::make_unsigned_t<T>;
+  static Key Get(T t) {
+    Key key = static_cast<Key>(t);
+    if (std::is_signed<T>::value) {
+      key ^= Key{1} << (8 * sizeof(Key) - 1);
+    }
+    return key;
+  }
+};
+
+// Positive IEEE floating point numbers are ordered like their bits. Setting the
+// sign bit moves them above the negative numbers, whose bits are inverted to
+// reverse their order.
+template <typename T>
+struct RadixKey<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                "Only 32 and 64 bit floating point types are supported.");
+  using Key = std::conditional_t<sizeof(T) == 8, uint64_t, uint32_t>;
+  static Key Get(T t) {
+    Key bits;
+    std::memcpy(&bits, &t, sizeof(T));
+    constexpr Key kSignBit = Key{1} << (8 * sizeof(Key) - 1);
+    return (bits & kSignBit) ? ~bits : bits | kSignBit;
+  }
+};
+
+}  // namespace internal
+
+// Sorts [begin, end) in ascending order with a least significant digit radix
+// sort on 8 bit digits. Each pass histograms and scatters the values of up to
+// num_threads chunks in parallel, and passes over digits that all values share
+// are skipped. The sort is stable. NaNs are not supported.
+template <typename T>
+void RadixSort(T* begin, T* end, int num_threads = 1) {
+  const size_t size = end - begin;
+  if (size < kMinRadixSortSize) {
+    std::sort(begin, end);
+    return;
+  }
+  using Key = typename internal::RadixKey<T>::Key;
+  num_threads = static_cast<int>(std::max<size_t>(
+      1, std::min<size_t>(num_threads, size / kMinValuesPerSortThread)));
+  auto chunk_begin = [size, num_threads](int chunk) {
+    return size * chunk / num_threads;
+  };
+
+  std::vector<T> buffer(size);
+  T* from = begin;
+  T* to = buffer.data();
+  std::vector<std::array<size_t, 256>> counts(num_threads);
+  for (int shift = 0; shift < 8 * sizeof(Key); shift += 8) {
+    auto digit = [shift](T t) {
+      return (internal::RadixKey<T>::Get(t) >> shift) & 0xff;
+    };
+    RunOnThreads(num_threads, [&](int chunk) {
+      counts[chunk].fill(0);
+      for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+        ++counts[chunk][digit(from[i])];
+      }
+    });
+
+    // Turn the counts into the position of the first value of each digit and
+    // chunk in the output, digits first.
+    size_t offset = 0;
+    bool shared_digit = false;
+    for (int d = 0; d < 256; ++d) {
+      size_t digit_begin = offset;
+      for (int chunk = 0; chunk < num_threads; ++chunk) {
+        size_t count = counts[chunk][d];
+        counts[chunk][d] = offset;
+        offset += count;
+      }
+      shared_digit |= offset - digit_begin == size;
+    }
+    if (shared_digit) {
+      continue;
+    }
+
+    RunOnThreads(num_threads, [&](int chunk) {
+      std::array<size_t, 256>& positions = counts[chunk];
+      for (size_t i = chunk_begin(chunk); i < chunk_begin(chunk + 1); ++i) {
+        to[positions[digit(from[i])]++] = from[i];
+      }
+    });
+    std::swap(from, to);
+  }
+  if (from != begin) {
+    std::copy(from, from + size, begin);
+  }
+}
+
+}  // namespace base
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_BASE_RADIX_SORT_H_
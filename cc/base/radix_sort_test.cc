@@ -0,0 +1,88 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "base/radix_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace differential_privacy {
+namespace base {
+namespace {
+
+using ::testing::ElementsAreArray;
+
+template <typename T>
+class RadixSortTest : public ::testing::Test {};
+
+typedef ::testing::Types<int64_t, int32_t, uint64_t, double, float> SortTypes;
+TYPED_TEST_SUITE(RadixSortTest, SortTypes);
+
+template <typename T>
+std::vector<T> RandomValues(size_t size) {
+  std::mt19937 gen(size);
+  std::uniform_int_distribution<int64_t> dist(-1000000, 1000000);
+  std::vector<T> values;
+  for (size_t i = 0; i < size; ++i) {
+    values.push_back(static_cast<T>(dist(gen)) / 3);
+  }
+  values.push_back(std::numeric_limits<T>::max());
+  values.push_back(std::numeric_limits<T>::lowest());
+  values.push_back(0);
+  return values;
+}
+
+TYPED_TEST(RadixSortTest, MatchesStdSort) {
+  for (size_t size : {size_t{10}, kMinRadixSortSize, size_t{100000}}) {
+    std::vector<TypeParam> values = RandomValues<TypeParam>(size);
+    std::vector<TypeParam> expected = values;
+    std::sort(expected.begin(), expected.end());
+    RadixSort(values.data(), values.data() + values.size());
+    EXPECT_THAT(values, ElementsAreArray(expected));
+  }
+}
+
+TYPED_TEST(RadixSortTest, ParallelMatchesStdSort) {
+  std::vector<TypeParam> values =
+      RandomValues<TypeParam>(3 * kMinValuesPerSortThread);
+  std::vector<TypeParam> expected = values;
+  std::sort(expected.begin(), expected.end());
+  RadixSort(values.data(), values.data() + values.size(), /*num_threads=*/4);
+  EXPECT_THAT(values, ElementsAreArray(expected));
+}
+
+TEST(RadixSortTest, OrdersSpecialDoubles) {
+  std::vector<double> values(kMinRadixSortSize, 1.5);
+  values.push_back(std::numeric_limits<double>::infinity());
+  values.push_back(-std::numeric_limits<double>::infinity());
+  values.push_back(std::numeric_limits<double>::denorm_min());
+  values.push_back(-std::numeric_limits<double>::denorm_min());
+  values.push_back(-2.5);
+  RadixSort(values.data(), values.data() + values.size());
+  EXPECT_TRUE(std::is_sorted(values.begin(), values.end()));
+  EXPECT_EQ(values.front(), -std::numeric_limits<double>::infinity());
+  EXPECT_EQ(values.back(), std::numeric_limits<double>::infinity());
+}
+
+}  // namespace
+}  // namespace base
+}  // namespace differential_privacy
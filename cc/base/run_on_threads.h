@@ -0,0 +1,43 @@
+//
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef DIFFERENTIAL_PRIVACY_BASE_RUN_ON_THREADS_H_
+#define DIFFERENTIAL_PRIVACY_BASE_RUN_ON_THREADS_H_
+
+#include <thread>
+#include <vector>
+
+namespace differential_privacy {
+namespace base {
+
+// Runs function(i) for i in [0, num_threads), each on its own thread except
+// for i = 0, which runs on the calling thread. Returns once all calls are done.
+template <typename Function>
+void RunOnThreads(int num_threads, const Function& function) {
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(function, i);
+  }
+  function(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace base
+}  // namespace differential_privacy
+
+#endif  // DIFFERENTIAL_PRIVACY_BASE_RUN_ON_THREADS_H_
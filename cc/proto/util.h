@@ -17,7 +17,10 @@
 #ifndef DIFFERENTIAL_PRIVACY_PROTO_UTIL_H_
 #define DIFFERENTIAL_PRIVACY_PROTO_UTIL_H_
 
+#include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <vector>
 
 #include "proto/data.pb.h"
 
@@ -137,5 +140,173 @@ void AddToOutput(Output* output, T value) {
   element->mutable_value()->set_float_value(value);
 }
 
+namespace internal {
+
+template <typename T,
+          typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+void AddPackedValue(PackedValues* packed, T value) {
+  packed->add_int_value(value);
+}
+
+template <typename T, typename std::enable_if<
+                          std::is_floating_point<T>::value>::type* = nullptr>
+void AddPackedValue(PackedValues* packed, T value) {
+  packed->add_float_value(value);
+}
+
+template <typename T,
+          typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+const google::protobuf::RepeatedField<int64_t>& PackedValueField(
+    const PackedValues& packed) {
+  return packed.int_value();
+}
+
+template <typename T, typename std::enable_if<
+                          std::is_floating_point<T>::value>::type* = nullptr>
+const google::protobuf::RepeatedField<double>& PackedValueField(
+    const PackedValues& packed) {
+  return packed.float_value();
+}
+
+}  // namespace internal
+
+// Writes values to packed. Runs of zeros are elided if fewer than half of the
+// values are nonzero.
+template <typename T>
+void SetPackedValues(const std::vector<T>& values, PackedValues* packed) {
+  packed->Clear();
+  size_t num_nonzero =
+      std::count_if(values.begin(), values.end(), [](T t) { return t != 0; });
+  if (2 * num_nonzero >= values.size()) {
+    for (T t : values) {
+      internal::AddPackedValue(packed, t);
+    }
+    return;
+  }
+  packed->set_size(values.size());
+  uint32_t zero_run = 0;
+  for (T t : values) {
+    if (t == 0) {
+      ++zero_run;
+      continue;
+    }
+    packed->add_zero_run(zero_run);
+    internal::AddPackedValue(packed, t);
+    zero_run = 0;
+  }
+}
+
+// Writes a sequence of size values to packed, of which only the values in
+// nonzero can be nonzero. nonzero holds pairs of an index and a value, in
+// increasing order of index, for instance a sorted map. The encoding is chosen
+// as by SetPackedValues().
+template <typename T, typename Pairs>
+void SetSparsePackedValues(int64_t size, const Pairs& nonzero,
+                           PackedValues* packed) {
+  packed->Clear();
+  if (2 * static_cast<int64_t>(nonzero.size()) >= size) {
+    int64_t position = 0;
+    for (const auto& entry : nonzero) {
+      for (; position < entry.first; ++position) {
+        internal::AddPackedValue(packed, T{0});
+      }
+      internal::AddPackedValue(packed, static_cast<T>(entry.second));
+      ++position;
+    }
+    for (; position < size; ++position) {
+      internal::AddPackedValue(packed, T{0});
+    }
+    return;
+  }
+  packed->set_size(size);
+  int64_t position = 0;
+  for (const auto& entry : nonzero) {
+    packed->add_zero_run(entry.first - position);
+    internal::AddPackedValue(packed, static_cast<T>(entry.second));
+    position = entry.first + 1;
+  }
+}
+
+// Returns the number of values in packed.
+template <typename T>
+int64_t PackedValuesSize(const PackedValues& packed) {
+  if (packed.has_size()) {
+    return packed.size();
+  }
+  return internal::PackedValueField<T>(packed).size();
+}
+
+// Calls f(i, value) for every value in packed, in order, including elided
+// zeros. Values of malformed packed encodings beyond PackedValuesSize() are
+// dropped.
+template <typename T, typename Function>
+void ForEachPackedValue(const PackedValues& packed, const Function& f) {
+  const auto& values = internal::PackedValueField<T>(packed);
+  if (!packed.has_size()) {
+    for (int i = 0; i < values.size(); ++i) {
+      f(i, static_cast<T>(values.Get(i)));
+    }
+    return;
+  }
+  int64_t size = packed.size();
+  int64_t position = 0;
+  for (int i = 0; i < values.size() && position < size; ++i) {
+    if (i < packed.zero_run_size()) {
+      int64_t zeros_end =
+          std::min<int64_t>(size, position + packed.zero_run(i));
+      for (; position < zeros_end; ++position) {
+        f(position, T{0});
+      }
+    }
+    if (position < size) {
+      f(position++, static_cast<T>(values.Get(i)));
+    }
+  }
+  for (; position < size; ++position) {
+    f(position, T{0});
+  }
+}
+
+// Calls f(i, value) for every nonzero value in packed, in order. Unlike
+// ForEachPackedValue(), elided zeros cost nothing, so this takes time
+// proportional to the encoded values rather than to PackedValuesSize().
+template <typename T, typename Function>
+void ForEachNonzeroPackedValue(const PackedValues& packed, const Function& f) {
+  const auto& values = internal::PackedValueField<T>(packed);
+  int64_t size = PackedValuesSize<T>(packed);
+  int64_t position = 0;
+  for (int i = 0; i < values.size(); ++i) {
+    if (packed.has_size() && i < packed.zero_run_size()) {
+      position += packed.zero_run(i);
+    }
+    if (position >= size) {
+      return;
+    }
+    T value = static_cast<T>(values.Get(i));
+    if (value != 0) {
+      f(position, value);
+    }
+    ++position;
+  }
+}
+
+// Returns packed, or, if legacy holds values, those values packed into buffer.
+// legacy is the repeated ValueType encoding of summaries written before
+// packed encodings were used.
+template <typename T>
+const PackedValues& PackedOrLegacy(
+    const PackedValues& packed,
+    const google::protobuf::RepeatedPtrField<ValueType>& legacy,
+    PackedValues* buffer) {
+  if (legacy.empty()) {
+    return packed;
+  }
+  buffer->Clear();
+  for (const ValueType& value : legacy) {
+    internal::AddPackedValue(buffer, GetValue<T>(value));
+  }
+  return *buffer;
+}
+
 }  // namespace differential_privacy
 #endif  // DIFFERENTIAL_PRIVACY_PROTO_UTIL_H_
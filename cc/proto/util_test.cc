@@ -17,6 +17,8 @@
 #include "proto/util.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -25,6 +27,7 @@ namespace differential_privacy {
 
 namespace {
 
+using ::testing::ElementsAre;
 using ::testing::Eq;
 
 TEST(UtilTest, GetSetValueTypeInt) {
@@ -90,6 +93,97 @@ TEST(UtilTest, MakeValueType) {
   EXPECT_EQ(v.float_value(), 1.0);
 }
 
+template <typename T>
+std::vector<T> UnpackValues(const PackedValues& packed) {
+  std::vector<T> values;
+  ForEachPackedValue<T>(packed, [&values](int64_t i, T t) {
+    EXPECT_EQ(i, values.size());
+    values.push_back(t);
+  });
+  EXPECT_EQ(PackedValuesSize<T>(packed), values.size());
+  return values;
+}
+
+TEST(UtilTest, PackedValuesDense) {
+  PackedValues packed;
+  SetPackedValues<int64_t>({3, 0, -5, 7}, &packed);
+  EXPECT_FALSE(packed.has_size());
+  EXPECT_THAT(UnpackValues<int64_t>(packed), ElementsAre(3, 0, -5, 7));
+}
+
+TEST(UtilTest, PackedValuesElidesZeros) {
+  PackedValues packed;
+  SetPackedValues<double>({0, 0, 1.5, 0, 0, 0, -2.5, 0}, &packed);
+  EXPECT_EQ(packed.size(), 8);
+  EXPECT_THAT(packed.zero_run(), ElementsAre(2, 3));
+  EXPECT_THAT(packed.float_value(), ElementsAre(1.5, -2.5));
+  EXPECT_THAT(UnpackValues<double>(packed),
+              ElementsAre(0, 0, 1.5, 0, 0, 0, -2.5, 0));
+
+  SetPackedValues<double>({0, 0, 0}, &packed);
+  EXPECT_EQ(packed.float_value_size(), 0);
+  EXPECT_THAT(UnpackValues<double>(packed), ElementsAre(0, 0, 0));
+}
+
+TEST(UtilTest, PackedValuesDropsValuesBeyondSize) {
+  PackedValues packed;
+  packed.set_size(3);
+  packed.add_zero_run(2);
+  packed.add_int_value(1);
+  packed.add_zero_run(5);
+  packed.add_int_value(2);
+  EXPECT_THAT(UnpackValues<int64_t>(packed), ElementsAre(0, 0, 1));
+}
+
+TEST(UtilTest, SparsePackedValues) {
+  PackedValues packed;
+  std::vector<std::pair<int64_t, int64_t>> nonzero = {{2, 4}, {6, -1}};
+  SetSparsePackedValues<int64_t>(8, nonzero, &packed);
+  EXPECT_EQ(packed.size(), 8);
+  EXPECT_THAT(packed.zero_run(), ElementsAre(2, 3));
+  EXPECT_THAT(UnpackValues<int64_t>(packed),
+              ElementsAre(0, 0, 4, 0, 0, 0, -1, 0));
+
+  // At least half of the values are nonzero, so no zeros are elided.
+  nonzero = {{1, 4}, {2, -1}};
+  SetSparsePackedValues<int64_t>(4, nonzero, &packed);
+  EXPECT_FALSE(packed.has_size());
+  EXPECT_THAT(UnpackValues<int64_t>(packed), ElementsAre(0, 4, -1, 0));
+}
+
+TEST(UtilTest, ForEachNonzeroPackedValue) {
+  PackedValues packed;
+  SetPackedValues<double>({0, 0, 1.5, 0, 0, 0, -2.5, 0}, &packed);
+  std::vector<std::pair<int64_t, double>> nonzero;
+  ForEachNonzeroPackedValue<double>(packed, [&nonzero](int64_t i, double d) {
+    nonzero.push_back({i, d});
+  });
+  EXPECT_THAT(nonzero, ElementsAre(std::make_pair(2, 1.5),
+                                   std::make_pair(6, -2.5)));
+
+  nonzero.clear();
+  SetPackedValues<double>({3, 0, 1}, &packed);
+  ForEachNonzeroPackedValue<double>(packed, [&nonzero](int64_t i, double d) {
+    nonzero.push_back({i, d});
+  });
+  EXPECT_THAT(nonzero,
+              ElementsAre(std::make_pair(0, 3.0), std::make_pair(2, 1.0)));
+}
+
+TEST(UtilTest, PackedOrLegacy) {
+  PackedValues packed;
+  SetPackedValues<int64_t>({1, 2}, &packed);
+  google::protobuf::RepeatedPtrField<ValueType> legacy;
+  PackedValues buffer;
+  EXPECT_EQ(&PackedOrLegacy<int64_t>(packed, legacy, &buffer), &packed);
+
+  *legacy.Add() = MakeValueType<int64_t>(4);
+  *legacy.Add() = MakeValueType<int64_t>(5);
+  EXPECT_THAT(
+      UnpackValues<int64_t>(PackedOrLegacy<int64_t>(packed, legacy, &buffer)),
+      ElementsAre(4, 5));
+}
+
 }  // namespace
 
 }  // namespace differential_privacy